@@ -0,0 +1,72 @@
+/**
+ * @file   bsp.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Board Support Package for the hosted (Linux) build.
+ *
+ *         Built instead of the Nucleo-144 BSP when configuring with `-DHOSTED=ON`. The
+ *         application runs as a normal Linux process on the uCOS-III and uC-CPU POSIX
+ *         ports, where every task is a host thread and the kernel tick is generated by a
+ *         host timer (or by the idle task with virtual time, see bsp_timebase.c). This
+ *         lets the platform independent code in "Source" be run and benchmarked without
+ *         the board.
+ *
+ *         The public API is the same bsp.h as the Nucleo-144 BSP. Drivers are either simple
+ *         stand-ins (this directory) or the Nucleo-144 driver itself where it is portable
+ *         (bsp_crc.c, built with `BSP_HOSTED` defined, uses the software CRC for every mode).
+ *         With `-DSHIELD_MODEL=ON` the sensor is the Nucleo-144 driver too, on ms8607_model.c.
+ *
+ *         Timestamps (`CPU_TS_TmrInit`, `CPU_TS_TmrRd`) are provided by the uC-CPU POSIX port
+ *         using the host monotonic clock, so there is no cpu_bsp.c here.
+ */
+
+#include "bsp.h"
+#include "bsp_sim.h"
+
+#include <os.h>
+
+#include <stdint.h>
+
+/* Nominal "CPU" clock, the POSIX timestamp timer counts nanoseconds */
+#define SIM_CPU_CLK_FREQ (1000000000UL)
+
+BSP_RESULT BSP_Init(void)
+{
+    if (BSP_CRC_Init() != BSP_SUCCESS)
+    {
+        return BSP_FAILURE;
+    }
+
+    if (BSP_LED_Init() != BSP_SUCCESS)
+    {
+        return BSP_FAILURE;
+    }
+
+    if (BSP_Sensor_Init() != BSP_SUCCESS)
+    {
+        return BSP_FAILURE;
+    }
+
+    if (BSP_UART_Init() != BSP_SUCCESS)
+    {
+        return BSP_FAILURE;
+    }
+
+    return BSP_SUCCESS;
+}
+
+CPU_INT32U BSP_CPU_ClkFreq(void)
+{
+    return (CPU_INT32U) SIM_CPU_CLK_FREQ;
+}
+
+void BSP_Tick_Init(void)
+{
+    /* The POSIX port starts its own tick timer in OSStart, only the timebase needs latching */
+    BSP_Timebase_Init();
+}
+
+/* Runs `handler` as a simulated interrupt from the next tick, see `BSP_Timebase_Schedule` */
+BSP_RESULT BSP_SWI_Trigger(BSP_SWIHandler handler)
+{
+    return BSP_Timebase_Schedule(handler, 0U);
+}
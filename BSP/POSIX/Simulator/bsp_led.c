@@ -0,0 +1,65 @@
+/**
+ * @file   bsp_led.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  LED stand-in for the hosted build.
+ *
+ *         Keeps the state of each LED. The red LED is the application's error
+ *         indicator, so turning it on is also reported on stderr.
+ */
+
+#include "bsp.h"
+
+#include <os.h>
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#define NUM_LEDS (3U)
+
+static bool LedState[NUM_LEDS];
+
+static BSP_RESULT LED_Set(LED_TypeDef led, bool on)
+{
+    if ((uint32_t) led >= NUM_LEDS)
+    {
+        return BSP_FAILURE;
+    }
+
+    if ((led == LED_RED) && (on == true) && (LedState[led] == false))
+    {
+        fprintf(stderr, "[bsp] red LED on\n");
+    }
+
+    LedState[led] = on;
+
+    return BSP_SUCCESS;
+}
+
+BSP_RESULT BSP_LED_Init(void)
+{
+    LedState[LED_GREEN] = false;
+    LedState[LED_BLUE]  = false;
+    LedState[LED_RED]   = false;
+
+    return BSP_SUCCESS;
+}
+
+BSP_RESULT BSP_LED_On(LED_TypeDef led)
+{
+    return LED_Set(led, true);
+}
+
+BSP_RESULT BSP_LED_Off(LED_TypeDef led)
+{
+    return LED_Set(led, false);
+}
+
+BSP_RESULT BSP_LED_Toggle(LED_TypeDef led)
+{
+    if ((uint32_t) led >= NUM_LEDS)
+    {
+        return BSP_FAILURE;
+    }
+
+    return LED_Set(led, !LedState[led]);
+}
@@ -0,0 +1,24 @@
+/**
+ * @file   bsp_sampler.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  PC sampling stand-in for the hosted build.
+ *
+ *         Tasks are host threads, so there is no interrupted PC to sample. Starting the
+ *         sampler fails, use the host's profiler (e.g. `perf record`) on the process instead.
+ */
+
+#include "bsp.h"
+
+#include <os.h>
+
+#include <stdint.h>
+
+BSP_RESULT BSP_Sampler_Start(uint32_t rate_hz, BSP_SamplerHandler handler)
+{
+    return BSP_FAILURE;
+}
+
+BSP_RESULT BSP_Sampler_Stop(void)
+{
+    return BSP_SUCCESS;
+}
@@ -0,0 +1,270 @@
+/**
+ * @file   bsp_sensor.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Weather Shield stand-in for the hosted build.
+ *
+ *         Returns synthetic but plausible MS8607 readings that change slowly
+ *         from one read to the next, so the reporting path sees varying values.
+ *
+ *         The resolution setting is modelled too: a read takes as long as the
+ *         real sensor's conversions (rounded up to whole ticks), and the readings
+ *         carry pseudo-random noise of about the datasheet resolution. Like the
+ *         real driver, a pressure read includes a temperature conversion.
+ */
+
+#include "bsp.h"
+
+#include <os.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Readings repeat every SIM_PERIOD reads */
+#define SIM_PERIOD (200U)
+
+/* Pressure and temperature conversion time per OSR (us), and noise (mbar, degC) */
+static const uint32_t SensorPtConversionUs[] = {560U, 1100U, 2170U, 4320U, 8610U, 17200U};
+static const float SensorPressureNoise[]     = {0.11f, 0.062f, 0.039f, 0.028f, 0.021f, 0.016f};
+static const float SensorTemperatureNoise[]  = {0.012f, 0.009f, 0.006f, 0.004f, 0.003f, 0.002f};
+
+/* Humidity conversion time per resolution (us), and noise (%RH) */
+static const uint32_t SensorRhConversionUs[] = {3000U, 5000U, 9000U, 16000U};
+static const float SensorHumidityNoise[]     = {0.2f, 0.1f, 0.07f, 0.04f};
+
+static OS_MUTEX SensorMutex;
+static uint32_t SensorReads;
+static uint32_t SensorSeed;
+static Sensor_Resolution SensorResolution = {Sensor_OSR_8192, Sensor_RH_12Bit};
+
+/* Triangle wave in [-1, 1] */
+static float SensorWave(uint32_t n)
+{
+    uint32_t phase;
+
+    phase = n % SIM_PERIOD;
+
+    if (phase < (SIM_PERIOD / 2U))
+    {
+        return ((float) phase / (float) (SIM_PERIOD / 4U)) - 1.0f;
+    }
+
+    return 3.0f - ((float) phase / (float) (SIM_PERIOD / 4U));
+}
+
+/* Uniform in [-1, 1], a plain LCG is enough for noise */
+static float SensorNoise(void)
+{
+    SensorSeed = (SensorSeed * 1664525U) + 1013904223U;
+
+    return ((float) (SensorSeed >> 8) / (float) (1U << 23)) - 1.0f;
+}
+
+static uint32_t SensorLatencyUs(uint8_t channels)
+{
+    uint32_t latency_us;
+
+    latency_us = 0;
+
+    if ((channels & (SENSOR_CHANNEL_TEMPERATURE | SENSOR_CHANNEL_PRESSURE)) != 0U)
+    {
+        latency_us += SensorPtConversionUs[SensorResolution.osr];
+    }
+
+    if ((channels & SENSOR_CHANNEL_PRESSURE) != 0U)
+    {
+        latency_us += SensorPtConversionUs[SensorResolution.osr];
+    }
+
+    if ((channels & SENSOR_CHANNEL_HUMIDITY) != 0U)
+    {
+        latency_us += SensorRhConversionUs[SensorResolution.rh_resolution];
+    }
+
+    return latency_us;
+}
+
+static bool SensorResolutionIsValid(const Sensor_Resolution* resolution)
+{
+    return ((uint32_t) resolution->osr <= (uint32_t) Sensor_OSR_8192) &&
+           ((uint32_t) resolution->rh_resolution <= (uint32_t) Sensor_RH_12Bit);
+}
+
+/* Only call this function from startup code (single task) */
+BSP_RESULT BSP_Sensor_Init(void)
+{
+    OS_ERR err;
+
+    SensorReads = 0;
+    SensorSeed  = 1;
+
+    OSMutexCreate((OS_MUTEX*) &SensorMutex,
+                  (CPU_CHAR*) "Sensor Mutex",
+                  (OS_ERR*)   &err);
+
+    if (err != OS_ERR_NONE)
+    {
+        return BSP_FAILURE;
+    }
+
+    return BSP_SUCCESS;
+}
+
+BSP_RESULT BSP_Sensor_Reset(Sensor_TypeDef sensor)
+{
+    return (sensor == Sensor_MS8607) ? BSP_SUCCESS : BSP_FAILURE;
+}
+
+BSP_RESULT BSP_Sensor_Read(Sensor_TypeDef sensor, Sensor_Data* data)
+{
+    return BSP_Sensor_ReadChannels(sensor, SENSOR_CHANNEL_ALL, data);
+}
+
+BSP_RESULT BSP_Sensor_ReadChannels(Sensor_TypeDef sensor, uint8_t channels, Sensor_Data* data)
+{
+    OS_ERR err;
+    OS_TICK delay;
+    float wave;
+
+    if ((data == NULL) || (sensor != Sensor_MS8607) || (channels == 0U) || ((channels & ~SENSOR_CHANNEL_ALL) != 0U))
+    {
+        return BSP_FAILURE;
+    }
+
+    OSMutexPend((OS_MUTEX*) &SensorMutex,
+                (OS_TICK)   0,
+                (OS_OPT)    OS_OPT_PEND_BLOCKING,
+                (CPU_TS*)   NULL,
+                (OS_ERR*)   &err);
+
+    if (err != OS_ERR_NONE)
+    {
+        return BSP_FAILURE;
+    }
+
+    data->timestamp_ns = BSP_Timebase_GetNs();
+
+    /* Wait for the conversions, holding the mutex like the real driver */
+    delay = (OS_TICK) (((SensorLatencyUs(channels) * OS_CFG_TICK_RATE_HZ) + 999999U) / 1000000U);
+
+    OSTimeDly((OS_TICK) delay,
+              (OS_OPT)  OS_OPT_TIME_DLY,
+              (OS_ERR*) &err);
+
+    wave = SensorWave(SensorReads++);
+
+    data->temperature          = 22.5f + (1.5f * wave) + (SensorTemperatureNoise[SensorResolution.osr] * SensorNoise());
+    data->temperature_is_valid = ((channels & SENSOR_CHANNEL_TEMPERATURE) != 0U);
+    data->humidity             = 45.0f - (5.0f * wave) + (SensorHumidityNoise[SensorResolution.rh_resolution] * SensorNoise());
+    data->humidity_is_valid    = ((channels & SENSOR_CHANNEL_HUMIDITY) != 0U);
+    data->pressure             = 1013.25f + (0.5f * wave) + (SensorPressureNoise[SensorResolution.osr] * SensorNoise());
+    data->pressure_is_valid    = ((channels & SENSOR_CHANNEL_PRESSURE) != 0U);
+
+    OSMutexPost((OS_MUTEX*) &SensorMutex,
+                (OS_OPT)    OS_OPT_POST_NONE,
+                (OS_ERR*)   &err);
+
+    if (err != OS_ERR_NONE)
+    {
+        return BSP_FAILURE;
+    }
+
+    return BSP_SUCCESS;
+}
+
+BSP_RESULT BSP_Sensor_SetResolution(Sensor_TypeDef sensor, const Sensor_Resolution* resolution)
+{
+    OS_ERR err;
+
+    if ((resolution == NULL) || (sensor != Sensor_MS8607) || (SensorResolutionIsValid(resolution) == false))
+    {
+        return BSP_FAILURE;
+    }
+
+    OSMutexPend((OS_MUTEX*) &SensorMutex,
+                (OS_TICK)   0,
+                (OS_OPT)    OS_OPT_PEND_BLOCKING,
+                (CPU_TS*)   NULL,
+                (OS_ERR*)   &err);
+
+    if (err != OS_ERR_NONE)
+    {
+        return BSP_FAILURE;
+    }
+
+    SensorResolution = *resolution;
+
+    OSMutexPost((OS_MUTEX*) &SensorMutex,
+                (OS_OPT)    OS_OPT_POST_NONE,
+                (OS_ERR*)   &err);
+
+    if (err != OS_ERR_NONE)
+    {
+        return BSP_FAILURE;
+    }
+
+    return BSP_SUCCESS;
+}
+
+BSP_RESULT BSP_Sensor_GetLatency(Sensor_TypeDef sensor, uint32_t* latency_us)
+{
+    OS_ERR err;
+
+    if ((latency_us == NULL) || (sensor != Sensor_MS8607))
+    {
+        return BSP_FAILURE;
+    }
+
+    OSMutexPend((OS_MUTEX*) &SensorMutex,
+                (OS_TICK)   0,
+                (OS_OPT)    OS_OPT_PEND_BLOCKING,
+                (CPU_TS*)   NULL,
+                (OS_ERR*)   &err);
+
+    if (err != OS_ERR_NONE)
+    {
+        return BSP_FAILURE;
+    }
+
+    *latency_us = SensorLatencyUs(SENSOR_CHANNEL_ALL);
+
+    OSMutexPost((OS_MUTEX*) &SensorMutex,
+                (OS_OPT)    OS_OPT_POST_NONE,
+                (OS_ERR*)   &err);
+
+    if (err != OS_ERR_NONE)
+    {
+        return BSP_FAILURE;
+    }
+
+    return BSP_SUCCESS;
+}
+
+/* There is no bus to run at any particular speed */
+BSP_RESULT BSP_Sensor_SetBusSpeed(Sensor_TypeDef sensor, Sensor_BusSpeedTypeDef speed)
+{
+    if ((sensor != Sensor_MS8607) || ((uint32_t) speed > (uint32_t) Sensor_BusSpeed_1MHz))
+    {
+        return BSP_FAILURE;
+    }
+
+    return BSP_SUCCESS;
+}
+
+/* The simulated bus never fails */
+BSP_RESULT BSP_Sensor_GetBusStats(Sensor_BusStats* stats)
+{
+    if (stats == NULL)
+    {
+        return BSP_FAILURE;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+
+    return BSP_SUCCESS;
+}
+
+BSP_RESULT BSP_Sensor_ResetBusStats(void)
+{
+    return BSP_SUCCESS;
+}
@@ -0,0 +1,21 @@
+/**
+ * @file   bsp_sim.h
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Hosted build additions to bsp.h, for the simulated devices.
+ */
+
+#ifndef BSP_SIM_H
+#define BSP_SIM_H
+
+#include <bsp.h>
+
+#include <stdint.h>
+
+/* A simulated interrupt handler, see `BSP_Timebase_Schedule` */
+typedef void (*BSP_SimIrqHandler)(void);
+
+/* bsp_timebase.c */
+void       BSP_Timebase_Busy    (uint64_t duration_ns);
+BSP_RESULT BSP_Timebase_Schedule(BSP_SimIrqHandler handler, uint64_t due_ns);
+
+#endif /* BSP_SIM_H */
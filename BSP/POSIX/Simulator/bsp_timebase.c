@@ -0,0 +1,272 @@
+/**
+ * @file   bsp_timebase.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  64-bit monotonic timebase for the hosted build.
+ *
+ *         Same API as the Nucleo-144 driver, backed by the host monotonic clock
+ *         instead of the tick count and DWT cycle counter.
+ *
+ *         Built with `-DVIRTUAL_TIME=ON` (`BSP_VIRTUAL_TIME`) the clock is virtual instead:
+ *         kernel ticks are not generated by the POSIX port's wall-clock timer (its calls to
+ *         `OSTimeTick` are dropped, see `__wrap_OSTimeTick`) but by the idle task, which
+ *         delivers the next tick as soon as every task is blocked, from a loop that never
+ *         goes back to the port's (sleeping) idle hook. Running code takes no virtual time,
+ *         so a tick lasts as long as the host needs to run what it readied, and a soak test
+ *         runs as fast as the host can go. With only the idle task driving the kernel, the
+ *         order of ticks, task wakeups, and simulated device events is the same on every run.
+ *
+ *         The clock is then the tick count plus the time simulated devices spent busy
+ *         within the tick (`BSP_Timebase_Busy`, e.g. the I2C bus clocks of the MS8607
+ *         model). Like on the board, that part is clamped to less than one tick.
+ *
+ *         SIM_VIRTUAL_SECONDS stops the process after that much virtual time, with the
+ *         host time it took on stderr.
+ *
+ *         Simulated devices raise their interrupts with `BSP_Timebase_Schedule`. The handler
+ *         runs from the first tick at or after the due time, in the tick interrupt, so it
+ *         can post to tasks like an ISR. Handlers due at the same tick run in due time
+ *         order. Tick resolution keeps them on the same footing with and without virtual
+ *         time, and needs nothing from the POSIX port beyond its tick.
+ */
+
+#include "bsp.h"
+#include "bsp_sim.h"
+
+#include <os.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define NS_PER_SEC          (1000000000ULL)
+#define NS_PER_TICK         (NS_PER_SEC / OS_CFG_TICK_RATE_HZ)
+
+/* Pending simulated interrupts, one per device */
+#define TIMEBASE_MAX_EVENTS (4U)
+
+typedef struct
+{
+    BSP_SimIrqHandler handler;
+    uint64_t          due_ns;
+} TimebaseEvent;
+
+static uint64_t TimebaseStartNs;
+
+static TimebaseEvent TimebaseEvents[TIMEBASE_MAX_EVENTS];
+static uint32_t      TimebaseNumEvents;
+
+#if defined(BSP_VIRTUAL_TIME)
+/* The kernel's tick, linked with --wrap=OSTimeTick */
+void __real_OSTimeTick(void);
+
+static volatile uint64_t TimebaseTicks;
+static uint64_t          TimebaseBusyNs;
+static uint64_t          TimebaseStopTicks;
+#endif
+
+static uint64_t Timebase_HostNs(void)
+{
+    struct timespec ts;
+
+    (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t) ts.tv_sec * NS_PER_SEC) + (uint64_t) ts.tv_nsec;
+}
+
+/* Removes and returns the earliest event due by `now_ns`, or NULL */
+static BSP_SimIrqHandler Timebase_NextDue(uint64_t now_ns)
+{
+    BSP_SimIrqHandler handler;
+    uint32_t earliest;
+    uint32_t i;
+    CPU_SR_ALLOC();
+
+    handler  = NULL;
+    earliest = 0;
+
+    CPU_CRITICAL_ENTER();
+
+    for (i = 1; i < TimebaseNumEvents; i++)
+    {
+        if (TimebaseEvents[i].due_ns < TimebaseEvents[earliest].due_ns)
+        {
+            earliest = i;
+        }
+    }
+
+    if ((TimebaseNumEvents > 0U) && (TimebaseEvents[earliest].due_ns <= now_ns))
+    {
+        handler                  = TimebaseEvents[earliest].handler;
+        TimebaseEvents[earliest] = TimebaseEvents[--TimebaseNumEvents];
+    }
+
+    CPU_CRITICAL_EXIT();
+
+    return handler;
+}
+
+void BSP_Timebase_Init(void)
+{
+#if defined(BSP_VIRTUAL_TIME)
+    const char* p_env;
+
+    TimebaseTicks     = 0;
+    TimebaseBusyNs    = 0;
+    TimebaseStopTicks = 0;
+
+    p_env = getenv("SIM_VIRTUAL_SECONDS");
+
+    if (p_env != NULL)
+    {
+        TimebaseStopTicks = strtoull(p_env, NULL, 10) * OS_CFG_TICK_RATE_HZ;
+    }
+#endif
+
+    TimebaseStartNs = Timebase_HostNs();
+}
+
+/* Called from the tick hook, only the virtual clock counts ticks, the host clock is read directly */
+void BSP_Timebase_Tick(void)
+{
+    BSP_SimIrqHandler handler;
+#if defined(BSP_VIRTUAL_TIME)
+    double host_s;
+
+    TimebaseTicks++;
+    TimebaseBusyNs = 0;
+
+    if ((TimebaseStopTicks > 0U) && (TimebaseTicks >= TimebaseStopTicks))
+    {
+        host_s = (double) (Timebase_HostNs() - TimebaseStartNs) / (double) NS_PER_SEC;
+
+        fprintf(stderr, "Simulated %llu s in %.1f s (x%.0f)\n",
+                (unsigned long long) (TimebaseTicks / OS_CFG_TICK_RATE_HZ), host_s,
+                (double) TimebaseTicks / (double) OS_CFG_TICK_RATE_HZ / host_s);
+
+        exit(EXIT_SUCCESS);
+    }
+#endif
+
+    /* A handler may schedule its next event, which only runs if it is already due */
+    handler = Timebase_NextDue(BSP_Timebase_GetNs());
+
+    while (handler != NULL)
+    {
+        handler();
+        handler = Timebase_NextDue(BSP_Timebase_GetNs());
+    }
+}
+
+/*
+ * Called from the idle task hook, every task is blocked so the next tick can come right away.
+ *
+ * With the virtual clock this never returns: the POSIX port's OSIdleTaskHook sleeps after the
+ * application hook, which would cost host time on every tick. The idle task only gets back
+ * here once every task is blocked again, at which point the next tick is due. The kernel's
+ * idle counter stops counting as a result, so the statistics task reports full CPU usage.
+ */
+void BSP_Timebase_Idle(void)
+{
+#if defined(BSP_VIRTUAL_TIME)
+    OS_ERR err;
+
+    while (1)
+    {
+        /* Like at the end of the tick interrupt, the tasks it readied only run once it is done */
+        OSSchedLock(&err);
+        __real_OSTimeTick();
+        OSSchedUnlock(&err);
+    }
+#endif
+}
+
+uint64_t BSP_Timebase_GetNs(void)
+{
+#if defined(BSP_VIRTUAL_TIME)
+    uint64_t ticks;
+    uint64_t busy_ns;
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    ticks   = TimebaseTicks;
+    busy_ns = TimebaseBusyNs;
+    CPU_CRITICAL_EXIT();
+
+    if (busy_ns >= NS_PER_TICK)
+    {
+        busy_ns = NS_PER_TICK - 1U;
+    }
+
+    return (ticks * NS_PER_TICK) + busy_ns;
+#else
+    return Timebase_HostNs() - TimebaseStartNs;
+#endif
+}
+
+/* A simulated device busy for `duration_ns`, a busy wait unless the time is virtual */
+void BSP_Timebase_Busy(uint64_t duration_ns)
+{
+#if defined(BSP_VIRTUAL_TIME)
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    TimebaseBusyNs += duration_ns;
+    CPU_CRITICAL_EXIT();
+#else
+    uint64_t end_ns;
+
+    end_ns = BSP_Timebase_GetNs() + duration_ns;
+
+    while (BSP_Timebase_GetNs() < end_ns)
+    {
+    }
+#endif
+}
+
+/* Runs `handler` from the first tick at or after `due_ns`, replacing its pending event if it has one */
+BSP_RESULT BSP_Timebase_Schedule(BSP_SimIrqHandler handler, uint64_t due_ns)
+{
+    uint32_t i;
+    BSP_RESULT result;
+    CPU_SR_ALLOC();
+
+    if (handler == NULL)
+    {
+        return BSP_FAILURE;
+    }
+
+    result = BSP_SUCCESS;
+
+    CPU_CRITICAL_ENTER();
+
+    for (i = 0; (i < TimebaseNumEvents) && (TimebaseEvents[i].handler != handler); i++)
+    {
+    }
+
+    if (i < TimebaseNumEvents)
+    {
+        TimebaseEvents[i].due_ns = due_ns;
+    }
+    else if (TimebaseNumEvents < TIMEBASE_MAX_EVENTS)
+    {
+        TimebaseEvents[TimebaseNumEvents].handler = handler;
+        TimebaseEvents[TimebaseNumEvents].due_ns  = due_ns;
+        TimebaseNumEvents++;
+    }
+    else
+    {
+        result = BSP_FAILURE;
+    }
+
+    CPU_CRITICAL_EXIT();
+
+    return result;
+}
+
+#if defined(BSP_VIRTUAL_TIME)
+/* The POSIX port's wall-clock tick, dropped so only BSP_Timebase_Idle moves time */
+void __wrap_OSTimeTick(void)
+{
+}
+#endif
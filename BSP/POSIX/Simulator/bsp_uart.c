@@ -0,0 +1,238 @@
+/**
+ * @file   bsp_uart.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  UART stand-in for the hosted build.
+ *
+ *         Writes transmitted bytes to stdout, or with SIM_UART_PTY set, to a pseudo-terminal
+ *         so `make serial-console` and `make telemetry-console` work against the simulator.
+ *         The pty name is printed on stderr, and if SIM_UART_PTY is a path a symlink to it
+ *         is created there (e.g. SIM_UART_PTY=/tmp/weather-uart, then
+ *         `make serial-console SERIAL_PORT=/tmp/weather-uart`). The pty is raw, so binary
+ *         telemetry frames pass unchanged. Like a wire without a listener, bytes that do
+ *         not fit in the pty while no console reads them are dropped.
+ *
+ *         With a line rate (SIM_UART_BAUD, 115200 by default on the pty, none on stdout) the
+ *         line is modelled like the board's USART3 (8N1, 10 bits per byte): a transmission
+ *         starts when the previous one has left the line, and the transmit completes once its
+ *         last stop bit has been sent. Simulated interrupts only come at ticks, so the task
+ *         pends on a semaphore posted from the last tick before that (`BSP_Timebase_Schedule`)
+ *         and spends the rest like a busy device (`BSP_Timebase_Busy`): waited out on the
+ *         host clock, added to the busy time on the virtual clock, never rounded up to the
+ *         next tick. Without a line rate the write completes before returning, so there is
+ *         nothing to pend on and the timeout is unused.
+ *
+ *         Like the Nucleo-144 driver, this driver should only be used by a single task.
+ */
+
+#include "bsp.h"
+#include "bsp_sim.h"
+
+#include <os.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define UART_PTY_BAUD      (115200UL)
+#define UART_BITS_PER_BYTE (10U)
+#define NS_PER_SEC         (1000000000ULL)
+#define NS_PER_TICK        (NS_PER_SEC / OS_CFG_TICK_RATE_HZ)
+
+static int      UartFd = STDOUT_FILENO;
+static uint32_t UartBaud;
+static uint64_t UartLineFreeNs;
+static OS_SEM   UartSemaphore;
+
+/* The last tick before the last stop bit is sent */
+static void UartTxTick(void)
+{
+    OS_ERR err;
+
+    OSSemPost((OS_SEM*) &UartSemaphore,
+              (OS_OPT)  OS_OPT_POST_1,
+              (OS_ERR*) &err);
+}
+
+static BSP_RESULT UartOpenPty(const char* p_link)
+{
+    struct termios tio;
+    const char* p_name;
+    int slave_fd;
+
+    UartFd = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if ((UartFd < 0) || (grantpt(UartFd) != 0) || (unlockpt(UartFd) != 0))
+    {
+        return BSP_FAILURE;
+    }
+
+    p_name = ptsname(UartFd);
+
+    if (p_name == NULL)
+    {
+        return BSP_FAILURE;
+    }
+
+    /* Kept open so the pty outlives consoles coming and going, and made raw for binary frames */
+    slave_fd = open(p_name, O_RDWR | O_NOCTTY);
+
+    if ((slave_fd < 0) || (tcgetattr(slave_fd, &tio) != 0))
+    {
+        return BSP_FAILURE;
+    }
+
+    cfmakeraw(&tio);
+
+    if ((tcsetattr(slave_fd, TCSANOW, &tio) != 0) || (fcntl(UartFd, F_SETFL, O_NONBLOCK) != 0))
+    {
+        return BSP_FAILURE;
+    }
+
+    if (p_link[0] != '\0')
+    {
+        (void) unlink(p_link);
+
+        if (symlink(p_name, p_link) != 0)
+        {
+            return BSP_FAILURE;
+        }
+    }
+
+    fprintf(stderr, "UART on %s\n", p_name);
+
+    return BSP_SUCCESS;
+}
+
+static BSP_RESULT UartWrite(const uint8_t* data, size_t size)
+{
+    ssize_t n_bytes;
+
+    while (size > 0U)
+    {
+        n_bytes = write(UartFd, data, size);
+
+        /* The pty is full and nobody reads it, the rest is lost on the line */
+        if ((n_bytes < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+        {
+            return BSP_SUCCESS;
+        }
+
+        if (n_bytes <= 0)
+        {
+            return BSP_FAILURE;
+        }
+
+        data += n_bytes;
+        size -= (size_t) n_bytes;
+    }
+
+    return BSP_SUCCESS;
+}
+
+BSP_RESULT BSP_UART_Init(void)
+{
+    OS_ERR err;
+    const char* p_env;
+
+    UartBaud = 0;
+    p_env    = getenv("SIM_UART_PTY");
+
+    if (p_env != NULL)
+    {
+        if (UartOpenPty(p_env) != BSP_SUCCESS)
+        {
+            return BSP_FAILURE;
+        }
+
+        UartBaud = UART_PTY_BAUD;
+    }
+
+    p_env = getenv("SIM_UART_BAUD");
+
+    if (p_env != NULL)
+    {
+        UartBaud = (uint32_t) strtoul(p_env, NULL, 10);
+    }
+
+    OSSemCreate(&UartSemaphore, "UART Semaphore", 0, &err);
+
+    if (err != OS_ERR_NONE)
+    {
+        return BSP_FAILURE;
+    }
+
+    return BSP_SUCCESS;
+}
+
+BSP_RESULT BSP_UART_Transmit(uint8_t* data, size_t size, OS_TICK timeout)
+{
+    OS_ERR err;
+    uint64_t now_ns;
+    uint64_t tick_ns;
+
+    if (UartWrite(data, size) != BSP_SUCCESS)
+    {
+        return BSP_FAILURE;
+    }
+
+    if (UartBaud == 0U)
+    {
+        return BSP_SUCCESS;
+    }
+
+    /* Drop a completion left over from a transmission that timed out */
+    OSSemSet((OS_SEM*)    &UartSemaphore,
+             (OS_SEM_CTR) 0,
+             (OS_ERR*)    &err);
+
+    /* Queued behind whatever is still on the line */
+    now_ns = BSP_Timebase_GetNs();
+
+    if (UartLineFreeNs < now_ns)
+    {
+        UartLineFreeNs = now_ns;
+    }
+
+    UartLineFreeNs += ((uint64_t) size * UART_BITS_PER_BYTE * NS_PER_SEC) / UartBaud;
+
+#if defined(BSP_VIRTUAL_TIME)
+    /* Virtual ticks are whole multiples of the tick period */
+    tick_ns = UartLineFreeNs - (UartLineFreeNs % NS_PER_TICK);
+#else
+    /* Host ticks can fall anywhere, the first one a period early is never late */
+    tick_ns = (UartLineFreeNs > NS_PER_TICK) ? (UartLineFreeNs - NS_PER_TICK) : 0U;
+#endif
+
+    /* Otherwise the interrupt would only come at the next tick, after the line is free */
+    if (tick_ns > now_ns)
+    {
+        if (BSP_Timebase_Schedule(UartTxTick, tick_ns) != BSP_SUCCESS)
+        {
+            return BSP_FAILURE;
+        }
+
+        OSSemPend((OS_SEM*) &UartSemaphore,
+                  (OS_TICK) timeout,
+                  (OS_OPT)  OS_OPT_PEND_BLOCKING,
+                  (CPU_TS*) NULL,
+                  (OS_ERR*) &err);
+
+        if (err != OS_ERR_NONE)
+        {
+            return BSP_FAILURE;
+        }
+    }
+
+    now_ns = BSP_Timebase_GetNs();
+
+    if (now_ns < UartLineFreeNs)
+    {
+        BSP_Timebase_Busy(UartLineFreeNs - now_ns);
+    }
+
+    return BSP_SUCCESS;
+}
@@ -0,0 +1,784 @@
+/**
+ * @file   ms8607_model.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  MS8607 device model behind the hosted I2C shims.
+ *
+ *         Built with `-DSHIELD_MODEL=ON`, which runs the real sensor path (Nucleo-144
+ *         bsp_sensor.c, the TE driver, ms8607_raw.c, and i2c.c) against this model
+ *         instead of using the stand-in bsp_sensor.c. i2c.c hands every transfer to it,
+ *         and it answers like the two devices in the MS8607:
+ *
+ *             - Pressure and temperature (0x76): reset, PROM read (the datasheet example
+ *               coefficients, with their CRC-4 in C0), D1/D2 conversions that take the
+ *               datasheet time of their OSR, and the ADC read, which returns 0 if the
+ *               conversion has not finished or was already read.
+ *             - Humidity (0x40): reset, user register read and write (the resolution
+ *               bits set the conversion time and the ADC resolution), the no-hold
+ *               measurement, which NACKs reads until it has finished, and the hold
+ *               measurement, which stretches the read until it has finished. The result
+ *               carries the status bits and the CRC-8.
+ *
+ *         Anything else, including other addresses, is NACKed. Transfers take as long
+ *         as their bits at the SCL speed i2c.c selected (`BSP_Timebase_Busy`, like the
+ *         polled HAL transfers). All timing uses BSP_Timebase_GetNs, so it follows the
+ *         virtual clock too.
+ *
+ *         The ADC words are found by bisection through the fixed point compensation
+ *         (ms8607_comp.c) with the model's own PROM, so the driver reads back exactly
+ *         the environment of the model, to 0.01, at the moment each conversion started.
+ *         The environment is a slow sine around room conditions, a script set with
+ *         `ms8607_model_set_script`, or a trace recorded with `telemetry.py --csv` when
+ *         SHIELD_MODEL_TRACE names one. Traces are interpolated, loop, and a channel
+ *         left empty keeps its previous value.
+ *
+ *         Faults are injected at random with the rates of `ms8607_model_set_faults`, or
+ *         of SHIELD_MODEL_FAULTS at start (e.g. "nack=1000,stuck=10,seed=7", rates in
+ *         ppm of transfers). A timed out transfer returns MS8607_Model_Timeout once; a
+ *         stuck bus times out every transfer until i2c.c recovers it.
+ *
+ *         References:
+ *             - TE Connectivity MS8607-02BA01 datasheet, "PT Commands", "PROM CRC", "RH
+ *               Commands", "User register", and "CRC-8 checksum calculation".
+ */
+
+#include "ms8607_model.h"
+
+#include <os.h>
+#include <bsp.h>
+#include <bsp_sim.h>
+#include <ms8607_comp.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define PT_ADDR                   (0x76U)
+#define PT_CMD_RESET              (0x1EU)
+#define PT_CMD_CONVERT_D1         (0x40U)
+#define PT_CMD_CONVERT_D2         (0x50U)
+#define PT_CMD_ADC_READ           (0x00U)
+#define PT_CMD_PROM_READ          (0xA0U)
+#define PT_NUM_OSR                (6U)
+
+/* OSR of a conversion command, word of a PROM read command */
+#define PT_CMD_INDEX(cmd)         (((cmd) & 0x0EU) >> 1)
+
+#define RH_ADDR                   (0x40U)
+#define RH_CMD_RESET              (0xFEU)
+#define RH_CMD_WRITE_USER_REG     (0xE6U)
+#define RH_CMD_READ_USER_REG      (0xE7U)
+#define RH_CMD_MEASURE_HOLD       (0xE5U)
+#define RH_CMD_MEASURE_NO_HOLD    (0xF5U)
+#define RH_USER_REG_DEFAULT       (0x02U)
+#define RH_USER_REG_WRITABLE      (0x85U) /* Resolution (bits 7 and 0) and heater */
+#define RH_STATUS_HUMIDITY        (0x0002U)
+
+#define NS_PER_US                 (1000ULL)
+#define NS_PER_TICK               (1000000000ULL / OS_CFG_TICK_RATE_HZ)
+
+/* Default environment, one sine period per MODEL_PERIOD_NS */
+#define MODEL_PERIOD_NS           (60000000000ULL)
+#define MODEL_TEMPERATURE         (22.5f)
+#define MODEL_PRESSURE            (1013.25f)
+#define MODEL_HUMIDITY            (45.0f)
+
+typedef enum
+{
+    ModelWord_D1,
+    ModelWord_D2,
+    ModelWord_D3,
+} ModelWord;
+
+typedef struct
+{
+    uint8_t  answer[3];     /* What the next read returns              */
+    uint16_t answer_size;
+    uint32_t adc;           /* Result of the last conversion           */
+    uint64_t ready_ns;      /* End of the last conversion              */
+    bool     is_converting; /* Result not read yet                     */
+    bool     hold;          /* Humidity hold mode, reads wait for it   */
+} ModelDevice;
+
+typedef struct
+{
+    uint64_t time_ns;
+    float    temperature;
+    float    pressure;
+    float    humidity;
+} ModelTracePoint;
+
+/* Datasheet example coefficients C1-C6, C0 is filled in with the CRC */
+static const uint16_t ModelCoefficients[MS8607_PROM_WORDS] = {0, 46372, 43981, 29059, 27842, 31553, 28165};
+
+/* Pressure and temperature conversion time per OSR (us) */
+static const uint32_t ModelPtConversionUs[PT_NUM_OSR] = {560U, 1100U, 2170U, 4320U, 8610U, 17200U};
+
+static MS8607_Prom  ModelProm;
+static ModelDevice  ModelPt;
+static ModelDevice  ModelRh;
+static uint8_t      ModelRhUserReg;
+static uint32_t     ModelSclKhz;
+
+static MS8607_Model_Script ModelScript;
+static ModelTracePoint*    ModelTrace;
+static uint32_t            ModelTraceSize;
+static uint32_t            ModelTraceIndex;
+
+static MS8607_Model_Faults ModelFaults;
+static MS8607_Model_Stats  ModelStats;
+static uint32_t            ModelSeed;
+static bool                ModelBusIsStuck;
+
+/* A plain LCG, fault injection only needs to be repeatable */
+static uint32_t Random(void)
+{
+    ModelSeed = (ModelSeed * 1664525U) + 1013904223U;
+
+    return ModelSeed;
+}
+
+static bool Chance(uint32_t ppm)
+{
+    return (ppm > 0U) && ((uint32_t) (((uint64_t) Random() * 1000000ULL) >> 32) < ppm);
+}
+
+static void DefaultScript(uint64_t time_ns, float* p_temperature, float* p_pressure, float* p_humidity)
+{
+    float wave;
+
+    wave = sinf(6.2831853f * (float) (time_ns % MODEL_PERIOD_NS) / (float) MODEL_PERIOD_NS);
+
+    *p_temperature = MODEL_TEMPERATURE + (1.5f * wave);
+    *p_pressure    = MODEL_PRESSURE + (0.5f * wave);
+    *p_humidity    = MODEL_HUMIDITY - (5.0f * wave);
+}
+
+/* Linear interpolation between the trace points around `time_ns`, the trace loops */
+static void TraceScript(uint64_t time_ns, float* p_temperature, float* p_pressure, float* p_humidity)
+{
+    const ModelTracePoint* p_a;
+    const ModelTracePoint* p_b;
+    uint64_t duration_ns;
+    uint64_t t_ns;
+    float frac;
+
+    duration_ns = ModelTrace[ModelTraceSize - 1U].time_ns - ModelTrace[0].time_ns;
+    t_ns        = ModelTrace[0].time_ns + ((duration_ns > 0U) ? (time_ns % duration_ns) : 0U);
+
+    /* Time only moves forward, except when the trace starts over */
+    if (t_ns < ModelTrace[ModelTraceIndex].time_ns)
+    {
+        ModelTraceIndex = 0;
+    }
+
+    while (((ModelTraceIndex + 1U) < ModelTraceSize) && (ModelTrace[ModelTraceIndex + 1U].time_ns <= t_ns))
+    {
+        ModelTraceIndex++;
+    }
+
+    p_a = &ModelTrace[ModelTraceIndex];
+    p_b = ((ModelTraceIndex + 1U) < ModelTraceSize) ? &ModelTrace[ModelTraceIndex + 1U] : p_a;
+
+    frac = (p_b->time_ns > p_a->time_ns) ? ((float) (t_ns - p_a->time_ns) / (float) (p_b->time_ns - p_a->time_ns)) : 0.0f;
+
+    *p_temperature = p_a->temperature + (frac * (p_b->temperature - p_a->temperature));
+    *p_pressure    = p_a->pressure + (frac * (p_b->pressure - p_a->pressure));
+    *p_humidity    = p_a->humidity + (frac * (p_b->humidity - p_a->humidity));
+}
+
+/* One CSV field, an empty one (not valid in the recording) leaves `*p_value` as it was */
+static const char* ParseField(const char* p_field, float* p_value)
+{
+    char* p_end;
+    float value;
+
+    value = strtof(p_field, &p_end);
+
+    if (p_end != p_field)
+    {
+        *p_value = value;
+    }
+
+    return (*p_end == ',') ? (p_end + 1) : p_end;
+}
+
+/* Loads a `telemetry.py --csv` trace (timestamp_ns,temperature,humidity,pressure) */
+static bool LoadTrace(const char* p_path)
+{
+    FILE* p_file;
+    char line[128];
+    char* p_end;
+    const char* p_field;
+    ModelTracePoint point;
+    ModelTracePoint* p_trace;
+    uint32_t capacity;
+
+    p_file = fopen(p_path, "r");
+
+    if (p_file == NULL)
+    {
+        return false;
+    }
+
+    point.temperature = MODEL_TEMPERATURE;
+    point.pressure    = MODEL_PRESSURE;
+    point.humidity    = MODEL_HUMIDITY;
+    capacity          = 0;
+
+    while (fgets(line, sizeof(line), p_file) != NULL)
+    {
+        point.time_ns = strtoull(line, &p_end, 10);
+
+        /* Header */
+        if ((p_end == line) || (*p_end != ','))
+        {
+            continue;
+        }
+
+        p_field = ParseField(p_end + 1, &point.temperature);
+        p_field = ParseField(p_field, &point.humidity);
+        (void) ParseField(p_field, &point.pressure);
+
+        /* Out of order samples would make the playback jump back */
+        if ((ModelTraceSize > 0U) && (point.time_ns < ModelTrace[ModelTraceSize - 1U].time_ns))
+        {
+            continue;
+        }
+
+        if (ModelTraceSize == capacity)
+        {
+            capacity = (capacity == 0U) ? 256U : (capacity * 2U);
+            p_trace  = realloc(ModelTrace, capacity * sizeof(ModelTracePoint));
+
+            if (p_trace == NULL)
+            {
+                break;
+            }
+
+            ModelTrace = p_trace;
+        }
+
+        ModelTrace[ModelTraceSize++] = point;
+    }
+
+    (void) fclose(p_file);
+
+    return ModelTraceSize > 0U;
+}
+
+/* "name=value,..." with the names of the MS8607_Model_Faults fields, without the _ppm */
+static void ParseFaults(const char* p_spec, MS8607_Model_Faults* p_faults)
+{
+    char name[16];
+    unsigned long value;
+    int length;
+
+    while (sscanf(p_spec, " %15[a-z] = %lu%n", name, &value, &length) == 2)
+    {
+        if (strcmp(name, "nack") == 0)
+        {
+            p_faults->nack_ppm = (uint32_t) value;
+        }
+        else if (strcmp(name, "timeout") == 0)
+        {
+            p_faults->timeout_ppm = (uint32_t) value;
+        }
+        else if (strcmp(name, "stuck") == 0)
+        {
+            p_faults->stuck_ppm = (uint32_t) value;
+        }
+        else if (strcmp(name, "corrupt") == 0)
+        {
+            p_faults->corrupt_ppm = (uint32_t) value;
+        }
+        else if (strcmp(name, "seed") == 0)
+        {
+            p_faults->seed = (uint32_t) value;
+        }
+        else
+        {
+            fprintf(stderr, "SHIELD_MODEL_FAULTS: unknown fault \"%s\"\n", name);
+        }
+
+        p_spec += length;
+
+        if (*p_spec != ',')
+        {
+            break;
+        }
+
+        p_spec++;
+    }
+}
+
+static int32_t CompensatedValue(const MS8607_Raw* p_raw, ModelWord word)
+{
+    MS8607_Result result;
+
+    ms8607_comp_fixed(&ModelProm, p_raw, &result);
+
+    switch (word)
+    {
+    case ModelWord_D1:
+        return result.pressure;
+
+    case ModelWord_D2:
+        return result.temperature;
+
+    default:
+        return result.humidity;
+    }
+}
+
+static void SetWord(MS8607_Raw* p_raw, ModelWord word, uint32_t value)
+{
+    switch (word)
+    {
+    case ModelWord_D1:
+        p_raw->d1 = value;
+        break;
+
+    case ModelWord_D2:
+        p_raw->d2 = value;
+        break;
+
+    default:
+        p_raw->d3 = (uint16_t) value;
+        break;
+    }
+}
+
+/* Smallest ADC word that compensates to at least `target` (0.01 units), each value rises with its word */
+static void SolveWord(MS8607_Raw* p_raw, ModelWord word, int32_t target)
+{
+    uint32_t low;
+    uint32_t high;
+    uint32_t mid;
+
+    low  = 0;
+    high = (word == ModelWord_D3) ? 0xFFFFU : 0xFFFFFFU;
+
+    while (low < high)
+    {
+        mid = low + ((high - low) / 2U);
+        SetWord(p_raw, word, mid);
+
+        if (CompensatedValue(p_raw, word) < target)
+        {
+            low = mid + 1U;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    SetWord(p_raw, word, low);
+}
+
+static int32_t Centi(float value)
+{
+    return (int32_t) lroundf(value * 100.0f);
+}
+
+/* ADC words for the environment right now, temperature first since the others are compensated with it */
+static void SampleEnvironment(MS8607_Raw* p_raw)
+{
+    float temperature;
+    float pressure;
+    float humidity;
+
+    ModelScript(BSP_Timebase_GetNs(), &temperature, &pressure, &humidity);
+
+    p_raw->d1 = 0;
+    p_raw->d3 = 0;
+
+    SolveWord(p_raw, ModelWord_D2, Centi(temperature));
+    SolveWord(p_raw, ModelWord_D1, Centi(pressure));
+    SolveWord(p_raw, ModelWord_D3, Centi(humidity));
+}
+
+static void SetAnswer(ModelDevice* p_device, uint32_t value, uint16_t size)
+{
+    uint16_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        p_device->answer[i] = (uint8_t) (value >> (8U * (size - 1U - i)));
+    }
+
+    p_device->answer_size = size;
+}
+
+/* The bits of a transfer: START, address, data bytes, an ACK bit after each, and STOP */
+static void ClockBus(uint16_t size)
+{
+    BSP_Timebase_Busy((((uint64_t) size + 1U) * 9U + 2U) * 1000000ULL / ModelSclKhz);
+}
+
+static MS8607_Model_Result InjectFault(void)
+{
+    if (ModelBusIsStuck == true)
+    {
+        ModelStats.num_timeouts++;
+        return MS8607_Model_Timeout;
+    }
+
+    if (Chance(ModelFaults.stuck_ppm) == true)
+    {
+        ModelBusIsStuck = true;
+        ModelStats.num_stuck++;
+        ModelStats.num_timeouts++;
+        return MS8607_Model_Timeout;
+    }
+
+    if (Chance(ModelFaults.timeout_ppm) == true)
+    {
+        ModelStats.num_timeouts++;
+        return MS8607_Model_Timeout;
+    }
+
+    if (Chance(ModelFaults.nack_ppm) == true)
+    {
+        ModelStats.num_nacks++;
+        return MS8607_Model_NACK;
+    }
+
+    return MS8607_Model_OK;
+}
+
+static void StartConversion(ModelDevice* p_device, uint32_t adc, uint32_t conversion_us, bool hold)
+{
+    p_device->adc           = adc;
+    p_device->ready_ns      = BSP_Timebase_GetNs() + (conversion_us * NS_PER_US);
+    p_device->is_converting = true;
+    p_device->hold          = hold;
+    p_device->answer_size   = 0;
+}
+
+static MS8607_Model_Result PtWrite(const uint8_t* p_data, uint16_t size)
+{
+    MS8607_Raw raw;
+    uint8_t cmd;
+
+    /* Address only, how the TE driver probes for the sensor */
+    if (size == 0U)
+    {
+        return MS8607_Model_OK;
+    }
+
+    cmd = p_data[0];
+
+    if ((size == 1U) && (cmd == PT_CMD_RESET))
+    {
+        memset(&ModelPt, 0, sizeof(ModelPt));
+    }
+    else if ((size == 1U) && (cmd == PT_CMD_ADC_READ))
+    {
+        /* 0 if the conversion is still running or its result was already read */
+        SetAnswer(&ModelPt, ((ModelPt.is_converting == true) && (BSP_Timebase_GetNs() >= ModelPt.ready_ns)) ? ModelPt.adc : 0U, 3U);
+        ModelPt.is_converting = false;
+    }
+    else if ((size == 1U) && ((cmd & 0xF1U) == PT_CMD_CONVERT_D1) && (PT_CMD_INDEX(cmd) < PT_NUM_OSR))
+    {
+        SampleEnvironment(&raw);
+        StartConversion(&ModelPt, raw.d1, ModelPtConversionUs[PT_CMD_INDEX(cmd)], false);
+    }
+    else if ((size == 1U) && ((cmd & 0xF1U) == PT_CMD_CONVERT_D2) && (PT_CMD_INDEX(cmd) < PT_NUM_OSR))
+    {
+        SampleEnvironment(&raw);
+        StartConversion(&ModelPt, raw.d2, ModelPtConversionUs[PT_CMD_INDEX(cmd)], false);
+    }
+    else if ((size == 1U) && ((cmd & 0xF1U) == PT_CMD_PROM_READ) && (PT_CMD_INDEX(cmd) < MS8607_PROM_WORDS))
+    {
+        SetAnswer(&ModelPt, ModelProm.c[PT_CMD_INDEX(cmd)], 2U);
+    }
+    else
+    {
+        return MS8607_Model_NACK;
+    }
+
+    return MS8607_Model_OK;
+}
+
+/* Conversion time and ADC bits of the resolution in the user register (bits 7 and 0) */
+static uint32_t RhConversionUs(uint32_t* p_bits)
+{
+    switch (ModelRhUserReg & 0x81U)
+    {
+    case 0x01U:
+        *p_bits = 8U;
+        return 3000U;
+
+    case 0x80U:
+        *p_bits = 10U;
+        return 5000U;
+
+    case 0x81U:
+        *p_bits = 11U;
+        return 9000U;
+
+    default:
+        *p_bits = 12U;
+        return 16000U;
+    }
+}
+
+static MS8607_Model_Result RhWrite(const uint8_t* p_data, uint16_t size)
+{
+    MS8607_Raw raw;
+    uint32_t conversion_us;
+    uint32_t bits;
+    uint8_t cmd;
+
+    if (size == 0U)
+    {
+        return MS8607_Model_OK;
+    }
+
+    cmd = p_data[0];
+
+    if ((size == 1U) && (cmd == RH_CMD_RESET))
+    {
+        memset(&ModelRh, 0, sizeof(ModelRh));
+        ModelRhUserReg = RH_USER_REG_DEFAULT;
+    }
+    else if ((size == 1U) && (cmd == RH_CMD_READ_USER_REG))
+    {
+        SetAnswer(&ModelRh, ModelRhUserReg, 1U);
+    }
+    else if ((size == 2U) && (cmd == RH_CMD_WRITE_USER_REG))
+    {
+        ModelRhUserReg = (uint8_t) ((p_data[1] & RH_USER_REG_WRITABLE) | (ModelRhUserReg & ~RH_USER_REG_WRITABLE));
+    }
+    else if ((size == 1U) && ((cmd == RH_CMD_MEASURE_HOLD) || (cmd == RH_CMD_MEASURE_NO_HOLD)))
+    {
+        SampleEnvironment(&raw);
+        conversion_us = RhConversionUs(&bits);
+
+        /* Only the top bits of the resolution, the two lowest bits are status */
+        raw.d3 = (uint16_t) ((raw.d3 & (0xFFFFU << (16U - bits))) | RH_STATUS_HUMIDITY);
+
+        StartConversion(&ModelRh, raw.d3, conversion_us, (cmd == RH_CMD_MEASURE_HOLD));
+    }
+    else
+    {
+        return MS8607_Model_NACK;
+    }
+
+    return MS8607_Model_OK;
+}
+
+static MS8607_Model_Result RhRead(void)
+{
+    OS_ERR err;
+    uint64_t now_ns;
+    uint8_t word[2];
+
+    if (ModelRh.is_converting == false)
+    {
+        /* Nothing to read unless a register read was asked for */
+        return (ModelRh.answer_size > 0U) ? MS8607_Model_OK : MS8607_Model_NACK;
+    }
+
+    now_ns = BSP_Timebase_GetNs();
+
+    if (now_ns < ModelRh.ready_ns)
+    {
+        if (ModelRh.hold == false)
+        {
+            return MS8607_Model_NACK;
+        }
+
+        /* Hold mode, the sensor stretches SCL until the measurement is done */
+        OSTimeDly((OS_TICK) ((ModelRh.ready_ns - now_ns + NS_PER_TICK - 1U) / NS_PER_TICK),
+                  (OS_OPT)  OS_OPT_TIME_DLY,
+                  (OS_ERR*) &err);
+    }
+
+    word[0] = (uint8_t) (ModelRh.adc >> 8);
+    word[1] = (uint8_t) ModelRh.adc;
+
+    SetAnswer(&ModelRh, ((uint32_t) word[0] << 16) | ((uint32_t) word[1] << 8) | ms8607_rh_crc(word, 2U), 3U);
+    ModelRh.is_converting = false;
+
+    return MS8607_Model_OK;
+}
+
+/* Only call from startup code (single task), before the first transfer */
+void ms8607_model_init(void)
+{
+    const char* p_env;
+    uint32_t i;
+
+    for (i = 0; i < MS8607_PROM_WORDS; i++)
+    {
+        ModelProm.c[i] = ModelCoefficients[i];
+    }
+
+    ModelProm.c[0] = (uint16_t) ((ModelProm.c[0] & 0x0FFFU) | ((uint16_t) ms8607_prom_crc(&ModelProm) << 12));
+
+    memset(&ModelPt, 0, sizeof(ModelPt));
+    memset(&ModelRh, 0, sizeof(ModelRh));
+    ModelRhUserReg = RH_USER_REG_DEFAULT;
+    ModelSclKhz    = 100U;
+    ModelScript    = DefaultScript;
+
+    p_env = getenv("SHIELD_MODEL_TRACE");
+
+    if (p_env != NULL)
+    {
+        if (LoadTrace(p_env) == true)
+        {
+            ModelScript = TraceScript;
+        }
+        else
+        {
+            fprintf(stderr, "SHIELD_MODEL_TRACE: cannot load \"%s\", using the default environment\n", p_env);
+        }
+    }
+
+    memset(&ModelFaults, 0, sizeof(ModelFaults));
+    p_env = getenv("SHIELD_MODEL_FAULTS");
+
+    if (p_env != NULL)
+    {
+        ParseFaults(p_env, &ModelFaults);
+    }
+
+    ms8607_model_set_faults(&ModelFaults);
+}
+
+/* Only call with the sensor mutex held, like every transfer in i2c.c */
+MS8607_Model_Result ms8607_model_write(uint16_t address, const uint8_t* p_data, uint16_t size)
+{
+    MS8607_Model_Result result;
+
+    ModelStats.num_transfers++;
+
+    result = InjectFault();
+
+    if (result != MS8607_Model_OK)
+    {
+        return result;
+    }
+
+    if (address == PT_ADDR)
+    {
+        result = PtWrite(p_data, size);
+    }
+    else if (address == RH_ADDR)
+    {
+        result = RhWrite(p_data, size);
+    }
+    else
+    {
+        result = MS8607_Model_NACK;
+    }
+
+    ClockBus((result == MS8607_Model_OK) ? size : 0U);
+
+    return result;
+}
+
+/* Only call with the sensor mutex held, like every transfer in i2c.c */
+MS8607_Model_Result ms8607_model_read(uint16_t address, uint8_t* p_data, uint16_t size)
+{
+    MS8607_Model_Result result;
+    ModelDevice* p_device;
+    uint16_t i;
+    uint32_t bit;
+
+    ModelStats.num_transfers++;
+
+    result = InjectFault();
+
+    if (result != MS8607_Model_OK)
+    {
+        return result;
+    }
+
+    if (address == PT_ADDR)
+    {
+        p_device = &ModelPt;
+        result   = MS8607_Model_OK;
+    }
+    else if (address == RH_ADDR)
+    {
+        p_device = &ModelRh;
+        result   = RhRead();
+    }
+    else
+    {
+        p_device = NULL;
+        result   = MS8607_Model_NACK;
+    }
+
+    ClockBus((result == MS8607_Model_OK) ? size : 0U);
+
+    if (result != MS8607_Model_OK)
+    {
+        return result;
+    }
+
+    /* Past the answer the bus reads the pull-ups */
+    for (i = 0; i < size; i++)
+    {
+        p_data[i] = (i < p_device->answer_size) ? p_device->answer[i] : 0xFFU;
+    }
+
+    p_device->answer_size = 0;
+
+    if ((size > 0U) && (Chance(ModelFaults.corrupt_ppm) == true))
+    {
+        bit = Random() % (8U * size);
+        p_data[bit / 8U] ^= (uint8_t) (1U << (bit % 8U));
+        ModelStats.num_corrupted++;
+    }
+
+    return MS8607_Model_OK;
+}
+
+/* Clocking out the stuck slave always works */
+void ms8607_model_recover_bus(void)
+{
+    ModelBusIsStuck = false;
+}
+
+void ms8607_model_set_scl(uint32_t scl_khz)
+{
+    ModelSclKhz = (scl_khz > 0U) ? scl_khz : 100U;
+}
+
+/* NULL restores the default environment */
+void ms8607_model_set_script(MS8607_Model_Script script)
+{
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    ModelScript     = (script != NULL) ? script : DefaultScript;
+    ModelTraceIndex = 0;
+    CPU_CRITICAL_EXIT();
+}
+
+void ms8607_model_set_faults(const MS8607_Model_Faults* p_faults)
+{
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    ModelFaults = *p_faults;
+    ModelSeed   = p_faults->seed;
+    CPU_CRITICAL_EXIT();
+}
+
+void ms8607_model_get_stats(MS8607_Model_Stats* p_stats)
+{
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    *p_stats = ModelStats;
+    CPU_CRITICAL_EXIT();
+}
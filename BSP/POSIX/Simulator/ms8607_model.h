@@ -0,0 +1,50 @@
+/**
+ * @file   ms8607_model.h
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  MS8607 device model behind the hosted I2C shims.
+ */
+
+#ifndef MS8607_MODEL_H
+#define MS8607_MODEL_H
+
+#include <stdint.h>
+
+typedef enum
+{
+    MS8607_Model_OK,
+    MS8607_Model_NACK,    /* Not acknowledged, the slave's answer         */
+    MS8607_Model_Timeout, /* Never completes, the bus or a slave is stuck */
+} MS8607_Model_Result;
+
+/* Faults injected per transfer, in parts per million of transfers */
+typedef struct
+{
+    uint32_t nack_ppm;    /* The address is not acknowledged                  */
+    uint32_t timeout_ppm; /* The transfer times out once                      */
+    uint32_t stuck_ppm;   /* A slave holds SDA low until the bus is recovered */
+    uint32_t corrupt_ppm; /* One bit of the data read is flipped              */
+    uint32_t seed;        /* Same seed and transfers give the same faults     */
+} MS8607_Model_Faults;
+
+typedef struct
+{
+    uint32_t num_transfers;
+    uint32_t num_nacks;
+    uint32_t num_timeouts;
+    uint32_t num_stuck;
+    uint32_t num_corrupted;
+} MS8607_Model_Stats;
+
+/* Environment at `time_ns` (BSP_Timebase_GetNs), in degC, mbar, and %RH */
+typedef void (*MS8607_Model_Script)(uint64_t time_ns, float* p_temperature, float* p_pressure, float* p_humidity);
+
+void                ms8607_model_init       (void);
+MS8607_Model_Result ms8607_model_write      (uint16_t address, const uint8_t* p_data, uint16_t size);
+MS8607_Model_Result ms8607_model_read       (uint16_t address, uint8_t* p_data, uint16_t size);
+void                ms8607_model_recover_bus(void);
+void                ms8607_model_set_scl    (uint32_t scl_khz);
+void                ms8607_model_set_script (MS8607_Model_Script script);
+void                ms8607_model_set_faults (const MS8607_Model_Faults* p_faults);
+void                ms8607_model_get_stats  (MS8607_Model_Stats* p_stats);
+
+#endif /* MS8607_MODEL_H */
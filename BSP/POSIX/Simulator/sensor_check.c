@@ -0,0 +1,106 @@
+/**
+ * @file   sensor_check.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Host check of the MS8607 driver against the device model.
+ *
+ *         Only built into the sensorcheck.elf target (`APP_SENSORCHECK`, `make sensor-check`),
+ *         which needs `-DSHIELD_MODEL=ON`. The application task runs it at startup and the
+ *         process exits with its result, nothing else is started.
+ *
+ *         Humidity-only reads are compensated with a cached temperature word (bsp_sensor.c).
+ *         The check drives the model with a temperature ramp of CHECK_RAMP degC/s at constant
+ *         humidity and reads the sensor on a schedule like the sensor task's with a humidity
+ *         divider of 1 and a temperature and pressure divider of CHECK_FULL_DIVIDER: a full
+ *         read, then humidity-only reads. Each humidity is compared with the model's humidity,
+ *         which the driver reads back to 0.01 %RH when it compensates with a current
+ *         temperature. With a stale one the error grows by 0.15 %RH per degC of drift.
+ *
+ *         The check fails if any reading is off by more than CHECK_LIMIT, which allows the
+ *         drift over the driver's cache age limit plus rounding.
+ */
+
+#include "sensor_check.h"
+
+#include <os.h>
+#include <bsp.h>
+#include <ms8607_model.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define CHECK_TEMPERATURE   (10.0f)   /* degC at the start of the ramp */
+#define CHECK_RAMP          (0.5f)    /* degC/s                        */
+#define CHECK_HUMIDITY      (50.0f)   /* %RH                           */
+#define CHECK_PRESSURE      (1000.0f) /* mbar                          */
+
+#define CHECK_READS         (400U)
+#define CHECK_FULL_DIVIDER  (100U)
+#define CHECK_PERIOD_TICKS  (OS_CFG_TICK_RATE_HZ / 10U)
+
+/* 1 s of drift at 0.15 %RH/degC, plus the 0.01 %RH resolution of the model and the driver */
+#define CHECK_LIMIT         ((CHECK_RAMP * 0.15f) + 0.02f)
+
+static uint64_t CheckStartNs;
+
+static void CheckScript(uint64_t time_ns, float* p_temperature, float* p_pressure, float* p_humidity)
+{
+    *p_temperature = CHECK_TEMPERATURE + (CHECK_RAMP * (float) (time_ns - CheckStartNs) / 1e9f);
+    *p_pressure    = CHECK_PRESSURE;
+    *p_humidity    = CHECK_HUMIDITY;
+}
+
+void sensor_check_run(void)
+{
+    OS_ERR err;
+    uint32_t i;
+    uint32_t num_errors;
+    uint8_t channels;
+    float error;
+    float max_error;
+    Sensor_Data data;
+
+    CheckStartNs = BSP_Timebase_GetNs();
+    ms8607_model_set_script(CheckScript);
+
+    if (BSP_Sensor_Reset(Sensor_MS8607) != BSP_SUCCESS)
+    {
+        fprintf(stderr, "sensor check: reset failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    num_errors = 0;
+    max_error  = 0.0f;
+
+    for (i = 0; i < CHECK_READS; i++)
+    {
+        channels = ((i % CHECK_FULL_DIVIDER) == 0U) ? SENSOR_CHANNEL_ALL : SENSOR_CHANNEL_HUMIDITY;
+
+        if (BSP_Sensor_ReadChannels(Sensor_MS8607, channels, &data) != BSP_SUCCESS)
+        {
+            fprintf(stderr, "sensor check: read %lu failed\n", (unsigned long) i);
+            exit(EXIT_FAILURE);
+        }
+
+        /* The model holds the humidity constant, so when the conversion started does not matter */
+        error = fabsf(data.humidity - CHECK_HUMIDITY);
+
+        if (error > max_error)
+        {
+            max_error = error;
+        }
+
+        num_errors += (error > CHECK_LIMIT) ? 1U : 0U;
+
+        OSTimeDly((OS_TICK) CHECK_PERIOD_TICKS,
+                  (OS_OPT)  OS_OPT_TIME_DLY,
+                  (OS_ERR*) &err);
+    }
+
+    fprintf(stderr, "sensor check: %lu reads over %.1f degC, max humidity error %.2f %%RH (limit %.2f), %lu over: %s\n",
+            (unsigned long) CHECK_READS, (double) (CHECK_RAMP * CHECK_READS * CHECK_PERIOD_TICKS / OS_CFG_TICK_RATE_HZ),
+            (double) max_error, (double) CHECK_LIMIT, (unsigned long) num_errors, (num_errors == 0U) ? "PASS" : "FAIL");
+
+    exit((num_errors == 0U) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
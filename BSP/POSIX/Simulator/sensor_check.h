@@ -0,0 +1,12 @@
+/**
+ * @file   sensor_check.h
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Host check of the MS8607 driver against the device model.
+ */
+
+#ifndef SENSOR_CHECK_H
+#define SENSOR_CHECK_H
+
+void sensor_check_run(void);
+
+#endif /* SENSOR_CHECK_H */
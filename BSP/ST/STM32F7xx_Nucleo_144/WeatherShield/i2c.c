@@ -2,17 +2,77 @@
  * @file   i2c.c
  * @author Ben Brown <ben@beninter.net>
  * @brief  I2C shims for the MS8607 driver.
+ *
+ *         A transfer that fails with a bus error, arbitration loss, or timeout is
+ *         usually a glitch that left a slave mid-byte holding SDA low, or left the
+ *         peripheral stuck busy. Before giving up the transfer is retried (at most
+ *         OS_CFG_I2C_RETRIES times, the delay doubling from OS_CFG_I2C_RETRY_BACKOFF ms),
+ *         each time after recovering the bus:
+ *
+ *             1. Reset the peripheral (`HAL_I2C_DeInit`, which pulses I2Cx_FORCE_RESET)
+ *                and take SCL and SDA over as open-drain GPIOs.
+ *             2. Clock SCL (at most 9 clocks, at 100 kHz) until the slave releases SDA,
+ *                then generate a STOP condition so every slave is idle.
+ *             3. Re-initialize the peripheral, which restores the pin functions.
+ *
+ *         A NACK is an answer rather than a bus fault (the MS8607 NACKs while it is
+ *         busy, and the TE driver probes for the sensor that way), so it is returned
+ *         right away. Errors, retries, recoveries, and the time from the first error
+ *         to success or giving up are recorded for `BSP_Sensor_GetBusStats`.
+ *
+ *         The SCL speed is kept per device (`i2c_master_set_baud_rate`), a device that
+ *         was never set runs at 100 kHz, which every I2C device supports. Before each
+ *         transfer the peripheral is switched to the speed of the addressed device, which
+ *         is a TIMINGR write only when it differs from the previous transfer. The TIMINGR
+ *         value is computed from the I2C kernel clock (PCLK1, as reported by HAL_RCC) and
+ *         the I2C-bus specification limits of the mode, for edges up to I2C_RISE_PS and
+ *         I2C_FALL_PS. It is never faster than the requested speed. The edge times and the
+ *         synchronization delay usually make it a few percent slower. At 1 MHz
+ *         (Fast-mode Plus) the pins are also switched to their FM+ drive.
+ *
+ *         `i2c_master_write_read_packet_wait` writes a command and reads the answer in a
+ *         single transaction, with a repeated START in between instead of a STOP, the bus
+ *         free time, and a new START. It uses the HAL sequential transfer functions, which
+ *         are interrupt driven, so the task waits on a semaphore like bsp_uart.c does. The
+ *         TE driver gets the same from `i2c_master_write_packet_wait_no_stop`: the write
+ *         is held back, and the next read from the same device sends both together. If
+ *         anything else comes first, including a delay (a conversion command is followed
+ *         by one), the held write is sent on its own with a STOP as before. With
+ *         OS_CFG_I2C_REPEATED_START_EN cleared, both are sent as two transactions.
+ *
+ *         In the hosted build (`BSP_HOSTED`, with `-DSHIELD_MODEL=ON`) the transfers go to
+ *         the device model in BSP/POSIX/Simulator/ms8607_model.c instead of the peripheral.
+ *         Everything above the transfer itself (speeds, held back writes, retries, and the
+ *         statistics) is the same code, so the model's injected faults take the same path
+ *         as real ones. A timed out transfer still blocks for I2C_TRANSFER_TIMEOUT_TICKS.
+ *
+ *         References:
+ *             - NXP UM10204 I2C-bus specification, "Bus clear" and "Characteristics of the
+ *               SDA and SCL bus lines for Standard, Fast, and Fast-mode Plus I2C-bus devices"
+ *             - ST RM0410 STM32F76xxx reference manual, "I2C timings"
  */
 
 #include "i2c.h"
 
 #include <os.h>
+#include <bsp.h>
+
+#if defined(BSP_HOSTED)
+#include <ms8607_model.h>
+#else
 #include <stm32f7xx.h>
+#endif
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <stdbool.h>
 
+#if !defined(BSP_HOSTED)
 #define I2Cx                            I2C1
+#define I2Cx_EV_IRQn                    I2C1_EV_IRQn
+#define I2Cx_EV_IRQHandler              I2C1_EV_IRQHandler
+#define I2Cx_ER_IRQn                    I2C1_ER_IRQn
+#define I2Cx_ER_IRQHandler              I2C1_ER_IRQHandler
 #define I2Cx_CLK_ENABLE()               __HAL_RCC_I2C1_CLK_ENABLE()
 #define I2Cx_SDA_GPIO_CLK_ENABLE()      __HAL_RCC_GPIOB_CLK_ENABLE()
 #define I2Cx_SCL_GPIO_CLK_ENABLE()      __HAL_RCC_GPIOB_CLK_ENABLE()
@@ -25,18 +85,106 @@
 #define I2Cx_SDA_GPIO_PORT              GPIOB
 #define I2Cx_SDA_GPIO_AF                GPIO_AF4_I2C1
 
+#define I2C_KERNEL_CLK_HZ()             HAL_RCC_GetPCLK1Freq()
+
+/* Bus clear: one byte plus the ACK bit at most, clocked at standard mode speed */
+#define I2C_RECOVERY_CLOCKS             (9U)
+#define I2C_RECOVERY_HZ                 (100000U)
+#else
+/* PCLK1 of the board, so the model accepts the same speeds */
+#define I2C_KERNEL_CLK_HZ()             (54000000U)
+#endif
+
 #define I2C_TRANSFER_TIMEOUT_TICKS      (1000U)
 
+/* The analog filter (enabled at reset) delays both edges by 50 to 260 ns */
+#define I2C_AF_MIN_PS                   (50000U)
+#define I2C_AF_MAX_PS                   (260000U)
+
+/*
+ * Worst-case SCL and SDA edge times on the Weather Shield bus (pull-ups, mux, and
+ * trace), a slower bus needs larger values. Fast-mode Plus allows at most 120 ns.
+ */
+#define I2C_RISE_PS                     (100000U)
+#define I2C_FALL_PS                     (10000U)
+
+/* A command and its arguments, longer no-STOP writes are sent right away */
+#define I2C_PENDING_WRITE_SIZE          (4U)
+
+/* Devices with their own speed, enough for every sensor on the Weather Shield */
+#define I2C_MAX_DEVICES                 (8U)
+
+#define I2C_PS_PER_SEC                  (1000000000000ULL)
+
+#define DIV_CEIL(a, b)                  (((a) + (b) - 1U) / (b))
+#define TIMINGR(presc, scldel, sdadel, sclh, scll) \
+    (((presc) << 28) | ((scldel) << 20) | ((sdadel) << 16) | ((sclh) << 8) | (scll))
+
+typedef enum
+{
+    I2C_Result_OK,
+    I2C_Result_NACK,     /* Not acknowledged, the slave's answer                   */
+    I2C_Result_Timeout,  /* Never completed                                        */
+    I2C_Result_BusError, /* Bus error, arbitration loss, or the peripheral is busy */
+} I2C_Result;
+
+/* One attempt at a transfer, using `p_write`, `p_read`, or both */
+typedef I2C_Result (*I2C_Transfer)(struct i2c_master_packet* const p_write,
+                                   struct i2c_master_packet* const p_read);
+
+/* I2C-bus specification limits of one mode (ps), tHD;DAT is 0 in every mode */
+typedef struct
+{
+    enum i2c_master_baud_rate baud_rate;
+    uint32_t                  low_min;    /* tLOW    */
+    uint32_t                  high_min;   /* tHIGH   */
+    uint32_t                  su_dat_min; /* tSU;DAT */
+    uint32_t                  vd_dat_max; /* tVD;DAT */
+    uint32_t                  rise_max;   /* tr      */
+    uint32_t                  fall_max;   /* tf      */
+} I2C_Mode;
+
+typedef struct
+{
+    uint16_t                  address;
+    enum i2c_master_baud_rate baud_rate;
+    uint32_t                  timing;
+} I2C_Device;
+
+static const I2C_Mode I2cModes[] = {
+    {I2C_MASTER_BAUD_RATE_100KHZ,  4700000U, 4000000U, 250000U, 3450000U, 1000000U, 300000U},
+    {I2C_MASTER_BAUD_RATE_400KHZ,  1300000U,  600000U, 100000U,  900000U,  300000U, 300000U},
+    {I2C_MASTER_BAUD_RATE_1000KHZ,  500000U,  260000U,  50000U,  450000U,  120000U, 120000U},
+};
+
+#if !defined(BSP_HOSTED)
 static I2C_HandleTypeDef I2cHandle;
 static I2C_HandleTypeDef* pI2cHandle = NULL;
 
-static enum status_code HalStatus2DriverStatus(HAL_StatusTypeDef status)
+static OS_SEM        I2cSemaphore;
+static volatile bool I2cError;
+#else
+static bool I2cIsInitialized;
+#endif
+
+static Sensor_BusStats I2cStats;
+
+/* Write held back by i2c_master_write_packet_wait_no_stop */
+static struct i2c_master_packet I2cPendingWrite;
+static uint8_t                  I2cPendingWriteData[I2C_PENDING_WRITE_SIZE];
+static bool                     I2cWriteIsPending;
+
+static I2C_Device I2cDevices[I2C_MAX_DEVICES];
+static uint32_t   I2cNumDevices;
+static uint32_t   I2cDefaultTiming;
+
+static enum status_code Result2DriverStatus(I2C_Result result)
 {
-    if (status == HAL_OK)
+    if (result == I2C_Result_OK)
     {
         return STATUS_OK;
     }
-    else if (status == HAL_TIMEOUT)
+    else if (result == I2C_Result_Timeout)
     {
         return STATUS_ERR_TIMEOUT;
     }
@@ -46,11 +194,524 @@ static enum status_code HalStatus2DriverStatus(HAL_StatusTypeDef status)
     }
 }
 
+static const I2C_Mode* FindMode(enum i2c_master_baud_rate baud_rate)
+{
+    uint32_t i;
+
+    for (i = 0; i < (sizeof(I2cModes) / sizeof(I2cModes[0])); i++)
+    {
+        if (I2cModes[i].baud_rate == baud_rate)
+        {
+            return &I2cModes[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* TIMINGR value for `p_mode` with an I2C kernel clock of `clk_hz`, or 0 if the mode cannot be met */
+static uint32_t ComputeTiming(uint32_t clk_hz, const I2C_Mode* p_mode)
+{
+    uint32_t clk_ps;
+    uint32_t period_ps;
+    uint32_t sync_ps;
+    uint32_t sdadel_max_ps;
+    uint32_t presc_ps;
+    uint32_t presc;
+    uint32_t scldel;
+    uint32_t sdadel;
+    uint32_t low;
+    uint32_t high;
+    uint32_t total;
+
+    if ((clk_hz == 0U) || (I2C_RISE_PS > p_mode->rise_max) || (I2C_FALL_PS > p_mode->fall_max))
+    {
+        return 0;
+    }
+
+    clk_ps    = (uint32_t) (I2C_PS_PER_SEC / clk_hz);
+    period_ps = (uint32_t) (I2C_PS_PER_SEC / ((uint32_t) p_mode->baud_rate * 1000U));
+
+    /* Each SCL edge is only seen after the edge itself, the analog filter, and 2 to 3 kernel clocks */
+    sync_ps = I2C_RISE_PS + I2C_FALL_PS + (2U * (I2C_AF_MIN_PS + (2U * clk_ps)));
+
+    /* The data hold must end in time for the data to be valid by tVD;DAT, even with the slowest filter */
+    if (p_mode->vd_dat_max <= (I2C_RISE_PS + I2C_AF_MAX_PS + (4U * clk_ps)))
+    {
+        return 0;
+    }
+
+    sdadel_max_ps = p_mode->vd_dat_max - I2C_RISE_PS - I2C_AF_MAX_PS - (4U * clk_ps);
+
+    /* The smallest prescaler that fits gives the finest SCL resolution */
+    for (presc = 0; presc < 16U; presc++)
+    {
+        presc_ps = (presc + 1U) * clk_ps;
+
+        /* Data setup, SDA must have risen and then be stable for tSU;DAT before SCL rises */
+        scldel = DIV_CEIL(I2C_RISE_PS + p_mode->su_dat_min, presc_ps) - 1U;
+
+        /* Data hold, only the part of the SCL fall time that the filter and synchronization do not cover */
+        sdadel = 0;
+
+        if (I2C_FALL_PS > (I2C_AF_MIN_PS + (3U * clk_ps)))
+        {
+            sdadel = DIV_CEIL(I2C_FALL_PS - I2C_AF_MIN_PS - (3U * clk_ps), presc_ps);
+        }
+
+        if ((scldel > 15U) || (sdadel > 15U) || ((sdadel * presc_ps) > sdadel_max_ps))
+        {
+            continue;
+        }
+
+        /* Stretch both halves to the period, rounding it up so SCL is never faster than requested */
+        low   = DIV_CEIL(p_mode->low_min, presc_ps);
+        high  = DIV_CEIL(p_mode->high_min, presc_ps);
+        total = (period_ps > sync_ps) ? DIV_CEIL(period_ps - sync_ps, presc_ps) : 0U;
+
+        if (total > (low + high))
+        {
+            high += (total - low - high) / 2U;
+            low   = total - high;
+        }
+
+        if ((low > 256U) || (high > 256U))
+        {
+            continue;
+        }
+
+        return TIMINGR(presc, scldel, sdadel, high - 1U, low - 1U);
+    }
+
+    return 0;
+}
+
+#if !defined(BSP_HOSTED)
+/* Only call with the sensor mutex held, switches the peripheral to the speed of `address` (7-bit) */
+static void SelectTiming(uint16_t address)
+{
+    uint32_t i;
+    uint32_t timing;
+    bool fast_mode_plus;
+
+    timing         = I2cDefaultTiming;
+    fast_mode_plus = false;
+
+    for (i = 0; i < I2cNumDevices; i++)
+    {
+        if (I2cDevices[i].address == address)
+        {
+            timing         = I2cDevices[i].timing;
+            fast_mode_plus = (I2cDevices[i].baud_rate == I2C_MASTER_BAUD_RATE_1000KHZ);
+            break;
+        }
+    }
+
+    if (timing == pI2cHandle->Init.Timing)
+    {
+        return;
+    }
+
+    /* TIMINGR can only be written while the peripheral is disabled */
+    __HAL_I2C_DISABLE(pI2cHandle);
+
+    /* Init.Timing is also what the re-initialization after a bus recovery uses */
+    pI2cHandle->Instance->TIMINGR = timing;
+    pI2cHandle->Init.Timing       = timing;
+
+    if (fast_mode_plus == true)
+    {
+        HAL_I2CEx_EnableFastModePlus(I2C_FASTMODEPLUS_I2C1);
+    }
+    else
+    {
+        HAL_I2CEx_DisableFastModePlus(I2C_FASTMODEPLUS_I2C1);
+    }
+
+    __HAL_I2C_ENABLE(pI2cHandle);
+}
+
+/* An acknowledge failure alone is a NACK */
+static I2C_Result HalStatus2Result(HAL_StatusTypeDef status)
+{
+    if (status == HAL_OK)
+    {
+        return I2C_Result_OK;
+    }
+    else if (status == HAL_TIMEOUT)
+    {
+        return I2C_Result_Timeout;
+    }
+    else if ((status == HAL_ERROR) && ((HAL_I2C_GetError(pI2cHandle) & ~HAL_I2C_ERROR_AF) == 0U))
+    {
+        return I2C_Result_NACK;
+    }
+    else
+    {
+        return I2C_Result_BusError;
+    }
+}
+
+/* Busy wait, the recovery clocks are far shorter than a tick */
+static void DelayCycles(uint32_t cycles)
+{
+    uint32_t start;
+
+    start = DWT->CYCCNT;
+
+    while ((DWT->CYCCNT - start) < cycles)
+    {
+    }
+}
+
+static void RecoverBus(void)
+{
+    GPIO_InitTypeDef GPIO_InitStruct;
+    uint32_t half_period;
+    uint32_t i;
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    I2cStats.num_recoveries++;
+    CPU_CRITICAL_EXIT();
+
+    half_period = BSP_CPU_ClkFreq() / (2U * I2C_RECOVERY_HZ);
+
+    /* Peripheral reset, HAL_I2C_MspDeInit also returns the pins to their reset state */
+    (void) HAL_I2C_DeInit(pI2cHandle);
+
+    GPIO_InitStruct.Mode  = GPIO_MODE_OUTPUT_OD;
+    GPIO_InitStruct.Pull  = GPIO_PULLUP;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+
+    HAL_GPIO_WritePin(I2Cx_SCL_GPIO_PORT, I2Cx_SCL_PIN, GPIO_PIN_SET);
+    HAL_GPIO_WritePin(I2Cx_SDA_GPIO_PORT, I2Cx_SDA_PIN, GPIO_PIN_SET);
+
+    GPIO_InitStruct.Pin = I2Cx_SCL_PIN;
+    HAL_GPIO_Init(I2Cx_SCL_GPIO_PORT, &GPIO_InitStruct);
+
+    GPIO_InitStruct.Pin = I2Cx_SDA_PIN;
+    HAL_GPIO_Init(I2Cx_SDA_GPIO_PORT, &GPIO_InitStruct);
+
+    DelayCycles(half_period);
+
+    /* A slave holding SDA low is mid-byte, clock it out until it lets go */
+    for (i = 0; (i < I2C_RECOVERY_CLOCKS) && (HAL_GPIO_ReadPin(I2Cx_SDA_GPIO_PORT, I2Cx_SDA_PIN) == GPIO_PIN_RESET); i++)
+    {
+        HAL_GPIO_WritePin(I2Cx_SCL_GPIO_PORT, I2Cx_SCL_PIN, GPIO_PIN_RESET);
+        DelayCycles(half_period);
+        HAL_GPIO_WritePin(I2Cx_SCL_GPIO_PORT, I2Cx_SCL_PIN, GPIO_PIN_SET);
+        DelayCycles(half_period);
+    }
+
+    /* STOP condition, SDA rises while SCL is high */
+    HAL_GPIO_WritePin(I2Cx_SCL_GPIO_PORT, I2Cx_SCL_PIN, GPIO_PIN_RESET);
+    DelayCycles(half_period);
+    HAL_GPIO_WritePin(I2Cx_SDA_GPIO_PORT, I2Cx_SDA_PIN, GPIO_PIN_RESET);
+    DelayCycles(half_period);
+    HAL_GPIO_WritePin(I2Cx_SCL_GPIO_PORT, I2Cx_SCL_PIN, GPIO_PIN_SET);
+    DelayCycles(half_period);
+    HAL_GPIO_WritePin(I2Cx_SDA_GPIO_PORT, I2Cx_SDA_PIN, GPIO_PIN_SET);
+    DelayCycles(half_period);
+
+    /* Re-initialize, HAL_I2C_MspInit switches the pins back to I2C */
+    (void) HAL_I2C_Init(pI2cHandle);
+}
+#endif
+
+/* A NACK is the slave's answer, anything else means the bus or the peripheral is stuck */
+static bool NeedsRecovery(I2C_Result result)
+{
+    return (result == I2C_Result_Timeout) || (result == I2C_Result_BusError);
+}
+
+static uint32_t RecoveryBucket(uint32_t recovery_us)
+{
+    uint32_t bucket;
+
+    bucket = 0;
+
+    while ((recovery_us > 0U) && (bucket < (SENSOR_BUS_RECOVERY_HIST_SIZE - 1U)))
+    {
+        recovery_us >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+static void RecordTransfer(uint64_t transfer_ns)
+{
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    I2cStats.num_transfers++;
+    I2cStats.transfer_ns += transfer_ns;
+    CPU_CRITICAL_EXIT();
+}
+
+static void RecordRecovery(uint32_t retries, bool success, uint64_t recovery_ns)
+{
+    uint32_t recovery_us;
+    CPU_SR_ALLOC();
+
+    recovery_us = (uint32_t) (recovery_ns / 1000ULL);
+
+    CPU_CRITICAL_ENTER();
+
+    I2cStats.num_errors++;
+    I2cStats.num_retries += retries;
+    I2cStats.recovery_hist[RecoveryBucket(recovery_us)]++;
+
+    if (success == false)
+    {
+        I2cStats.num_failures++;
+    }
+
+    if (recovery_us > I2cStats.recovery_max_us)
+    {
+        I2cStats.recovery_max_us = recovery_us;
+    }
+
+    CPU_CRITICAL_EXIT();
+}
+
+#if !defined(BSP_HOSTED)
+static I2C_Result Write(struct i2c_master_packet* const p_write, struct i2c_master_packet* const p_read)
+{
+    return HalStatus2Result(HAL_I2C_Master_Transmit(pI2cHandle, (uint16_t) (p_write->address << 1), p_write->data,
+                                                    p_write->data_length, I2C_TRANSFER_TIMEOUT_TICKS));
+}
+
+static I2C_Result Read(struct i2c_master_packet* const p_write, struct i2c_master_packet* const p_read)
+{
+    return HalStatus2Result(HAL_I2C_Master_Receive(pI2cHandle, (uint16_t) ((p_read->address << 1) | 0x01), p_read->data,
+                                                   p_read->data_length, I2C_TRANSFER_TIMEOUT_TICKS));
+}
+
+#if (OS_CFG_I2C_REPEATED_START_EN > 0u)
+/* Waits for the end of a sequential transfer, `status` is from starting it */
+static I2C_Result WaitSequential(HAL_StatusTypeDef status)
+{
+    OS_ERR err;
+
+    if (status != HAL_OK)
+    {
+        return HalStatus2Result(status);
+    }
+
+    OSSemPend((OS_SEM*) &I2cSemaphore,
+              (OS_TICK) I2C_TRANSFER_TIMEOUT_TICKS,
+              (OS_OPT)  OS_OPT_PEND_BLOCKING,
+              (CPU_TS*) NULL,
+              (OS_ERR*) &err);
+
+    /* Still running, the bus recovery that follows resets the peripheral and stops it */
+    if (err == OS_ERR_TIMEOUT)
+    {
+        return I2C_Result_Timeout;
+    }
+
+    if ((err != OS_ERR_NONE) || (I2cError == true))
+    {
+        return HalStatus2Result(HAL_ERROR);
+    }
+
+    return I2C_Result_OK;
+}
+#endif
+
+static I2C_Result WriteRead(struct i2c_master_packet* const p_write, struct i2c_master_packet* const p_read)
+{
+    I2C_Result result;
+#if (OS_CFG_I2C_REPEATED_START_EN > 0u)
+    OS_ERR err;
+
+    /* Drop a completion left over from a transfer that timed out */
+    OSSemSet((OS_SEM*)    &I2cSemaphore,
+             (OS_SEM_CTR) 0,
+             (OS_ERR*)    &err);
+
+    I2cError = false;
+
+    /* The first frame ends without a STOP, the last one starts with a repeated START and ends with a STOP */
+    result = WaitSequential(HAL_I2C_Master_Seq_Transmit_IT(pI2cHandle, (uint16_t) (p_write->address << 1),
+                                                           p_write->data, p_write->data_length, I2C_FIRST_FRAME));
+
+    if (result != I2C_Result_OK)
+    {
+        return result;
+    }
+
+    return WaitSequential(HAL_I2C_Master_Seq_Receive_IT(pI2cHandle, (uint16_t) ((p_read->address << 1) | 0x01),
+                                                        p_read->data, p_read->data_length, I2C_LAST_FRAME));
+#else
+    result = Write(p_write, NULL);
+
+    if (result != I2C_Result_OK)
+    {
+        return result;
+    }
+
+    return Read(NULL, p_read);
+#endif
+}
+#else
+/* Blocks like the peripheral would before giving up */
+static I2C_Result ModelResult(MS8607_Model_Result result)
+{
+    OS_ERR err;
+
+    switch (result)
+    {
+    case MS8607_Model_OK:
+        return I2C_Result_OK;
+
+    case MS8607_Model_NACK:
+        return I2C_Result_NACK;
+
+    default:
+        OSTimeDly((OS_TICK) I2C_TRANSFER_TIMEOUT_TICKS,
+                  (OS_OPT)  OS_OPT_TIME_DLY,
+                  (OS_ERR*) &err);
+
+        return I2C_Result_Timeout;
+    }
+}
+
+/* Only call with the sensor mutex held, the model clocks the transfers to `address` (7-bit) at its speed */
+static void SelectTiming(uint16_t address)
+{
+    uint32_t i;
+    enum i2c_master_baud_rate baud_rate;
+
+    baud_rate = I2C_MASTER_BAUD_RATE_100KHZ;
+
+    for (i = 0; i < I2cNumDevices; i++)
+    {
+        if (I2cDevices[i].address == address)
+        {
+            baud_rate = I2cDevices[i].baud_rate;
+            break;
+        }
+    }
+
+    ms8607_model_set_scl((uint32_t) baud_rate);
+}
+
+static void RecoverBus(void)
+{
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    I2cStats.num_recoveries++;
+    CPU_CRITICAL_EXIT();
+
+    ms8607_model_recover_bus();
+}
+
+static I2C_Result Write(struct i2c_master_packet* const p_write, struct i2c_master_packet* const p_read)
+{
+    return ModelResult(ms8607_model_write(p_write->address, p_write->data, p_write->data_length));
+}
+
+static I2C_Result Read(struct i2c_master_packet* const p_write, struct i2c_master_packet* const p_read)
+{
+    return ModelResult(ms8607_model_read(p_read->address, p_read->data, p_read->data_length));
+}
+
+/* The model answers the same with or without the repeated START */
+static I2C_Result WriteRead(struct i2c_master_packet* const p_write, struct i2c_master_packet* const p_read)
+{
+    I2C_Result result;
+
+    result = Write(p_write, NULL);
+
+    if (result != I2C_Result_OK)
+    {
+        return result;
+    }
+
+    return Read(NULL, p_read);
+}
+#endif
+
+/* Only call with the sensor mutex held, it serializes all bus users */
+static enum status_code Transfer(I2C_Transfer transfer, uint16_t address, struct i2c_master_packet* const p_write,
+                                 struct i2c_master_packet* const p_read)
+{
+    I2C_Result result;
+    uint64_t transfer_start_ns;
+    uint64_t start_ns;
+    uint32_t retries;
+
+    transfer_start_ns = BSP_Timebase_GetNs();
+
+    SelectTiming(address);
+
+    result = transfer(p_write, p_read);
+
+    if (NeedsRecovery(result) == false)
+    {
+        RecordTransfer(BSP_Timebase_GetNs() - transfer_start_ns);
+
+        return Result2DriverStatus(result);
+    }
+
+    start_ns = BSP_Timebase_GetNs();
+    retries  = 0;
+
+    while (1)
+    {
+        /* Also after the last retry, so the next transfer finds a working bus */
+        RecoverBus();
+
+        if (retries >= OS_CFG_I2C_RETRIES)
+        {
+            break;
+        }
+
+        /* Backoff, in case whatever disturbed the bus is still going on */
+        if (OS_CFG_I2C_RETRY_BACKOFF > 0U)
+        {
+            delay_ms(OS_CFG_I2C_RETRY_BACKOFF << retries);
+        }
+
+        retries++;
+        result = transfer(p_write, p_read);
+
+        if (NeedsRecovery(result) == false)
+        {
+            break;
+        }
+    }
+
+    RecordRecovery(retries, (result == I2C_Result_OK), BSP_Timebase_GetNs() - start_ns);
+    RecordTransfer(BSP_Timebase_GetNs() - transfer_start_ns);
+
+    return Result2DriverStatus(result);
+}
+
+/* Sends a write held back by i2c_master_write_packet_wait_no_stop on its own */
+static enum status_code FlushPendingWrite(void)
+{
+    if (I2cWriteIsPending == false)
+    {
+        return STATUS_OK;
+    }
+
+    I2cWriteIsPending = false;
+
+    return Transfer(Write, I2cPendingWrite.address, &I2cPendingWrite, NULL);
+}
+
 void delay_ms(uint32_t duration_ms)
 {
-    /* Ignore errors */
+    /* Ignore errors, a failed held back write shows up as a failure of the read after the delay */
     OS_ERR err;
 
+    (void) FlushPendingWrite();
+
     OSTimeDlyHMSM((CPU_INT16U) 0,
                   (CPU_INT16U) 0,
                   (CPU_INT16U) 0,
@@ -59,15 +720,23 @@ void delay_ms(uint32_t duration_ms)
                   (OS_ERR*)    &err);
 }
 
+#if !defined(BSP_HOSTED)
 void i2c_master_init(void)
 {
+    OS_ERR err;
+
     if (pI2cHandle == NULL)
     {
         pI2cHandle = &I2cHandle;
 
-        /* I2C timing: 0 ns rise and fall time, 100 KHz SCL */
+        /* I2C1 runs from PCLK1 (the reset clock selection), 100 KHz SCL until a device asks for more */
+        I2cDefaultTiming = ComputeTiming(I2C_KERNEL_CLK_HZ(), FindMode(I2C_MASTER_BAUD_RATE_100KHZ));
+
+        /* SYSCFG holds the Fast-mode Plus drive enables */
+        __HAL_RCC_SYSCFG_CLK_ENABLE();
+
         pI2cHandle->Instance              = I2Cx;
-        pI2cHandle->Init.Timing           = 0x20303E5D;
+        pI2cHandle->Init.Timing           = I2cDefaultTiming;
         pI2cHandle->Init.OwnAddress1      = 0x00;
         pI2cHandle->Init.AddressingMode   = I2C_ADDRESSINGMODE_7BIT;
         pI2cHandle->Init.DualAddressMode  = I2C_DUALADDRESS_DISABLE;
@@ -77,51 +746,237 @@ void i2c_master_init(void)
         pI2cHandle->Init.NoStretchMode    = I2C_NOSTRETCH_DISABLE;
 
         (void) HAL_I2C_Init(&I2cHandle);
+
+        /* Ignore errors, without the semaphore every combined transfer fails */
+        OSSemCreate(&I2cSemaphore, "I2C Semaphore", 0, &err);
     }
 }
+#else
+void i2c_master_init(void)
+{
+    if (I2cIsInitialized == false)
+    {
+        I2cIsInitialized = true;
+
+        ms8607_model_init();
+    }
+}
+#endif
 
 enum status_code i2c_master_read_packet_wait(struct i2c_master_packet *const packet)
 {
-    HAL_StatusTypeDef result;
+    enum status_code status;
+
+    if ((I2cWriteIsPending == true) && (I2cPendingWrite.address == packet->address))
+    {
+        I2cWriteIsPending = false;
+
+        return Transfer(WriteRead, packet->address, &I2cPendingWrite, packet);
+    }
 
-    result = HAL_I2C_Master_Receive(pI2cHandle,
-                                    (packet->address << 1) | 0x01,
-                                    packet->data,
-                                    packet->data_length,
-                                    I2C_TRANSFER_TIMEOUT_TICKS);
+    status = FlushPendingWrite();
 
-    return HalStatus2DriverStatus(result);
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
+
+    return Transfer(Read, packet->address, NULL, packet);
 }
 
 enum status_code i2c_master_write_packet_wait(struct i2c_master_packet *const packet)
 {
-    HAL_StatusTypeDef result;
+    enum status_code status;
 
-    result = HAL_I2C_Master_Transmit(pI2cHandle,
-                                     (packet->address << 1),
-                                     packet->data,
-                                     packet->data_length,
-                                     I2C_TRANSFER_TIMEOUT_TICKS);
+    status = FlushPendingWrite();
+
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
 
-    return HalStatus2DriverStatus(result);
+    return Transfer(Write, packet->address, packet, NULL);
 }
+
+/* Only call with the sensor mutex held, held back until the next read or anything else on the bus */
 enum status_code i2c_master_write_packet_wait_no_stop(struct i2c_master_packet *const packet)
 {
-    HAL_StatusTypeDef result;
+    enum status_code status;
+    uint16_t i;
+
+    status = FlushPendingWrite();
+
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
+
+    if ((OS_CFG_I2C_REPEATED_START_EN == 0u) || (packet->data_length > I2C_PENDING_WRITE_SIZE))
+    {
+        return Transfer(Write, packet->address, packet, NULL);
+    }
+
+    /* The caller's buffer may not outlive this call */
+    for (i = 0; i < packet->data_length; i++)
+    {
+        I2cPendingWriteData[i] = packet->data[i];
+    }
+
+    I2cPendingWrite.address     = packet->address;
+    I2cPendingWrite.data_length = packet->data_length;
+    I2cPendingWrite.data        = I2cPendingWriteData;
+    I2cWriteIsPending           = true;
+
+    return STATUS_OK;
+}
+
+/* Only call with the sensor mutex held, one transaction with a repeated START between the write and the read */
+enum status_code i2c_master_write_read_packet_wait(struct i2c_master_packet *const write_packet,
+                                                   struct i2c_master_packet *const read_packet)
+{
+    enum status_code status;
+
+    if (write_packet->address != read_packet->address)
+    {
+        return STATUS_ERR_BAD_DATA;
+    }
+
+    status = FlushPendingWrite();
+
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
+
+    return Transfer(WriteRead, write_packet->address, write_packet, read_packet);
+}
+
+/* Only call with the sensor mutex held, `address` (7-bit) uses the new speed from its next transfer */
+enum status_code i2c_master_set_baud_rate(uint16_t address, enum i2c_master_baud_rate baud_rate)
+{
+    const I2C_Mode* p_mode;
+    uint32_t timing;
+    uint32_t i;
+
+    p_mode = FindMode(baud_rate);
+
+    if (p_mode == NULL)
+    {
+        return STATUS_ERR_BAD_DATA;
+    }
+
+    timing = ComputeTiming(I2C_KERNEL_CLK_HZ(), p_mode);
+
+    if (timing == 0U)
+    {
+        return STATUS_ERR_BAD_DATA;
+    }
+
+    for (i = 0; (i < I2cNumDevices) && (I2cDevices[i].address != address); i++)
+    {
+    }
+
+    if (i == I2cNumDevices)
+    {
+        if (I2cNumDevices >= I2C_MAX_DEVICES)
+        {
+            return STATUS_ERR_OVERFLOW;
+        }
+
+        I2cNumDevices++;
+    }
+
+    I2cDevices[i].address   = address;
+    I2cDevices[i].baud_rate = baud_rate;
+    I2cDevices[i].timing    = timing;
+
+    return STATUS_OK;
+}
+
+void i2c_master_get_stats(Sensor_BusStats* p_stats)
+{
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    *p_stats = I2cStats;
+    CPU_CRITICAL_EXIT();
+}
+
+void i2c_master_reset_stats(void)
+{
+    uint32_t i;
+    CPU_SR_ALLOC();
 
-    result = HAL_I2C_Master_Transmit(pI2cHandle,
-                                     (packet->address << 1),
-                                     packet->data,
-                                     packet->data_length,
-                                     I2C_TRANSFER_TIMEOUT_TICKS);
+    CPU_CRITICAL_ENTER();
 
-    return HalStatus2DriverStatus(result);
+    I2cStats.num_transfers   = 0;
+    I2cStats.transfer_ns     = 0;
+    I2cStats.num_errors      = 0;
+    I2cStats.num_retries     = 0;
+    I2cStats.num_recoveries  = 0;
+    I2cStats.num_failures    = 0;
+    I2cStats.recovery_max_us = 0;
+
+    for (i = 0; i < SENSOR_BUS_RECOVERY_HIST_SIZE; i++)
+    {
+        I2cStats.recovery_hist[i] = 0;
+    }
+
+    CPU_CRITICAL_EXIT();
 }
 
+#if !defined(BSP_HOSTED)
 /*
  * STM32 HAL functions.
  */
 
+/* Also the end of the first frame of a sequential transfer */
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    OS_ERR err;
+
+    OSSemPost((OS_SEM*) &I2cSemaphore,
+              (OS_OPT)  OS_OPT_POST_1,
+              (OS_ERR*) &err);
+}
+
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    HAL_I2C_MasterTxCpltCallback(hi2c);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    I2cError = true;
+    HAL_I2C_MasterTxCpltCallback(hi2c);
+}
+
+void I2Cx_EV_IRQHandler(void)
+{
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    OSIntEnter();
+    CPU_CRITICAL_EXIT();
+
+    HAL_I2C_EV_IRQHandler(&I2cHandle);
+
+    OSIntExit();
+}
+
+void I2Cx_ER_IRQHandler(void)
+{
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    OSIntEnter();
+    CPU_CRITICAL_EXIT();
+
+    HAL_I2C_ER_IRQHandler(&I2cHandle);
+
+    OSIntExit();
+}
+
 void HAL_I2C_MspInit(I2C_HandleTypeDef *hi2c)
 {
     GPIO_InitTypeDef GPIO_InitStruct;
@@ -147,6 +1002,12 @@ void HAL_I2C_MspInit(I2C_HandleTypeDef *hi2c)
     GPIO_InitStruct.Pin       = I2Cx_SDA_PIN;
     GPIO_InitStruct.Alternate = I2Cx_SDA_GPIO_AF;
     HAL_GPIO_Init(I2Cx_SDA_GPIO_PORT, &GPIO_InitStruct);
+
+    /* Enable I2C interrupts, only the sequential transfers use them. Their callbacks post to the kernel */
+    HAL_NVIC_SetPriority(I2Cx_EV_IRQn, BSP_NVIC_PRIO_KERNEL_AWARE, 0);
+    HAL_NVIC_SetPriority(I2Cx_ER_IRQn, BSP_NVIC_PRIO_KERNEL_AWARE, 0);
+    HAL_NVIC_EnableIRQ(I2Cx_EV_IRQn);
+    HAL_NVIC_EnableIRQ(I2Cx_ER_IRQn);
 }
 
 void HAL_I2C_MspDeInit(I2C_HandleTypeDef *hi2c)
@@ -158,4 +1019,9 @@ void HAL_I2C_MspDeInit(I2C_HandleTypeDef *hi2c)
     /* Reset I2C GPIO pin configurations */
     HAL_GPIO_DeInit(I2Cx_SCL_GPIO_PORT, I2Cx_SCL_PIN);
     HAL_GPIO_DeInit(I2Cx_SDA_GPIO_PORT, I2Cx_SDA_PIN);
+
+    /* Disable I2C interrupts */
+    HAL_NVIC_DisableIRQ(I2Cx_EV_IRQn);
+    HAL_NVIC_DisableIRQ(I2Cx_ER_IRQn);
 }
+#endif
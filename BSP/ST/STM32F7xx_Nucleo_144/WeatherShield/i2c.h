@@ -7,6 +7,8 @@
 #ifndef I2C_H
 #define I2C_H
 
+#include <bsp.h>
+
 #include <stdint.h>
 
 enum status_code
@@ -14,6 +16,15 @@ enum status_code
     STATUS_OK           = 0x00,
     STATUS_ERR_OVERFLOW	= 0x01,
     STATUS_ERR_TIMEOUT  = 0x02,
+    STATUS_ERR_BAD_DATA = 0x03,
+};
+
+/* SCL frequency in kHz */
+enum i2c_master_baud_rate
+{
+    I2C_MASTER_BAUD_RATE_100KHZ  = 100,  /* Standard-mode  */
+    I2C_MASTER_BAUD_RATE_400KHZ  = 400,  /* Fast-mode      */
+    I2C_MASTER_BAUD_RATE_1000KHZ = 1000, /* Fast-mode Plus */
 };
 
 struct i2c_master_packet
@@ -28,5 +39,10 @@ void             i2c_master_init                     (void);
 enum status_code i2c_master_read_packet_wait         (struct i2c_master_packet *const packet);
 enum status_code i2c_master_write_packet_wait        (struct i2c_master_packet *const packet);
 enum status_code i2c_master_write_packet_wait_no_stop(struct i2c_master_packet *const packet);
+enum status_code i2c_master_write_read_packet_wait   (struct i2c_master_packet *const write_packet,
+                                                      struct i2c_master_packet *const read_packet);
+enum status_code i2c_master_set_baud_rate            (uint16_t address, enum i2c_master_baud_rate baud_rate);
+void             i2c_master_get_stats                (Sensor_BusStats* p_stats);
+void             i2c_master_reset_stats              (void);
 
 #endif /* I2C_H */
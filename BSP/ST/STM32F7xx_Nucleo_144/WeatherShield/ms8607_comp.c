@@ -0,0 +1,197 @@
+/**
+ * @file   ms8607_comp.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  MS8607 raw-to-engineering-unit compensation.
+ *
+ *         The datasheet computes temperature and pressure with 64-bit integer arithmetic,
+ *         including the second-order correction below 20 degC, and ends with values in
+ *         0.01 degC and 0.01 mbar. The TE driver then divides those by 100 as floats, and
+ *         converts and temperature compensates the humidity in floating point.
+ *
+ *         `ms8607_comp_fixed` stops at the integer results and computes the humidity as a
+ *         single rational expression in 0.01 %RH, rounded to nearest, so a reading is
+ *         converted with no floating point and no 64-bit division. On the single precision
+ *         FPU of the Cortex-M7 that also avoids the library calls that convert the 64-bit
+ *         results to float. `ms8607_comp_float` is the same math in
+ *         the TE driver's float form; it is kept as the reference for the host equivalence
+ *         check (Tools/ms8607_comp) and the cycle benchmarks, and produces the values the
+ *         sensor task reported before.
+ *
+ *         The PROM CRC-4 and the humidity CRC-8 are here as well, so the driver that checks
+ *         them (ms8607_raw.c) and the hosted MS8607 model that generates them share one
+ *         implementation. The host tool checks the CRC-8 against the datasheet examples.
+ *
+ *         References:
+ *             - TE Connectivity MS8607-02BA01 datasheet, "Pressure and temperature
+ *               calculation", "Second order temperature compensation", "Relative
+ *               humidity calculation", "PROM CRC", and "RH CRC".
+ */
+
+#include "ms8607_comp.h"
+
+#include <stdint.h>
+
+/* Humidity coefficients, RH = -6 + 125 * D3 / 2^16 in %RH */
+#define RH_MUL        (125)
+#define RH_ADD        (-6)
+
+/* Compensated RH = RH + (20 - T) * RH_TEMP_COEFF, in %RH/degC */
+#define RH_TEMP_COEFF (-0.15f)
+
+typedef struct
+{
+    int64_t temperature; /* TEMP - T2, 0.01 degC */
+    int64_t pressure;    /* P, 0.01 mbar         */
+} PT_Result;
+
+/* Datasheet first and second-order compensation, shared by both paths */
+static PT_Result compensate_pt(const MS8607_Prom* p_prom, const MS8607_Raw* p_raw)
+{
+    PT_Result result;
+    int64_t dt;
+    int64_t temp;
+    int64_t t2;
+    int64_t off;
+    int64_t off2;
+    int64_t sens;
+    int64_t sens2;
+    int64_t low;
+
+    dt   = (int64_t) p_raw->d2 - ((int64_t) p_prom->c[5] << 8);
+    temp = 2000 + ((dt * (int64_t) p_prom->c[6]) >> 23);
+
+    if (temp < 2000)
+    {
+        low   = (temp - 2000) * (temp - 2000);
+        t2    = (3 * dt * dt) >> 33;
+        off2  = (61 * low) / 16;
+        sens2 = (29 * low) / 16;
+
+        if (temp < -1500)
+        {
+            low    = (temp + 1500) * (temp + 1500);
+            off2  += 17 * low;
+            sens2 += 9 * low;
+        }
+    }
+    else
+    {
+        t2    = (5 * dt * dt) >> 38;
+        off2  = 0;
+        sens2 = 0;
+    }
+
+    off  = ((int64_t) p_prom->c[2] << 17) + (((int64_t) p_prom->c[4] * dt) >> 6) - off2;
+    sens = ((int64_t) p_prom->c[1] << 16) + (((int64_t) p_prom->c[3] * dt) >> 7) - sens2;
+
+    result.temperature = temp - t2;
+    result.pressure    = ((((int64_t) p_raw->d1 * sens) >> 21) - off) >> 15;
+
+    return result;
+}
+
+/* Floor division by a positive constant, C division truncates toward zero */
+static int32_t div_floor(int32_t num, int32_t den)
+{
+    int32_t quot;
+
+    quot = num / den;
+
+    if ((num % den) < 0)
+    {
+        quot--;
+    }
+
+    return quot;
+}
+
+void ms8607_comp_fixed(const MS8607_Prom* p_prom, const MS8607_Raw* p_raw, MS8607_Result* p_result)
+{
+    PT_Result pt;
+    int64_t num;
+
+    pt = compensate_pt(p_prom, p_raw);
+
+    /*
+     * In 0.01 %RH, over a common denominator of 5 * 2^16:
+     *
+     *     RH = (5 * 100 * RH_MUL * D3 + 0.15 * 5 * 2^16 * (T - 2000)) / (5 * 2^16) + 100 * RH_ADD
+     *
+     * The numerator needs 33 bits, but a 64-bit division is a library call on the Cortex-M7.
+     * Shifting out the 2^16 first (floor) and then dividing by 5 (floor) gives the same result
+     * as one floor division, and adding half the denominator rounds to nearest, halves up.
+     */
+    num = (5LL * 100LL * RH_MUL * (int64_t) p_raw->d3) + ((15LL * 5LL * 65536LL / 100LL) * (pt.temperature - 2000)) +
+          (5LL * 32768LL);
+
+    p_result->temperature = (int32_t) pt.temperature;
+    p_result->pressure    = (int32_t) pt.pressure;
+    p_result->humidity    = div_floor((int32_t) (num >> 16), 5) + (100 * RH_ADD);
+}
+
+void ms8607_comp_float(const MS8607_Prom* p_prom, const MS8607_Raw* p_raw,
+                       float* p_temperature, float* p_pressure, float* p_humidity)
+{
+    PT_Result pt;
+    float humidity;
+
+    pt = compensate_pt(p_prom, p_raw);
+
+    *p_temperature = (float) pt.temperature / 100.0f;
+    *p_pressure    = (float) pt.pressure / 100.0f;
+
+    humidity    = (((float) p_raw->d3 * (float) RH_MUL) / 65536.0f) + (float) RH_ADD;
+    *p_humidity = humidity + ((20.0f - *p_temperature) * RH_TEMP_COEFF);
+}
+
+/* CRC-4 over the 7 PROM words with the CRC nibble (top of C0) cleared */
+uint8_t ms8607_prom_crc(const MS8607_Prom* p_prom)
+{
+    uint16_t words[MS8607_PROM_WORDS + 1U];
+    uint16_t rem;
+    uint32_t i;
+    uint32_t bit;
+
+    for (i = 0; i < MS8607_PROM_WORDS; i++)
+    {
+        words[i] = p_prom->c[i];
+    }
+
+    words[0]                 &= 0x0FFFU;
+    words[MS8607_PROM_WORDS]  = 0;
+    rem                       = 0;
+
+    for (i = 0; i < ((MS8607_PROM_WORDS + 1U) * 2U); i++)
+    {
+        rem ^= ((i % 2U) == 1U) ? (words[i / 2U] & 0x00FFU) : (words[i / 2U] >> 8);
+
+        for (bit = 0; bit < 8U; bit++)
+        {
+            rem = ((rem & 0x8000U) != 0U) ? (uint16_t) ((rem << 1) ^ 0x3000U) : (uint16_t) (rem << 1);
+        }
+    }
+
+    return (uint8_t) ((rem >> 12) & 0x000FU);
+}
+
+/* CRC-8 of a humidity answer, polynomial x^8 + x^5 + x^4 + 1, initial value 0 */
+uint8_t ms8607_rh_crc(const uint8_t* p_data, uint32_t size)
+{
+    uint8_t crc;
+    uint32_t i;
+    uint32_t bit;
+
+    crc = 0;
+
+    for (i = 0; i < size; i++)
+    {
+        crc ^= p_data[i];
+
+        for (bit = 0; bit < 8U; bit++)
+        {
+            crc = ((crc & 0x80U) != 0U) ? (uint8_t) ((crc << 1) ^ 0x31U) : (uint8_t) (crc << 1);
+        }
+    }
+
+    return crc;
+}
@@ -0,0 +1,42 @@
+/**
+ * @file   ms8607_comp.h
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  MS8607 raw-to-engineering-unit compensation.
+ */
+
+#ifndef MS8607_COMP_H
+#define MS8607_COMP_H
+
+#include <stdint.h>
+
+/* Pressure and temperature PROM words, C0 holds the CRC, C1-C6 the calibration coefficients */
+#define MS8607_PROM_WORDS (7U)
+
+typedef struct
+{
+    uint16_t c[MS8607_PROM_WORDS];
+} MS8607_Prom;
+
+typedef struct
+{
+    uint32_t d1; /* Pressure ADC (24-bit)                             */
+    uint32_t d2; /* Temperature ADC (24-bit)                          */
+    uint16_t d3; /* Relative humidity ADC (16-bit, status bits clear) */
+} MS8607_Raw;
+
+/* Fixed point results, in the same 0.01 units as the telemetry frame fields */
+typedef struct
+{
+    int32_t temperature; /* 0.01 degC                         */
+    int32_t pressure;    /* 0.01 mbar                         */
+    int32_t humidity;    /* 0.01 %RH, temperature compensated */
+} MS8607_Result;
+
+void ms8607_comp_fixed(const MS8607_Prom* p_prom, const MS8607_Raw* p_raw, MS8607_Result* p_result);
+void ms8607_comp_float(const MS8607_Prom* p_prom, const MS8607_Raw* p_raw,
+                       float* p_temperature, float* p_pressure, float* p_humidity);
+
+uint8_t ms8607_prom_crc(const MS8607_Prom* p_prom);
+uint8_t ms8607_rh_crc  (const uint8_t* p_data, uint32_t size);
+
+#endif /* MS8607_COMP_H */
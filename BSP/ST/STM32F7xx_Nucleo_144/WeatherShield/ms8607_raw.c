@@ -0,0 +1,269 @@
+/**
+ * @file   ms8607_raw.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  MS8607 calibration and raw ADC reads.
+ *
+ *         The TE driver only returns compensated floats, so the fixed point path
+ *         (ms8607_comp.c) reads the PROM and ADC words itself through the same I2C shims.
+ *         Call these after `ms8607_init` and `ms8607_reset`, which leave the pressure
+ *         sensor and the humidity sensor (12-bit) in their default configuration.
+ *
+ *         The humidity sensor is a separate device on the bus, so its measurement is
+ *         started first and runs while the two pressure sensor conversions complete. The
+ *         humidity resolution itself is set in the sensor's user register by the TE driver
+ *         (`ms8607_set_humidity_resolution`), here it only decides how long to wait.
+ *
+ *         `ms8607_raw_read_channels` only runs the conversions it is asked for and leaves
+ *         the other words of the result untouched, so a caller can keep the last D2
+ *         (temperature) and reuse it to compensate a pressure or humidity reading.
+ *
+ *         The PROM and ADC reads send their command and read the answer in one
+ *         transaction, with a repeated START in between (`i2c_master_write_read_packet_wait`).
+ *
+ *         The pressure and humidity sensors are two devices on the bus, so
+ *         `ms8607_raw_set_baud_rate` sets the SCL speed of both.
+ *
+ *         Waits are rounded up to whole ticks plus one, since a delay of n ticks can end
+ *         up to a tick early depending on where in the current tick it starts.
+ *
+ *         References:
+ *             - TE Connectivity MS8607-02BA01 datasheet, "PT Commands", "PROM CRC", "RH
+ *               Commands", and "CRC-8 checksum calculation".
+ */
+
+#include "ms8607_raw.h"
+
+#include <i2c.h>
+#include <ms8607.h>
+#include <ms8607_comp.h>
+
+#include <stdint.h>
+
+#define PT_ADDR                 (0x76U)
+#define PT_CMD_PROM_READ        (0xA0U)
+#define PT_CMD_CONVERT_D1       (0x40U)
+#define PT_CMD_CONVERT_D2       (0x50U)
+#define PT_CMD_ADC_READ         (0x00U)
+
+#define RH_ADDR                 (0x40U)
+#define RH_CMD_MEASURE_NO_HOLD  (0xF5U)
+#define RH_STATUS_MASK          (0x0003U)
+
+/* Datasheet maximum conversion times, indexed by enum ms8607_pressure_resolution (OSR 256 to 8192) */
+static const uint32_t PtConversionUs[] = {560U, 1100U, 2170U, 4320U, 8610U, 17200U};
+
+static void delay_us(uint32_t duration_us)
+{
+    delay_ms(((duration_us + 999U) / 1000U) + 1U);
+}
+
+static enum status_code write_command(uint16_t address, uint8_t command)
+{
+    struct i2c_master_packet packet;
+
+    packet.address     = address;
+    packet.data_length = 1;
+    packet.data        = &command;
+
+    return i2c_master_write_packet_wait(&packet);
+}
+
+static enum status_code read_bytes(uint16_t address, uint8_t* p_data, uint16_t size)
+{
+    struct i2c_master_packet packet;
+
+    packet.address     = address;
+    packet.data_length = size;
+    packet.data        = p_data;
+
+    return i2c_master_read_packet_wait(&packet);
+}
+
+/* Command and read in one transaction (repeated START), for the PROM and ADC reads */
+static enum status_code command_read(uint16_t address, uint8_t command, uint8_t* p_data, uint16_t size)
+{
+    struct i2c_master_packet write_packet;
+    struct i2c_master_packet read_packet;
+
+    write_packet.address     = address;
+    write_packet.data_length = 1;
+    write_packet.data        = &command;
+
+    read_packet.address     = address;
+    read_packet.data_length = size;
+    read_packet.data        = p_data;
+
+    return i2c_master_write_read_packet_wait(&write_packet, &read_packet);
+}
+
+/* The OSR code is added to the conversion command as 2 * osr, like the TE driver does */
+static enum status_code read_pt_adc(uint8_t command, enum ms8607_pressure_resolution osr, uint32_t* p_adc)
+{
+    enum status_code status;
+    uint8_t buf[3];
+
+    status = write_command(PT_ADDR, (uint8_t) (command | ((uint8_t) osr * 2U)));
+
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
+
+    delay_us(ms8607_raw_pt_conversion_us(osr));
+
+    status = command_read(PT_ADDR, PT_CMD_ADC_READ, buf, sizeof(buf));
+
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
+
+    *p_adc = ((uint32_t) buf[0] << 16) | ((uint32_t) buf[1] << 8) | (uint32_t) buf[2];
+
+    /* The sensor returns 0 if the conversion did not run, or if the result was already read (a retried read) */
+    return (*p_adc != 0U) ? STATUS_OK : STATUS_ERR_BAD_DATA;
+}
+
+enum status_code ms8607_raw_set_baud_rate(enum i2c_master_baud_rate baud_rate)
+{
+    enum status_code status;
+
+    status = i2c_master_set_baud_rate(PT_ADDR, baud_rate);
+
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
+
+    return i2c_master_set_baud_rate(RH_ADDR, baud_rate);
+}
+
+uint32_t ms8607_raw_pt_conversion_us(enum ms8607_pressure_resolution osr)
+{
+    if ((uint32_t) osr >= (sizeof(PtConversionUs) / sizeof(PtConversionUs[0])))
+    {
+        return PtConversionUs[(sizeof(PtConversionUs) / sizeof(PtConversionUs[0])) - 1U];
+    }
+
+    return PtConversionUs[osr];
+}
+
+uint32_t ms8607_raw_rh_conversion_us(enum ms8607_humidity_resolution rh_resolution)
+{
+    switch (rh_resolution)
+    {
+    case ms8607_humidity_resolution_8b:
+        return 3000U;
+
+    case ms8607_humidity_resolution_10b:
+        return 5000U;
+
+    case ms8607_humidity_resolution_11b:
+        return 9000U;
+
+    /* 12-bit, or bad input */
+    default:
+        return 16000U;
+    }
+}
+
+enum status_code ms8607_raw_read_prom(MS8607_Prom* p_prom)
+{
+    enum status_code status;
+    uint8_t buf[2];
+    uint32_t i;
+
+    for (i = 0; i < MS8607_PROM_WORDS; i++)
+    {
+        status = command_read(PT_ADDR, (uint8_t) (PT_CMD_PROM_READ + (i * 2U)), buf, sizeof(buf));
+
+        if (status != STATUS_OK)
+        {
+            return status;
+        }
+
+        p_prom->c[i] = (uint16_t) (((uint16_t) buf[0] << 8) | buf[1]);
+    }
+
+    return (ms8607_prom_crc(p_prom) == (p_prom->c[0] >> 12)) ? STATUS_OK : STATUS_ERR_BAD_DATA;
+}
+
+enum status_code ms8607_raw_read(enum ms8607_pressure_resolution osr,
+                                 enum ms8607_humidity_resolution rh_resolution, MS8607_Raw* p_raw)
+{
+    return ms8607_raw_read_channels(osr, rh_resolution, MS8607_RAW_ALL, p_raw);
+}
+
+enum status_code ms8607_raw_read_channels(enum ms8607_pressure_resolution osr,
+                                          enum ms8607_humidity_resolution rh_resolution, uint8_t conversions,
+                                          MS8607_Raw* p_raw)
+{
+    enum status_code status;
+    uint8_t buf[3];
+    uint32_t pt_us;
+    uint32_t rh_us;
+
+    pt_us = 0;
+    rh_us = ms8607_raw_rh_conversion_us(rh_resolution);
+
+    if ((conversions & MS8607_RAW_D3) != 0U)
+    {
+        status = write_command(RH_ADDR, RH_CMD_MEASURE_NO_HOLD);
+
+        if (status != STATUS_OK)
+        {
+            return status;
+        }
+    }
+
+    if ((conversions & MS8607_RAW_D2) != 0U)
+    {
+        status = read_pt_adc(PT_CMD_CONVERT_D2, osr, &p_raw->d2);
+
+        if (status != STATUS_OK)
+        {
+            return status;
+        }
+
+        pt_us += ms8607_raw_pt_conversion_us(osr);
+    }
+
+    if ((conversions & MS8607_RAW_D1) != 0U)
+    {
+        status = read_pt_adc(PT_CMD_CONVERT_D1, osr, &p_raw->d1);
+
+        if (status != STATUS_OK)
+        {
+            return status;
+        }
+
+        pt_us += ms8607_raw_pt_conversion_us(osr);
+    }
+
+    if ((conversions & MS8607_RAW_D3) == 0U)
+    {
+        return STATUS_OK;
+    }
+
+    /* Each pressure sensor wait was at least its conversion time, only wait for what is left */
+    if (rh_us > pt_us)
+    {
+        delay_us(rh_us - pt_us);
+    }
+
+    status = read_bytes(RH_ADDR, buf, sizeof(buf));
+
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
+
+    if (ms8607_rh_crc(buf, 2U) != buf[2])
+    {
+        return STATUS_ERR_BAD_DATA;
+    }
+
+    p_raw->d3 = (uint16_t) ((((uint16_t) buf[0] << 8) | buf[1]) & ~RH_STATUS_MASK);
+
+    return STATUS_OK;
+}
@@ -0,0 +1,32 @@
+/**
+ * @file   ms8607_raw.h
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  MS8607 calibration and raw ADC reads.
+ */
+
+#ifndef MS8607_RAW_H
+#define MS8607_RAW_H
+
+#include <i2c.h>
+#include <ms8607.h>
+#include <ms8607_comp.h>
+
+#include <stdint.h>
+
+/* Conversions for ms8607_raw_read_channels */
+#define MS8607_RAW_D1  (1U << 0) /* Pressure    */
+#define MS8607_RAW_D2  (1U << 1) /* Temperature */
+#define MS8607_RAW_D3  (1U << 2) /* Humidity    */
+#define MS8607_RAW_ALL (MS8607_RAW_D1 | MS8607_RAW_D2 | MS8607_RAW_D3)
+
+enum status_code ms8607_raw_read_prom       (MS8607_Prom* p_prom);
+enum status_code ms8607_raw_read            (enum ms8607_pressure_resolution osr,
+                                             enum ms8607_humidity_resolution rh_resolution, MS8607_Raw* p_raw);
+enum status_code ms8607_raw_read_channels   (enum ms8607_pressure_resolution osr,
+                                             enum ms8607_humidity_resolution rh_resolution, uint8_t conversions,
+                                             MS8607_Raw* p_raw);
+enum status_code ms8607_raw_set_baud_rate   (enum i2c_master_baud_rate baud_rate);
+uint32_t         ms8607_raw_pt_conversion_us(enum ms8607_pressure_resolution osr);
+uint32_t         ms8607_raw_rh_conversion_us(enum ms8607_humidity_resolution rh_resolution);
+
+#endif /* MS8607_RAW_H */
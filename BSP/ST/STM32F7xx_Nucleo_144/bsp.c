@@ -39,6 +39,11 @@
 
 #include <stdint.h>
 
+#define SWI_IRQn       RNG_IRQn
+#define SWI_IRQHandler RNG_IRQHandler
+
+static BSP_SWIHandler SwiHandler;
+
 static void SystemClock_Config(void)
 {
     RCC_ClkInitTypeDef RCC_ClkInitStruct;
@@ -83,6 +88,11 @@ BSP_RESULT BSP_Init(void)
     CPU_IntEn();
     SystemClock_Config();
 
+    if (BSP_CRC_Init() != BSP_SUCCESS)
+    {
+        return BSP_FAILURE;
+    }
+
     if (BSP_LED_Init() != BSP_SUCCESS)
     {
         return BSP_FAILURE;
@@ -110,9 +120,47 @@ CPU_INT32U BSP_CPU_ClkFreq(void)
 
 void BSP_Tick_Init(void)
 {
+    /* Latch the timebase before the first tick so both start counting together */
+    BSP_Timebase_Init();
+
     OS_CPU_SysTickInitFreq(BSP_CPU_ClkFreq());
 }
 
+/*
+ * Runs `handler` from a software-pended interrupt, like a device interrupt would, so
+ * tasks can be benchmarked against an ISR post. The RNG interrupt is borrowed since
+ * the RNG is not used, pending it in the NVIC does not need the peripheral.
+ */
+BSP_RESULT BSP_SWI_Trigger(BSP_SWIHandler handler)
+{
+    if (handler == NULL)
+    {
+        return BSP_FAILURE;
+    }
+
+    SwiHandler = handler;
+
+    /* The handler posts to the kernel */
+    HAL_NVIC_SetPriority(SWI_IRQn, BSP_NVIC_PRIO_KERNEL_AWARE, 0);
+    HAL_NVIC_EnableIRQ(SWI_IRQn);
+    HAL_NVIC_SetPendingIRQ(SWI_IRQn);
+
+    return BSP_SUCCESS;
+}
+
+void SWI_IRQHandler(void)
+{
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    OSIntEnter();
+    CPU_CRITICAL_EXIT();
+
+    SwiHandler();
+
+    OSIntExit();
+}
+
 /*
  * STM32 HAL functions.
  *
@@ -18,6 +18,22 @@
 
 typedef uint8_t BSP_RESULT;
 
+/*
+ * NVIC preemption priority for interrupts that call the kernel. Priorities numerically below
+ * CPU_CFG_KA_IPL_BOUNDARY (cpu_cfg.h) are not masked by the kernel's critical sections, so an
+ * interrupt there must never post, enter or exit through the kernel.
+ */
+#define BSP_NVIC_PRIO_KERNEL_AWARE (CPU_CFG_KA_IPL_BOUNDARY)
+
+/* Channels for BSP_Sensor_ReadChannels, combined into a mask */
+#define SENSOR_CHANNEL_TEMPERATURE (1U << 0)
+#define SENSOR_CHANNEL_HUMIDITY    (1U << 1)
+#define SENSOR_CHANNEL_PRESSURE    (1U << 2)
+#define SENSOR_CHANNEL_ALL         (SENSOR_CHANNEL_TEMPERATURE | SENSOR_CHANNEL_HUMIDITY | SENSOR_CHANNEL_PRESSURE)
+
+/* Number of power-of-two recovery time buckets, the last bucket collects everything >= 2^14 us */
+#define SENSOR_BUS_RECOVERY_HIST_SIZE (16U)
+
 typedef enum
 {
     Sensor_MS8607,
@@ -25,14 +41,74 @@ typedef enum
 
 typedef struct
 {
-    float temperature;
-    bool  temperature_is_valid;
-    float humidity;
-    bool  humidity_is_valid;
-    float pressure;
-    bool  pressure_is_valid;
+    uint64_t timestamp_ns; /* BSP_Timebase_GetNs() when the read started */
+    float    temperature;
+    bool     temperature_is_valid;
+    float    humidity;
+    bool     humidity_is_valid;
+    float    pressure;
+    bool     pressure_is_valid;
 } Sensor_Data;
 
+/* Pressure and temperature oversampling ratio, higher is slower and less noisy */
+typedef enum
+{
+    Sensor_OSR_256,
+    Sensor_OSR_512,
+    Sensor_OSR_1024,
+    Sensor_OSR_2048,
+    Sensor_OSR_4096,
+    Sensor_OSR_8192,
+} Sensor_OSRTypeDef;
+
+/* Relative humidity ADC resolution, higher is slower and less noisy */
+typedef enum
+{
+    Sensor_RH_8Bit,
+    Sensor_RH_10Bit,
+    Sensor_RH_11Bit,
+    Sensor_RH_12Bit,
+} Sensor_RHResolutionTypeDef;
+
+typedef struct
+{
+    Sensor_OSRTypeDef          osr;           /* Pressure and temperature */
+    Sensor_RHResolutionTypeDef rh_resolution; /* Humidity                 */
+} Sensor_Resolution;
+
+/* I2C SCL frequency of a sensor */
+typedef enum
+{
+    Sensor_BusSpeed_100kHz, /* Standard-mode  */
+    Sensor_BusSpeed_400kHz, /* Fast-mode      */
+    Sensor_BusSpeed_1MHz,   /* Fast-mode Plus */
+} Sensor_BusSpeedTypeDef;
+
+typedef struct
+{
+    uint32_t num_transfers;                                /* Transfers, including failed ones            */
+    uint64_t transfer_ns;                                  /* Total time in transfers, including retries  */
+    uint32_t num_errors;                                   /* Transfers that hit a bus error or timeout   */
+    uint32_t num_retries;                                  /* Transfers repeated after a bus recovery     */
+    uint32_t num_recoveries;                               /* SCL clock-outs with peripheral reset        */
+    uint32_t num_failures;                                 /* Transfers that failed after the last retry  */
+    uint32_t recovery_max_us;                              /* Worst recovery time                         */
+    uint32_t recovery_hist[SENSOR_BUS_RECOVERY_HIST_SIZE]; /* First error to success or giving up         */
+} Sensor_BusStats;
+
+typedef enum
+{
+    CRC_Algo_CRC16_CCITT,
+    CRC_Algo_CRC32,
+} CRC_AlgoTypeDef;
+
+typedef enum
+{
+    CRC_Mode_Software,
+    CRC_Mode_Polled,
+    CRC_Mode_DMA,
+} CRC_ModeTypeDef;
+
 typedef enum
 {
     LED_GREEN,
@@ -40,10 +116,22 @@ typedef enum
     LED_RED,
 } LED_TypeDef;
 
+/* Runs in interrupt context, see `BSP_SWI_Trigger` */
+typedef void (*BSP_SWIHandler)(void);
+
+/* Runs in the sampling interrupt with the interrupted PC and task, NULL if an interrupt was running */
+typedef void (*BSP_SamplerHandler)(uint32_t pc, OS_TCB* p_tcb);
+
 /* bsp.c */
 BSP_RESULT BSP_Init       (void);
 CPU_INT32U BSP_CPU_ClkFreq(void);
 void       BSP_Tick_Init  (void);
+BSP_RESULT BSP_SWI_Trigger(BSP_SWIHandler handler);
+
+/* bsp_crc.c */
+BSP_RESULT BSP_CRC_Init      (void);
+BSP_RESULT BSP_CRC_Calculate (CRC_AlgoTypeDef algo, CRC_ModeTypeDef mode, const uint8_t* data, size_t size, uint32_t* crc);
+BSP_RESULT BSP_CRC_Accumulate(CRC_AlgoTypeDef algo, CRC_ModeTypeDef mode, const uint8_t* data, size_t size, uint32_t* crc);
 
 /* bsp_led.c */
 BSP_RESULT BSP_LED_Init  (void);
@@ -51,10 +139,26 @@ BSP_RESULT BSP_LED_On    (LED_TypeDef led);
 BSP_RESULT BSP_LED_Off   (LED_TypeDef led);
 BSP_RESULT BSP_LED_Toggle(LED_TypeDef led);
 
+/* bsp_sampler.c */
+BSP_RESULT BSP_Sampler_Start(uint32_t rate_hz, BSP_SamplerHandler handler);
+BSP_RESULT BSP_Sampler_Stop (void);
+
 /* bsp_sensor.c */
-BSP_RESULT BSP_Sensor_Init (void);
-BSP_RESULT BSP_Sensor_Reset(Sensor_TypeDef sensor);
-BSP_RESULT BSP_Sensor_Read (Sensor_TypeDef sensor, Sensor_Data* data);
+BSP_RESULT BSP_Sensor_Init         (void);
+BSP_RESULT BSP_Sensor_Reset        (Sensor_TypeDef sensor);
+BSP_RESULT BSP_Sensor_Read         (Sensor_TypeDef sensor, Sensor_Data* data);
+BSP_RESULT BSP_Sensor_ReadChannels (Sensor_TypeDef sensor, uint8_t channels, Sensor_Data* data);
+BSP_RESULT BSP_Sensor_SetResolution(Sensor_TypeDef sensor, const Sensor_Resolution* resolution);
+BSP_RESULT BSP_Sensor_GetLatency   (Sensor_TypeDef sensor, uint32_t* latency_us);
+BSP_RESULT BSP_Sensor_SetBusSpeed  (Sensor_TypeDef sensor, Sensor_BusSpeedTypeDef speed);
+BSP_RESULT BSP_Sensor_GetBusStats  (Sensor_BusStats* stats);
+BSP_RESULT BSP_Sensor_ResetBusStats(void);
+
+/* bsp_timebase.c */
+void     BSP_Timebase_Init (void);
+void     BSP_Timebase_Tick (void);
+void     BSP_Timebase_Idle (void);
+uint64_t BSP_Timebase_GetNs(void);
 
 /* bsp_uart.c */
 BSP_RESULT BSP_UART_Init    (void);
@@ -0,0 +1,431 @@
+/**
+ * @file   bsp_crc.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Thread-safe CRC driver.
+ *
+ *         Supports two algorithms, chosen to match what the host tools can check easily:
+ *
+ *             - CRC_Algo_CRC16_CCITT: CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF, no reflection).
+ *             - CRC_Algo_CRC32: CRC-32 as used by zlib/Ethernet (reflected, final XOR).
+ *
+ *         And three ways of computing them:
+ *
+ *             - CRC_Mode_Software: Byte-wise table-driven CRC on the CPU. Does not touch the
+ *               hardware so it needs no locking, and it is the only mode in the hosted build.
+ *             - CRC_Mode_Polled: The CPU writes the data into the CRC peripheral, a word at a
+ *               time where alignment allows.
+ *             - CRC_Mode_DMA: DMA2 streams the data into the CRC peripheral and the calling task
+ *               pends on a semaphore until the transfer complete interrupt. Slower than polled
+ *               for small buffers because of the setup cost, but the CPU is free while it runs.
+ *
+ *         The CRC peripheral is shared by all tasks and is protected by a mutex, same as the
+ *         LED and sensor drivers. The DMA completion uses the same "unilateral rendezvous"
+ *         pattern as bsp_uart.c (uCOS-III The Real-Time Kernel: Page 264).
+ *
+ *         `BSP_CRC_Accumulate` continues a CRC over data that is not contiguous in memory, e.g.
+ *         a stream of log records. `*crc` must hold the result of a previous Calculate/Accumulate
+ *         call with the same algorithm.
+ */
+
+#include "bsp.h"
+
+#include <os.h>
+
+#if !defined(BSP_HOSTED)
+#include <stm32f7xx.h>
+#endif
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CRC16_POLY       (0x1021U)
+#define CRC16_INIT       (0xFFFFU)
+#define CRC32_POLY       (0x04C11DB7U)
+#define CRC32_POLY_REFL  (0xEDB88320U)
+#define CRC32_XOROUT     (0xFFFFFFFFU)
+
+static uint16_t Crc16Table[256];
+static uint32_t Crc32Table[256];
+
+#if !defined(BSP_HOSTED)
+#define CRCx_DMA_STREAM            DMA2_Stream0
+#define CRCx_DMA_CHANNEL           DMA_CHANNEL_0
+#define CRCx_DMA_IRQn              DMA2_Stream0_IRQn
+#define CRCx_DMA_IRQHandler        DMA2_Stream0_IRQHandler
+#define CRCx_DMA_CLK_ENABLE()      __HAL_RCC_DMA2_CLK_ENABLE()
+
+/* Largest number of items a single DMA transfer can move */
+#define DMA_MAX_TRANSFER           (0xFFFFU)
+#define DMA_TIMEOUT_TICKS          (100U)
+
+/* CR field values, see RM0410 section 14.4 */
+#define CRC_CR_POLYSIZE_32         (0U)
+#define CRC_CR_POLYSIZE_16         (CRC_CR_POLYSIZE_0)
+#define CRC_CR_REV_IN_NONE         (0U)
+#define CRC_CR_REV_IN_BYTE         (CRC_CR_REV_IN_0)
+#define CRC_CR_REV_IN_WORD         (CRC_CR_REV_IN_0 | CRC_CR_REV_IN_1)
+
+static OS_MUTEX          CrcMutex;
+static OS_SEM            CrcDmaSemaphore;
+static DMA_HandleTypeDef CrcDmaHandle;
+static volatile bool     CrcDmaError;
+#endif
+
+static void CRC_BuildTables(void)
+{
+    uint32_t i;
+    uint32_t bit;
+    uint16_t crc16;
+    uint32_t crc32;
+
+    for (i = 0; i < 256U; i++)
+    {
+        crc16 = (uint16_t) (i << 8);
+        crc32 = i;
+
+        for (bit = 0; bit < 8U; bit++)
+        {
+            crc16 = (crc16 & 0x8000U) ? (uint16_t) ((crc16 << 1) ^ CRC16_POLY) : (uint16_t) (crc16 << 1);
+            crc32 = (crc32 & 1U) ? ((crc32 >> 1) ^ CRC32_POLY_REFL) : (crc32 >> 1);
+        }
+
+        Crc16Table[i] = crc16;
+        Crc32Table[i] = crc32;
+    }
+}
+
+/*
+ * All modes work on the raw CRC register: the value before the CRC-32 final XOR, in the
+ * bit order of the software tables (reflected for CRC-32).
+ */
+static uint32_t CRC_RawFromResult(CRC_AlgoTypeDef algo, uint32_t crc)
+{
+    return (algo == CRC_Algo_CRC32) ? (crc ^ CRC32_XOROUT) : crc;
+}
+
+static uint32_t CRC_ResultFromRaw(CRC_AlgoTypeDef algo, uint32_t raw)
+{
+    return (algo == CRC_Algo_CRC32) ? (raw ^ CRC32_XOROUT) : (raw & 0xFFFFU);
+}
+
+static uint32_t CRC_Software(CRC_AlgoTypeDef algo, uint32_t raw, const uint8_t* data, size_t size)
+{
+    size_t i;
+
+    if (algo == CRC_Algo_CRC32)
+    {
+        for (i = 0; i < size; i++)
+        {
+            raw = (raw >> 8) ^ Crc32Table[(raw ^ data[i]) & 0xFFU];
+        }
+    }
+    else
+    {
+        for (i = 0; i < size; i++)
+        {
+            raw = ((raw << 8) ^ Crc16Table[((raw >> 8) ^ data[i]) & 0xFFU]) & 0xFFFFU;
+        }
+    }
+
+    return raw;
+}
+
+#if !defined(BSP_HOSTED)
+/*
+ * Program the peripheral to continue from `raw`. The hardware shifts MSB first, so for
+ * the reflected CRC-32 the input is bit-reversed by the peripheral and the register value
+ * is bit-reversed on the way in (INIT) and on the way out (REV_OUT).
+ */
+static void CRC_HwStart(CRC_AlgoTypeDef algo, uint32_t raw)
+{
+    if (algo == CRC_Algo_CRC32)
+    {
+        CRC->POL  = CRC32_POLY;
+        CRC->CR   = CRC_CR_POLYSIZE_32 | CRC_CR_REV_IN_BYTE | CRC_CR_REV_OUT;
+        CRC->INIT = __RBIT(raw);
+    }
+    else
+    {
+        CRC->POL  = CRC16_POLY;
+        CRC->CR   = CRC_CR_POLYSIZE_16 | CRC_CR_REV_IN_NONE;
+        CRC->INIT = raw;
+    }
+
+    /* Load INIT into the calculation register */
+    CRC->CR |= CRC_CR_RESET;
+}
+
+static uint32_t CRC_HwResult(CRC_AlgoTypeDef algo)
+{
+    return (algo == CRC_Algo_CRC32) ? CRC->DR : (CRC->DR & 0xFFFFU);
+}
+
+static void CRC_HwPolled(CRC_AlgoTypeDef algo, const uint8_t* data, size_t size)
+{
+    uint32_t word;
+    uint32_t byte_rev_in;
+
+    byte_rev_in = CRC->CR & (CRC_CR_REV_IN_0 | CRC_CR_REV_IN_1);
+
+    /* Leading bytes up to a word boundary */
+    while ((size > 0U) && (((uintptr_t) data & 3U) != 0U))
+    {
+        *(__IO uint8_t*) &CRC->DR = *data++;
+        size--;
+    }
+
+    /*
+     * Whole words. The peripheral consumes a 32-bit write MSB first, but memory is little
+     * endian. For CRC-32, reversing all 32 bits on input (REV_IN word) puts the first byte
+     * first. For CRC-16 there is no input reversal, so swap the bytes instead.
+     */
+    if (algo == CRC_Algo_CRC32)
+    {
+        CRC->CR = (CRC->CR & ~(CRC_CR_REV_IN_0 | CRC_CR_REV_IN_1)) | CRC_CR_REV_IN_WORD;
+    }
+
+    while (size >= 4U)
+    {
+        word = *(const uint32_t*) data;
+        *(__IO uint32_t*) &CRC->DR = (algo == CRC_Algo_CRC32) ? word : __REV(word);
+        data += 4;
+        size -= 4U;
+    }
+
+    CRC->CR = (CRC->CR & ~(CRC_CR_REV_IN_0 | CRC_CR_REV_IN_1)) | byte_rev_in;
+
+    /* Trailing bytes */
+    while (size > 0U)
+    {
+        *(__IO uint8_t*) &CRC->DR = *data++;
+        size--;
+    }
+}
+
+static BSP_RESULT CRC_HwDMA(const uint8_t* data, size_t size)
+{
+    OS_ERR err;
+    uint32_t chunk;
+    uintptr_t start;
+
+    /* D-cache is enabled, make sure the DMA reads what the CPU wrote */
+    start = (uintptr_t) data & ~(uintptr_t) 31U;
+    SCB_CleanDCache_by_Addr((uint32_t*) start, (int32_t) (size + ((uintptr_t) data - start)));
+
+    while (size > 0U)
+    {
+        chunk       = (size > DMA_MAX_TRANSFER) ? DMA_MAX_TRANSFER : (uint32_t) size;
+        CrcDmaError = false;
+
+        /* Byte transfers, the source increments and the destination is always CRC->DR */
+        if (HAL_DMA_Start_IT(&CrcDmaHandle, (uint32_t) data, (uint32_t) &CRC->DR, chunk) != HAL_OK)
+        {
+            return BSP_FAILURE;
+        }
+
+        OSSemPend((OS_SEM*) &CrcDmaSemaphore,
+                  (OS_TICK) DMA_TIMEOUT_TICKS,
+                  (OS_OPT)  OS_OPT_PEND_BLOCKING,
+                  (CPU_TS*) NULL,
+                  (OS_ERR*) &err);
+
+        if ((err != OS_ERR_NONE) || (CrcDmaError == true))
+        {
+            (void) HAL_DMA_Abort(&CrcDmaHandle);
+            return BSP_FAILURE;
+        }
+
+        data += chunk;
+        size -= chunk;
+    }
+
+    return BSP_SUCCESS;
+}
+
+static void CRC_DmaXferCplt(DMA_HandleTypeDef* hdma)
+{
+    OS_ERR err;
+
+    OSSemPost((OS_SEM*) &CrcDmaSemaphore,
+              (OS_OPT)  OS_OPT_POST_1,
+              (OS_ERR*) &err);
+}
+
+static void CRC_DmaXferError(DMA_HandleTypeDef* hdma)
+{
+    CrcDmaError = true;
+    CRC_DmaXferCplt(hdma);
+}
+
+static BSP_RESULT CRC_Hardware(CRC_AlgoTypeDef algo, CRC_ModeTypeDef mode, uint32_t* raw,
+                               const uint8_t* data, size_t size)
+{
+    OS_ERR err;
+    BSP_RESULT result;
+
+    OSMutexPend((OS_MUTEX*) &CrcMutex,
+                (OS_TICK)   0,
+                (OS_OPT)    OS_OPT_PEND_BLOCKING,
+                (CPU_TS*)   NULL,
+                (OS_ERR*)   &err);
+
+    if (err != OS_ERR_NONE)
+    {
+        return BSP_FAILURE;
+    }
+
+    CRC_HwStart(algo, *raw);
+
+    if (mode == CRC_Mode_DMA)
+    {
+        result = CRC_HwDMA(data, size);
+    }
+    else
+    {
+        CRC_HwPolled(algo, data, size);
+        result = BSP_SUCCESS;
+    }
+
+    /* With REV_OUT the CRC-32 result is already in the reflected software representation */
+    *raw = CRC_HwResult(algo);
+
+    OSMutexPost((OS_MUTEX*) &CrcMutex,
+                (OS_OPT)    OS_OPT_POST_NONE,
+                (OS_ERR*)   &err);
+
+    if (err != OS_ERR_NONE)
+    {
+        return BSP_FAILURE;
+    }
+
+    return result;
+}
+#endif
+
+/* Only call this function from startup code (single task) */
+BSP_RESULT BSP_CRC_Init(void)
+{
+#if !defined(BSP_HOSTED)
+    OS_ERR err;
+#endif
+
+    CRC_BuildTables();
+
+#if !defined(BSP_HOSTED)
+    __HAL_RCC_CRC_CLK_ENABLE();
+    CRCx_DMA_CLK_ENABLE();
+
+    /* Memory to memory: the "peripheral" side is the source buffer, the "memory" side is CRC->DR */
+    CrcDmaHandle.Instance                 = CRCx_DMA_STREAM;
+    CrcDmaHandle.Init.Channel             = CRCx_DMA_CHANNEL;
+    CrcDmaHandle.Init.Direction           = DMA_MEMORY_TO_MEMORY;
+    CrcDmaHandle.Init.PeriphInc           = DMA_PINC_ENABLE;
+    CrcDmaHandle.Init.MemInc              = DMA_MINC_DISABLE;
+    CrcDmaHandle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    CrcDmaHandle.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+    CrcDmaHandle.Init.Mode                = DMA_NORMAL;
+    CrcDmaHandle.Init.Priority            = DMA_PRIORITY_LOW;
+    CrcDmaHandle.Init.FIFOMode            = DMA_FIFOMODE_ENABLE;
+    CrcDmaHandle.Init.FIFOThreshold       = DMA_FIFO_THRESHOLD_FULL;
+    CrcDmaHandle.Init.MemBurst            = DMA_MBURST_SINGLE;
+    CrcDmaHandle.Init.PeriphBurst         = DMA_PBURST_SINGLE;
+
+    if (HAL_DMA_Init(&CrcDmaHandle) != HAL_OK)
+    {
+        return BSP_FAILURE;
+    }
+
+    CrcDmaHandle.XferCpltCallback  = CRC_DmaXferCplt;
+    CrcDmaHandle.XferErrorCallback = CRC_DmaXferError;
+
+    /* The completion callback posts to the kernel */
+    HAL_NVIC_SetPriority(CRCx_DMA_IRQn, BSP_NVIC_PRIO_KERNEL_AWARE, 0);
+    HAL_NVIC_EnableIRQ(CRCx_DMA_IRQn);
+
+    OSSemCreate(&CrcDmaSemaphore, "CRC DMA Semaphore", 0, &err);
+
+    if (err != OS_ERR_NONE)
+    {
+        return BSP_FAILURE;
+    }
+
+    /* Create CRC mutex, allowing multiple tasks to use the CRC peripheral safely */
+    OSMutexCreate((OS_MUTEX*) &CrcMutex,
+                  (CPU_CHAR*) "CRC Mutex",
+                  (OS_ERR*)   &err);
+
+    if (err != OS_ERR_NONE)
+    {
+        return BSP_FAILURE;
+    }
+#endif
+
+    return BSP_SUCCESS;
+}
+
+BSP_RESULT BSP_CRC_Accumulate(CRC_AlgoTypeDef algo, CRC_ModeTypeDef mode, const uint8_t* data,
+                              size_t size, uint32_t* crc)
+{
+    uint32_t raw;
+
+    if ((crc == NULL) || ((data == NULL) && (size > 0U)))
+    {
+        return BSP_FAILURE;
+    }
+
+    if ((algo != CRC_Algo_CRC16_CCITT) && (algo != CRC_Algo_CRC32))
+    {
+        return BSP_FAILURE;
+    }
+
+    raw = CRC_RawFromResult(algo, *crc);
+
+#if !defined(BSP_HOSTED)
+    if ((mode == CRC_Mode_Polled) || (mode == CRC_Mode_DMA))
+    {
+        if (CRC_Hardware(algo, mode, &raw, data, size) != BSP_SUCCESS)
+        {
+            return BSP_FAILURE;
+        }
+    }
+    else
+#endif
+    {
+        /* The hosted build has no CRC peripheral, every mode falls back to software */
+        raw = CRC_Software(algo, raw, data, size);
+    }
+
+    *crc = CRC_ResultFromRaw(algo, raw);
+
+    return BSP_SUCCESS;
+}
+
+BSP_RESULT BSP_CRC_Calculate(CRC_AlgoTypeDef algo, CRC_ModeTypeDef mode, const uint8_t* data,
+                             size_t size, uint32_t* crc)
+{
+    if (crc == NULL)
+    {
+        return BSP_FAILURE;
+    }
+
+    /* Seed with the result of an empty message, so accumulating starts from the initial value */
+    *crc = (algo == CRC_Algo_CRC32) ? 0U : CRC16_INIT;
+
+    return BSP_CRC_Accumulate(algo, mode, data, size, crc);
+}
+
+#if !defined(BSP_HOSTED)
+void CRCx_DMA_IRQHandler(void)
+{
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    OSIntEnter();
+    CPU_CRITICAL_EXIT();
+
+    HAL_DMA_IRQHandler(&CrcDmaHandle);
+
+    OSIntExit();
+}
+#endif
@@ -0,0 +1,119 @@
+/**
+ * @file   bsp_sampler.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  PC sampling interrupt for the statistical profiler.
+ *
+ *         TIM7 interrupts at the requested rate and reports where the CPU was: the PC the
+ *         hardware stacked on interrupt entry, and the task that was running. If the
+ *         interrupt came in on top of another interrupt handler (EXC_RETURN says the main
+ *         stack was in use) the PC is the handler's and no task is reported. PendSV, and so
+ *         the context switch itself, counts as an interrupt handler.
+ *
+ *         The kernel tick would be a simpler source, but tasks released by the tick would
+ *         then never be sampled while they run, since every sample would be taken just
+ *         before they start. The rate should not be a multiple of the tick rate either, so
+ *         the samples drift through the tick period.
+ *
+ *         The interrupt has the highest priority, above the kernel's interrupt mask, so
+ *         critical sections and other interrupts are sampled too. It makes no kernel calls,
+ *         the handler only gets to read the current task pointer.
+ */
+
+#include "bsp.h"
+
+#include <os.h>
+#include <stm32f7xx.h>
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#define SAMPLER_TIM                 TIM7
+#define SAMPLER_TIM_CLK_ENABLE()    __HAL_RCC_TIM7_CLK_ENABLE()
+#define SAMPLER_TIM_FORCE_RESET()   __HAL_RCC_TIM7_FORCE_RESET()
+#define SAMPLER_TIM_RELEASE_RESET() __HAL_RCC_TIM7_RELEASE_RESET()
+#define SAMPLER_IRQn                TIM7_IRQn
+#define SAMPLER_IRQHandler          TIM7_IRQHandler
+
+/* Index of the PC in the exception frame: r0-r3, r12, lr, pc, xPSR */
+#define FRAME_PC                    (6U)
+
+/* EXC_RETURN bit set when the interrupted code was on the process stack, that is a task */
+#define EXC_RETURN_PSP              (1UL << 2)
+
+static BSP_SamplerHandler SamplerHandler;
+
+/* Not static, the naked interrupt handler branches to it */
+void SamplerSample(const uint32_t* p_frame, uint32_t exc_return);
+
+BSP_RESULT BSP_Sampler_Start(uint32_t rate_hz, BSP_SamplerHandler handler)
+{
+    uint32_t tim_clk;
+    uint32_t prescaler;
+    uint32_t period;
+
+    if ((handler == NULL) || (rate_hz == 0U))
+    {
+        return BSP_FAILURE;
+    }
+
+    /* APB1 timers run at twice PCLK1, since SystemClock_Config divides APB1 */
+    tim_clk   = HAL_RCC_GetPCLK1Freq() * 2U;
+    prescaler = (uint32_t) ((uint64_t) tim_clk / ((uint64_t) rate_hz * 65536U)) + 1U;
+    period    = tim_clk / (prescaler * rate_hz);
+
+    if ((period < 2U) || (prescaler > 65536U))
+    {
+        return BSP_FAILURE;
+    }
+
+    SamplerHandler = handler;
+
+    SAMPLER_TIM_CLK_ENABLE();
+
+    SAMPLER_TIM->CR1  = 0;
+    SAMPLER_TIM->PSC  = prescaler - 1U;
+    SAMPLER_TIM->ARR  = period - 1U;
+    SAMPLER_TIM->EGR  = TIM_EGR_UG;
+    SAMPLER_TIM->SR   = 0;
+    SAMPLER_TIM->DIER = TIM_DIER_UIE;
+
+    HAL_NVIC_SetPriority(SAMPLER_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(SAMPLER_IRQn);
+
+    SAMPLER_TIM->CR1 = TIM_CR1_CEN;
+
+    return BSP_SUCCESS;
+}
+
+/* Once this returns no more samples are taken, so the handler's data can be read */
+BSP_RESULT BSP_Sampler_Stop(void)
+{
+    HAL_NVIC_DisableIRQ(SAMPLER_IRQn);
+
+    SAMPLER_TIM_FORCE_RESET();
+    SAMPLER_TIM_RELEASE_RESET();
+
+    HAL_NVIC_ClearPendingIRQ(SAMPLER_IRQn);
+
+    return BSP_SUCCESS;
+}
+
+void SamplerSample(const uint32_t* p_frame, uint32_t exc_return)
+{
+    SAMPLER_TIM->SR = 0;
+
+    SamplerHandler(p_frame[FRAME_PC], ((exc_return & EXC_RETURN_PSP) != 0U) ? OSTCBCurPtr : NULL);
+}
+
+/* Passes the stack the frame is on and EXC_RETURN untouched, SamplerSample returns from the interrupt */
+__attribute__((naked)) void SAMPLER_IRQHandler(void)
+{
+    __asm volatile(
+        "tst   lr, #4          \n"
+        "ite   eq              \n"
+        "mrseq r0, msp         \n"
+        "mrsne r0, psp         \n"
+        "mov   r1, lr          \n"
+        "b     SamplerSample   \n"
+    );
+}
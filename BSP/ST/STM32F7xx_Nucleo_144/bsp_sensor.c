@@ -12,6 +12,38 @@
  *         Currently only the MS8607 sensor is supported in this driver,
  *         but it is written to allow easy expansion to all of the sensors
  *         on the Weather Shield.
+ *
+ *         With OS_CFG_SENSOR_FIXED_POINT_EN the MS8607 is read through
+ *         ms8607_raw.c and converted in fixed point (ms8607_comp.c) with
+ *         the calibration read at reset, instead of by the TE driver's
+ *         float conversion.
+ *
+ *         `BSP_Sensor_SetResolution` trades conversion time for noise. The
+ *         setting is kept per sensor, re-applied after a reset, and used by
+ *         every following read. `BSP_Sensor_GetLatency` returns the datasheet
+ *         conversion time of one read at the current setting.
+ *
+ *         `BSP_Sensor_ReadChannels` only converts the channels in its mask, the
+ *         others are returned as not valid. The TE driver has no API for part of
+ *         a reading, so these reads always go through ms8607_raw.c, with the
+ *         compensation selected by OS_CFG_SENSOR_FIXED_POINT_EN (the float form
+ *         is the driver's own math). Pressure and humidity both need the current
+ *         temperature (D2): pressure always converts it, humidity reuses the last
+ *         one converted if it is less than SENSOR_D2_MAX_AGE_NS old. The humidity
+ *         compensation is 0.15 %RH/degC, so the cap bounds the error a drifting
+ *         temperature can cause whatever the mix of reads. A full read through the
+ *         TE driver converts D2 without handing it back, so it drops the cached one.
+ *
+ *         Bus errors are retried with bus recovery in i2c.c, `BSP_Sensor_GetBusStats`
+ *         returns its counters.
+ *
+ *         `BSP_Sensor_SetBusSpeed` sets the SCL speed of a sensor's I2C addresses, which
+ *         i2c.c switches to before every transfer to them. Sensors behind different mux
+ *         inputs that share an address would share the speed too. The MS8607 datasheet
+ *         only specifies SCL up to 400 kHz.
+ *
+ *         The hosted build with `-DSHIELD_MODEL=ON` uses this driver as well, with i2c.c
+ *         talking to the MS8607 model in BSP/POSIX/Simulator. There is no mux to drive.
  */
 
 #include "bsp.h"
@@ -19,11 +51,17 @@
 #include <os.h>
 #include <i2c.h>
 #include <ms8607.h>
+#include <ms8607_comp.h>
+#include <ms8607_raw.h>
+
+#if !defined(BSP_HOSTED)
 #include <stm32f7xx.h>
+#endif
 
 #include <stdlib.h>
 #include <stdbool.h>
 
+#if !defined(BSP_HOSTED)
 /*
  * Along with an I2C bus, the Weather Shield uses 3 GPIO pins:
  *     - Enable (active low): Turns on the mux.
@@ -36,16 +74,32 @@
 #define MUX_SELECT_A_PIN  (GPIO_PIN_7)
 #define MUX_SELECT_B_PORT (GPIOD)
 #define MUX_SELECT_B_PIN  (GPIO_PIN_14)
+#endif
 
 static OS_MUTEX SensorMutex;
 
+/* The TE driver's defaults */
+static Sensor_Resolution SensorResolution = {Sensor_OSR_8192, Sensor_RH_12Bit};
+
+static MS8607_Prom SensorProm;
+
+/* Oldest temperature ADC word a humidity-only read may be compensated with */
+#define SENSOR_D2_MAX_AGE_NS (1000000000ULL)
+
+/* Last temperature ADC word, reused to compensate humidity-only reads */
+static uint32_t SensorLastD2;
+static uint64_t SensorLastD2Ns;
+static bool     SensorLastD2IsValid;
+
 static void SelectSensor(Sensor_TypeDef sensor)
 {
     switch (sensor)
     {
     case Sensor_MS8607:
+#if !defined(BSP_HOSTED)
         HAL_GPIO_WritePin(MUX_SELECT_A_PORT, MUX_SELECT_A_PIN, GPIO_PIN_SET);
         HAL_GPIO_WritePin(MUX_SELECT_B_PORT, MUX_SELECT_B_PIN, GPIO_PIN_RESET);
+#endif
         break;
 
     /* Bad input */
@@ -54,6 +108,157 @@ static void SelectSensor(Sensor_TypeDef sensor)
     }
 }
 
+static enum ms8607_pressure_resolution MS8607Osr(Sensor_OSRTypeDef osr)
+{
+    switch (osr)
+    {
+    case Sensor_OSR_256:
+        return ms8607_pressure_resolution_osr_256;
+
+    case Sensor_OSR_512:
+        return ms8607_pressure_resolution_osr_512;
+
+    case Sensor_OSR_1024:
+        return ms8607_pressure_resolution_osr_1024;
+
+    case Sensor_OSR_2048:
+        return ms8607_pressure_resolution_osr_2048;
+
+    case Sensor_OSR_4096:
+        return ms8607_pressure_resolution_osr_4096;
+
+    /* OSR 8192, or bad input */
+    default:
+        return ms8607_pressure_resolution_osr_8192;
+    }
+}
+
+static enum ms8607_humidity_resolution MS8607RHResolution(Sensor_RHResolutionTypeDef rh_resolution)
+{
+    switch (rh_resolution)
+    {
+    case Sensor_RH_8Bit:
+        return ms8607_humidity_resolution_8b;
+
+    case Sensor_RH_10Bit:
+        return ms8607_humidity_resolution_10b;
+
+    case Sensor_RH_11Bit:
+        return ms8607_humidity_resolution_11b;
+
+    /* 12-bit, or bad input */
+    default:
+        return ms8607_humidity_resolution_12b;
+    }
+}
+
+static BSP_RESULT BusBaudRate(Sensor_BusSpeedTypeDef speed, enum i2c_master_baud_rate* p_baud_rate)
+{
+    switch (speed)
+    {
+    case Sensor_BusSpeed_100kHz:
+        *p_baud_rate = I2C_MASTER_BAUD_RATE_100KHZ;
+        return BSP_SUCCESS;
+
+    case Sensor_BusSpeed_400kHz:
+        *p_baud_rate = I2C_MASTER_BAUD_RATE_400KHZ;
+        return BSP_SUCCESS;
+
+    case Sensor_BusSpeed_1MHz:
+        *p_baud_rate = I2C_MASTER_BAUD_RATE_1000KHZ;
+        return BSP_SUCCESS;
+
+    /* Bad input */
+    default:
+        return BSP_FAILURE;
+    }
+}
+
+/* Call with the sensor mutex held */
+static BSP_RESULT ApplyResolution(Sensor_TypeDef sensor)
+{
+    switch (sensor)
+    {
+    case Sensor_MS8607:
+        /* Pressure sensor OSR is only a driver setting, humidity is written to the sensor */
+        ms8607_set_pressure_resolution(MS8607Osr(SensorResolution.osr));
+
+        if (ms8607_set_humidity_resolution(MS8607RHResolution(SensorResolution.rh_resolution)) != STATUS_OK)
+        {
+            return BSP_FAILURE;
+        }
+
+        return BSP_SUCCESS;
+
+    /* Bad input */
+    default:
+        return BSP_FAILURE;
+    }
+}
+
+/* Call with the sensor mutex held, only the requested channels are meaningful in the results */
+static BSP_RESULT MS8607ReadChannels(uint8_t channels, float* p_temp, float* p_humid, float* p_press)
+{
+    uint8_t conversions;
+    uint64_t now_ns;
+    MS8607_Raw raw;
+#if (OS_CFG_SENSOR_FIXED_POINT_EN > 0u)
+    MS8607_Result comp;
+#endif
+
+    conversions = 0;
+    now_ns      = BSP_Timebase_GetNs();
+
+    if ((channels & (SENSOR_CHANNEL_TEMPERATURE | SENSOR_CHANNEL_PRESSURE)) != 0U)
+    {
+        conversions |= MS8607_RAW_D2;
+    }
+
+    if ((channels & SENSOR_CHANNEL_PRESSURE) != 0U)
+    {
+        conversions |= MS8607_RAW_D1;
+    }
+
+    if ((channels & SENSOR_CHANNEL_HUMIDITY) != 0U)
+    {
+        conversions |= MS8607_RAW_D3;
+
+        if ((SensorLastD2IsValid == false) || ((now_ns - SensorLastD2Ns) > SENSOR_D2_MAX_AGE_NS))
+        {
+            conversions |= MS8607_RAW_D2;
+        }
+    }
+
+    raw.d1 = 0;
+    raw.d2 = SensorLastD2;
+    raw.d3 = 0;
+
+    if (ms8607_raw_read_channels(MS8607Osr(SensorResolution.osr), MS8607RHResolution(SensorResolution.rh_resolution),
+                                 conversions, &raw) != STATUS_OK)
+    {
+        return BSP_FAILURE;
+    }
+
+    if ((conversions & MS8607_RAW_D2) != 0U)
+    {
+        SensorLastD2        = raw.d2;
+        SensorLastD2Ns      = now_ns;
+        SensorLastD2IsValid = true;
+    }
+
+#if (OS_CFG_SENSOR_FIXED_POINT_EN > 0u)
+    ms8607_comp_fixed(&SensorProm, &raw, &comp);
+
+    *p_temp  = (float) comp.temperature / 100.0f;
+    *p_humid = (float) comp.humidity / 100.0f;
+    *p_press = (float) comp.pressure / 100.0f;
+#else
+    ms8607_comp_float(&SensorProm, &raw, p_temp, p_press, p_humid);
+#endif
+
+    return BSP_SUCCESS;
+}
+
 static BSP_RESULT SensorPrologue(Sensor_TypeDef sensor)
 {
     OS_ERR err;
@@ -94,6 +299,7 @@ static BSP_RESULT SensorEpilogue(Sensor_TypeDef sensor)
 BSP_RESULT BSP_Sensor_Init(void)
 {
     OS_ERR err;
+#if !defined(BSP_HOSTED)
     GPIO_InitTypeDef GPIO_InitStruct;
 
     /* Enable Weather Sheild GPIO clocks */
@@ -116,6 +322,7 @@ BSP_RESULT BSP_Sensor_Init(void)
 
     /* Enable mux */
     HAL_GPIO_WritePin(MUX_ENABLE_PORT, MUX_ENABLE_PIN, GPIO_PIN_RESET);
+#endif
 
     /* Create Sensor mutex, allowing multiple tasks to use BSP Sensor APIs safely */
     OSMutexCreate((OS_MUTEX*) &SensorMutex,
@@ -170,9 +377,19 @@ BSP_RESULT BSP_Sensor_Reset(Sensor_TypeDef sensor)
         {
             result = BSP_FAILURE;
         }
+        /* Reset restores the humidity resolution to 12-bit */
+        else if (ApplyResolution(sensor) != BSP_SUCCESS)
+        {
+            result = BSP_FAILURE;
+        }
+        else if (ms8607_raw_read_prom(&SensorProm) != STATUS_OK)
+        {
+            result = BSP_FAILURE;
+        }
         else
         {
-            result = BSP_SUCCESS;
+            SensorLastD2IsValid = false;
+            result              = BSP_SUCCESS;
         }
 
         break;
@@ -192,11 +409,16 @@ BSP_RESULT BSP_Sensor_Reset(Sensor_TypeDef sensor)
 }
 
 BSP_RESULT BSP_Sensor_Read(Sensor_TypeDef sensor, Sensor_Data* data)
+{
+    return BSP_Sensor_ReadChannels(sensor, SENSOR_CHANNEL_ALL, data);
+}
+
+BSP_RESULT BSP_Sensor_ReadChannels(Sensor_TypeDef sensor, uint8_t channels, Sensor_Data* data)
 {
     BSP_RESULT result;
     float temp, humid, press;
 
-    if (data == NULL)
+    if ((data == NULL) || (channels == 0U) || ((channels & ~SENSOR_CHANNEL_ALL) != 0U))
     {
         return BSP_FAILURE;
     }
@@ -206,25 +428,43 @@ BSP_RESULT BSP_Sensor_Read(Sensor_TypeDef sensor, Sensor_Data* data)
         return BSP_FAILURE;
     }
 
+    /* Timestamp after acquiring the mutex so time spent waiting for other users is excluded */
+    data->timestamp_ns = BSP_Timebase_GetNs();
+
     switch (sensor)
     {
     case Sensor_MS8607:
-        if (ms8607_read_temperature_pressure_humidity(&temp, &press, &humid) != STATUS_OK)
+#if (OS_CFG_SENSOR_FIXED_POINT_EN == 0u)
+        /* The TE driver can only read all channels at once */
+        if (channels == SENSOR_CHANNEL_ALL)
         {
-            result = BSP_FAILURE;
-            break;
+            result = BSP_SUCCESS;
+
+            if (ms8607_read_temperature_pressure_humidity(&temp, &press, &humid) != STATUS_OK)
+            {
+                result = BSP_FAILURE;
+            }
+
+            /* The driver does not return its D2, the cached one is now older than this reading */
+            SensorLastD2IsValid = false;
         }
         else
+#endif
         {
-            result = BSP_SUCCESS;
+            result = MS8607ReadChannels(channels, &temp, &humid, &press);
+        }
+
+        if (result != BSP_SUCCESS)
+        {
+            break;
         }
 
         data->temperature          = temp;
-        data->temperature_is_valid = true;
+        data->temperature_is_valid = ((channels & SENSOR_CHANNEL_TEMPERATURE) != 0U);
         data->humidity             = humid;
-        data->humidity_is_valid    = true;
+        data->humidity_is_valid    = ((channels & SENSOR_CHANNEL_HUMIDITY) != 0U);
         data->pressure             = press;
-        data->pressure_is_valid    = true;
+        data->pressure_is_valid    = ((channels & SENSOR_CHANNEL_PRESSURE) != 0U);
 
         break;
 
@@ -241,3 +481,141 @@ BSP_RESULT BSP_Sensor_Read(Sensor_TypeDef sensor, Sensor_Data* data)
 
     return result;
 }
+
+BSP_RESULT BSP_Sensor_SetResolution(Sensor_TypeDef sensor, const Sensor_Resolution* resolution)
+{
+    BSP_RESULT result;
+    Sensor_Resolution previous;
+
+    if (resolution == NULL)
+    {
+        return BSP_FAILURE;
+    }
+
+    if (SensorPrologue(sensor) != BSP_SUCCESS)
+    {
+        return BSP_FAILURE;
+    }
+
+    previous         = SensorResolution;
+    SensorResolution = *resolution;
+    result           = ApplyResolution(sensor);
+
+    if (result != BSP_SUCCESS)
+    {
+        SensorResolution = previous;
+    }
+
+    if (SensorEpilogue(sensor) != BSP_SUCCESS)
+    {
+        return BSP_FAILURE;
+    }
+
+    return result;
+}
+
+BSP_RESULT BSP_Sensor_GetLatency(Sensor_TypeDef sensor, uint32_t* latency_us)
+{
+    BSP_RESULT result;
+    uint32_t pt_us;
+    uint32_t rh_us;
+
+    if (latency_us == NULL)
+    {
+        return BSP_FAILURE;
+    }
+
+    if (SensorPrologue(sensor) != BSP_SUCCESS)
+    {
+        return BSP_FAILURE;
+    }
+
+    switch (sensor)
+    {
+    case Sensor_MS8607:
+        /* One temperature and one pressure conversion per read */
+        pt_us = 2U * ms8607_raw_pt_conversion_us(MS8607Osr(SensorResolution.osr));
+        rh_us = ms8607_raw_rh_conversion_us(MS8607RHResolution(SensorResolution.rh_resolution));
+
+#if (OS_CFG_SENSOR_FIXED_POINT_EN > 0u)
+        /* ms8607_raw.c overlaps the humidity conversion with the other two */
+        *latency_us = (rh_us > pt_us) ? rh_us : pt_us;
+#else
+        *latency_us = pt_us + rh_us;
+#endif
+        result = BSP_SUCCESS;
+        break;
+
+    /* Bad input */
+    default:
+        result = BSP_FAILURE;
+        break;
+    }
+
+    if (SensorEpilogue(sensor) != BSP_SUCCESS)
+    {
+        return BSP_FAILURE;
+    }
+
+    return result;
+}
+
+BSP_RESULT BSP_Sensor_SetBusSpeed(Sensor_TypeDef sensor, Sensor_BusSpeedTypeDef speed)
+{
+    BSP_RESULT result;
+    enum i2c_master_baud_rate baud_rate;
+
+    if (BusBaudRate(speed, &baud_rate) != BSP_SUCCESS)
+    {
+        return BSP_FAILURE;
+    }
+
+    if (SensorPrologue(sensor) != BSP_SUCCESS)
+    {
+        return BSP_FAILURE;
+    }
+
+    switch (sensor)
+    {
+    case Sensor_MS8607:
+        result = BSP_SUCCESS;
+
+        if (ms8607_raw_set_baud_rate(baud_rate) != STATUS_OK)
+        {
+            result = BSP_FAILURE;
+        }
+
+        break;
+
+    /* Bad input */
+    default:
+        result = BSP_FAILURE;
+        break;
+    }
+
+    if (SensorEpilogue(sensor) != BSP_SUCCESS)
+    {
+        return BSP_FAILURE;
+    }
+
+    return result;
+}
+
+BSP_RESULT BSP_Sensor_GetBusStats(Sensor_BusStats* stats)
+{
+    if (stats == NULL)
+    {
+        return BSP_FAILURE;
+    }
+
+    i2c_master_get_stats(stats);
+
+    return BSP_SUCCESS;
+}
+
+BSP_RESULT BSP_Sensor_ResetBusStats(void)
+{
+    i2c_master_reset_stats();
+
+    return BSP_SUCCESS;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file   bsp_timebase.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  64-bit monotonic high-resolution timebase.
+ *
+ *         `OSTimeGet` only has tick resolution (1 ms) and wraps after ~49 days. This
+ *         driver combines a 64-bit copy of the tick count with the DWT cycle counter
+ *         (started by `CPU_TS_TmrInit` in cpu_bsp.c) to produce a nanosecond clock:
+ *
+ *             ns = ticks * NS_PER_TICK + cycles_since_tick * ns_per_cycle
+ *
+ *         The tick hook calls `BSP_Timebase_Tick` to latch the tick count and the cycle
+ *         counter at the start of every tick. Reading the clock is a short critical section,
+ *         a 32-bit subtraction, and a multiply/shift to convert cycles to nanoseconds, so it
+ *         is cheap enough to call on every log message and sensor sample.
+ *
+ *         The sub-tick part is clamped to less than one tick period. If the tick interrupt is
+ *         delayed, the clock briefly stalls at the end of the period instead of running ahead
+ *         of the next tick, which keeps it monotonic and anchored to the kernel tick.
+ */
+
+#include "bsp.h"
+
+#include <os.h>
+#include <stm32f7xx.h>
+
+#include <stdint.h>
+
+#define NS_PER_SEC       (1000000000ULL)
+#define NS_PER_TICK      (NS_PER_SEC / OS_CFG_TICK_RATE_HZ)
+
+/* Fixed-point cycles to nanoseconds conversion, ns = (cycles * TimebaseMult) >> TIMEBASE_SHIFT */
+#define TIMEBASE_SHIFT   (24U)
+
+static volatile uint64_t TimebaseTicks;
+static volatile uint32_t TimebaseTickCycles;
+static uint64_t          TimebaseMult;
+
+/* Call after `CPU_Init`, once the DWT cycle counter is running at the final CPU clock */
+void BSP_Timebase_Init(void)
+{
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+
+    TimebaseMult       = (NS_PER_SEC << TIMEBASE_SHIFT) / BSP_CPU_ClkFreq();
+    TimebaseTicks      = 0;
+    TimebaseTickCycles = DWT->CYCCNT;
+
+    CPU_CRITICAL_EXIT();
+}
+
+/* Called from the tick ISR (`App_OS_TimeTickHook`) */
+void BSP_Timebase_Tick(void)
+{
+    TimebaseTicks++;
+    TimebaseTickCycles = DWT->CYCCNT;
+}
+
+/* Called from the idle task hook (`App_OS_IdleTaskHook`), time only passes by the tick here */
+void BSP_Timebase_Idle(void)
+{
+}
+
+uint64_t BSP_Timebase_GetNs(void)
+{
+    uint64_t ticks;
+    uint32_t cycles;
+    uint64_t sub_tick_ns;
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    ticks  = TimebaseTicks;
+    cycles = DWT->CYCCNT - TimebaseTickCycles;
+    CPU_CRITICAL_EXIT();
+
+    sub_tick_ns = ((uint64_t) cycles * TimebaseMult) >> TIMEBASE_SHIFT;
+
+    if (sub_tick_ns >= NS_PER_TICK)
+    {
+        sub_tick_ns = NS_PER_TICK - 1U;
+    }
+
+    return (ticks * NS_PER_TICK) + sub_tick_ns;
+}
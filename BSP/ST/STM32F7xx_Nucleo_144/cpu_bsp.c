@@ -0,0 +1,80 @@
+/**
+ * @file   cpu_bsp.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  uC-CPU timestamp timer.
+ *
+ *         uC-CPU (and uCOS-III when OS_CFG_TS_EN is enabled) expects the BSP to
+ *         provide a free-running timestamp timer. On Cortex-M7 the DWT cycle counter
+ *         is the natural choice: it runs at the CPU clock (216 MHz), costs a single
+ *         load to read, and wraps every ~19.9 seconds which is plenty for measuring
+ *         latencies within the application.
+ *
+ *         `CPU_TS_TmrInit` is called by `CPU_Init`, which must happen after the clock
+ *         tree is configured in `BSP_Init` so the reported timer frequency is correct.
+ *
+ *         References:
+ *             - uCOS-III The Real-Time Kernel (STM32 version, 2009): Pages 54, 753
+ */
+
+#include "bsp.h"
+
+#include <cpu.h>
+#include <cpu_core.h>
+#include <stm32f7xx.h>
+
+/* Software lock access key, the Cortex-M7 DWT ignores writes until this is written to LAR */
+#define DWT_LAR_KEY (0xC5ACCE55U)
+
+#if (CPU_CFG_TS_TMR_EN == DEF_ENABLED)
+void CPU_TS_TmrInit(void)
+{
+    /* Enable trace and debug blocks, required for DWT access */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+
+    /* Unlock, reset, and start the cycle counter */
+    DWT->LAR     = DWT_LAR_KEY;
+    DWT->CYCCNT  = 0U;
+    DWT->CTRL   |= DWT_CTRL_CYCCNTENA_Msk;
+
+    CPU_TS_TmrFreqSet((CPU_TS_TMR_FREQ) BSP_CPU_ClkFreq());
+}
+
+CPU_TS_TMR CPU_TS_TmrRd(void)
+{
+    return (CPU_TS_TMR) DWT->CYCCNT;
+}
+#endif
+
+#if (CPU_CFG_TS_32_EN == DEF_ENABLED)
+CPU_INT64U CPU_TS32_to_uSec(CPU_TS32 ts_cnts)
+{
+    CPU_ERR err;
+    CPU_TS_TMR_FREQ freq;
+
+    freq = CPU_TS_TmrFreqGet(&err);
+
+    if ((err != CPU_ERR_NONE) || (freq == 0U))
+    {
+        return 0U;
+    }
+
+    return ((CPU_INT64U) ts_cnts * 1000000U) / freq;
+}
+#endif
+
+#if (CPU_CFG_TS_64_EN == DEF_ENABLED)
+CPU_INT64U CPU_TS64_to_uSec(CPU_TS64 ts_cnts)
+{
+    CPU_ERR err;
+    CPU_TS_TMR_FREQ freq;
+
+    freq = CPU_TS_TmrFreqGet(&err);
+
+    if ((err != CPU_ERR_NONE) || (freq == 0U))
+    {
+        return 0U;
+    }
+
+    return (ts_cnts / freq) * 1000000U + ((ts_cnts % freq) * 1000000U) / freq;
+}
+#endif
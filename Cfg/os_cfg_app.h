@@ -104,6 +104,18 @@
 #define  OS_CFG_APP_TASK_STK_SIZE                        512u
                                                                 /* Polling interval (in number of OS_TICK elements)     */
 #define  OS_CFG_APP_TASK_POLLING_INTERVAL               1000u
+                                                                /* Log CRC cycles/byte for each mode at startup         */
+#define  OS_CFG_APP_TASK_CRC_BENCH_EN                      0u
+                                                                /* Log MS8607 compensation cycles at startup            */
+#define  OS_CFG_APP_TASK_COMP_BENCH_EN                     0u
+                                                                /* Log filter cycles/reading and checksums at startup   */
+#define  OS_CFG_APP_TASK_FILTER_BENCH_EN                   0u
+                                                                /* Log read time and noise per resolution at startup    */
+#define  OS_CFG_APP_TASK_OSR_BENCH_EN                      0u
+                                                                /* Log MS8607 bus time per read for each SCL speed      */
+#define  OS_CFG_APP_TASK_I2C_BENCH_EN                      0u
+                                                                /* Log alarm latency p50/max, needs OS_CFG_ALARM_EN     */
+#define  OS_CFG_APP_TASK_ALARM_BENCH_EN                    0u
 
                                                                 /* -------------------- LOGGER TASK ------------------- */
                                                                 /* Priority of 'Logger Task'                            */
@@ -112,6 +124,42 @@
 #define  OS_CFG_LOGGER_TASK_STK_SIZE                     512u
                                                                 /* Task message queue size for 'Logger Task'            */
 #define  OS_CFG_LOGGER_TASK_QUEUE_SIZE                    20u
+                                                                /* Raise 'Logger Task' priority under backlog (1)       */
+#define  OS_CFG_LOGGER_TASK_BOOST_EN                       0u
+                                                                /* Priority of 'Logger Task' while boosted              */
+#define  OS_CFG_LOGGER_TASK_BOOST_PRIO           ((OS_PRIO) 0)
+                                                                /* Queue depth at which the boost is applied            */
+#define  OS_CFG_LOGGER_TASK_BOOST_HIGH_WATERMARK          12u
+                                                                /* Queue depth at which the boost is removed            */
+#define  OS_CFG_LOGGER_TASK_BOOST_LOW_WATERMARK            4u
+                                                                /* Records per CRC-32 checkpoint line (0 disables)      */
+#define  OS_CFG_LOGGER_TASK_CRC_BATCH_SIZE                 0u
+
+                                                                /* ---------------- KERNEL BENCH TASK ----------------- */
+                                                                /* Priority of 'Kernel Bench Task' (kbench.elf only)    */
+#define  OS_CFG_KBENCH_TASK_PRIO                 ((OS_PRIO) 4)
+                                                                /* Priority of its helper, must be higher than the task */
+#define  OS_CFG_KBENCH_HELPER_PRIO               ((OS_PRIO) 3)
+                                                                /* Stack size (number of CPU_STK elements)              */
+#define  OS_CFG_KBENCH_TASK_STK_SIZE                     512u
+                                                                /* Helper stack size (number of CPU_STK elements)       */
+#define  OS_CFG_KBENCH_HELPER_STK_SIZE                   256u
+                                                                /* Timed iterations per primitive                       */
+#define  OS_CFG_KBENCH_SAMPLES                           256u
+
+                                                                /* ---------------- LOGGER BENCH TASKS ---------------- */
+                                                                /* Priority of the producers (lbench.elf only)          */
+#define  OS_CFG_LBENCH_PRODUCER_PRIO             ((OS_PRIO) 3)
+                                                                /* Producer stack size (number of CPU_STK elements)     */
+#define  OS_CFG_LBENCH_PRODUCER_STK_SIZE                 256u
+                                                                /* Messages/s of each producer, one entry per producer  */
+#define  OS_CFG_LBENCH_RATES                 { 50u, 20u, 10u, 5u }
+                                                                /* Payload chars of each producer (max 80)              */
+#define  OS_CFG_LBENCH_SIZES                 { 16u, 32u, 64u, 80u }
+                                                                /* Measurement window (seconds)                         */
+#define  OS_CFG_LBENCH_DURATION                           10u
+                                                                /* Latencies kept for the percentiles                   */
+#define  OS_CFG_LBENCH_LATENCY_SAMPLES                  1024u
 
                                                                 /* -------------------- SENSOR TASK ------------------- */
                                                                 /* Priority of 'Sensor Task'                            */
@@ -120,5 +168,103 @@
 #define  OS_CFG_SENSOR_TASK_STK_SIZE                     512u
                                                                 /* Polling interval (in number of OS_TICK elements)     */
 #define  OS_CFG_SENSOR_TASK_POLLING_INTERVAL            1000u
+                                                                /* Release on absolute ticks (1) or delay after (0)     */
+#define  OS_CFG_SENSOR_TASK_PERIODIC_EN                    1u
+                                                                /* Store each reading in the time-series store          */
+#define  OS_CFG_SENSOR_TASK_TIMESERIES_EN                  1u
+                                                                /* Report binary telemetry frames (1) or text (0)       */
+#define  OS_CFG_SENSOR_TASK_TELEMETRY_EN                   0u
+                                                                /* MS8607 conversion in fixed point (1) or driver (0)   */
+#define  OS_CFG_SENSOR_FIXED_POINT_EN                      0u
+                                                                /* Pressure/temperature OSR (0 = 256 ... 5 = 8192)      */
+#define  OS_CFG_SENSOR_TASK_OSR                            5u
+                                                                /* Humidity resolution (0 = 8 ... 3 = 12 bit)           */
+#define  OS_CFG_SENSOR_TASK_RH_RESOLUTION                  3u
+                                                                /* I2C SCL (0 = 100 kHz, 1 = 400 kHz, 2 = 1 MHz)        */
+#define  OS_CFG_SENSOR_TASK_BUS_SPEED                      0u
+                                                                /* Read temperature every N polling intervals           */
+#define  OS_CFG_SENSOR_TASK_TEMPERATURE_DIVIDER            1u
+                                                                /* Read humidity every N polling intervals              */
+#define  OS_CFG_SENSOR_TASK_HUMIDITY_DIVIDER               1u
+                                                                /* Read pressure every N polling intervals              */
+#define  OS_CFG_SENSOR_TASK_PRESSURE_DIVIDER               1u
+                                                                /* Filter (0 none, 1 average, 2 low-pass, 3 median)     */
+#define  OS_CFG_SENSOR_TASK_FILTER                         0u
+                                                                /* Moving average and median window (samples, max 16)   */
+#define  OS_CFG_SENSOR_TASK_FILTER_WINDOW                  5u
+                                                                /* Low-pass coefficient (Q15, 8192 = 0.25)              */
+#define  OS_CFG_SENSOR_TASK_FILTER_ALPHA                8192u
+                                                                /* Use Cortex-M7 DSP instructions in filter kernels     */
+#define  OS_CFG_FILTER_SIMD_EN                             1u
+                                                                /* Readings per summary report (0 reports every one)    */
+#define  OS_CFG_SENSOR_TASK_AGGREGATE_WINDOW                0u
+                                                                /* Only report channels that changed (1) or all (0)     */
+#define  OS_CFG_SENSOR_TASK_DEADBAND_EN                    0u
+                                                                /* Temperature deadband (0.01 degC)                     */
+#define  OS_CFG_SENSOR_TASK_DEADBAND_TEMPERATURE          10u
+                                                                /* Humidity deadband (0.01 %RH)                         */
+#define  OS_CFG_SENSOR_TASK_DEADBAND_HUMIDITY             50u
+                                                                /* Pressure deadband (0.01 mbar)                        */
+#define  OS_CFG_SENSOR_TASK_DEADBAND_PRESSURE             10u
+                                                                /* Report unchanged channels after (OS_TICK, 0 never)   */
+#define  OS_CFG_SENSOR_TASK_DEADBAND_MAX_AGE           60000u
+                                                                /* Adapt the polling interval to the rate of change     */
+#define  OS_CFG_SENSOR_TASK_ADAPTIVE_EN                    0u
+                                                                /* Shortest adaptive polling interval (OS_TICK)         */
+#define  OS_CFG_SENSOR_TASK_POLLING_INTERVAL_MIN         250u
+                                                                /* Longest adaptive polling interval (OS_TICK)          */
+#define  OS_CFG_SENSOR_TASK_POLLING_INTERVAL_MAX       10000u
+                                                                /* Consecutive failed reads before the task gives up    */
+#define  OS_CFG_SENSOR_TASK_MAX_READ_FAILURES              5u
+
+                                                                /* --------------------- I2C BUS ---------------------- */
+                                                                /* Retries of a transfer after a bus error or timeout   */
+#define  OS_CFG_I2C_RETRIES                                3u
+                                                                /* First retry delay (ms), doubles for each retry       */
+#define  OS_CFG_I2C_RETRY_BACKOFF                          1u
+                                                                /* Write-then-read as one transaction (repeated START)  */
+#define  OS_CFG_I2C_REPEATED_START_EN                      1u
+
+                                                                /* ---------------------- ALARMS ---------------------- */
+                                                                /* Evaluate threshold alarms on every reading           */
+#define  OS_CFG_ALARM_EN                                   0u
+                                                                /* LED on while any alarm is active (LED_TypeDef)       */
+#define  OS_CFG_ALARM_LED                            LED_BLUE
+                                                                /* Temperature low limit (0.01 degC, signed)            */
+#define  OS_CFG_ALARM_TEMPERATURE_LOW                       0
+                                                                /* Temperature high limit (0.01 degC, signed)           */
+#define  OS_CFG_ALARM_TEMPERATURE_HIGH                   3500
+                                                                /* Temperature hysteresis (0.01 degC)                   */
+#define  OS_CFG_ALARM_TEMPERATURE_HYSTERESIS              50u
+                                                                /* Humidity low limit (0.01 %RH)                        */
+#define  OS_CFG_ALARM_HUMIDITY_LOW                       2000
+                                                                /* Humidity high limit (0.01 %RH)                       */
+#define  OS_CFG_ALARM_HUMIDITY_HIGH                      8000
+                                                                /* Humidity hysteresis (0.01 %RH)                       */
+#define  OS_CFG_ALARM_HUMIDITY_HYSTERESIS                200u
+                                                                /* Pressure low limit (0.01 mbar)                       */
+#define  OS_CFG_ALARM_PRESSURE_LOW                      95000
+                                                                /* Pressure high limit (0.01 mbar)                      */
+#define  OS_CFG_ALARM_PRESSURE_HIGH                    105000
+                                                                /* Pressure hysteresis (0.01 mbar)                      */
+#define  OS_CFG_ALARM_PRESSURE_HYSTERESIS                100u
+
+                                                                /* --------------------- PROFILER --------------------- */
+                                                                /* Sample the PC and task from a timer interrupt        */
+#define  OS_CFG_PROFILER_EN                                0u
+                                                                /* Samples/s, not a multiple of OS_CFG_TICK_RATE_HZ     */
+#define  OS_CFG_PROFILER_RATE_HZ                        1999u
+                                                                /* Distinct (PC, task) pairs per profile (power of 2)   */
+#define  OS_CFG_PROFILER_SLOTS                          1024u
+                                                                /* Profile length before it is logged (OS_TICK)         */
+#define  OS_CFG_PROFILER_PERIOD                        60000u
+
+                                                                /* ----------------- TIME-SERIES STORE ---------------- */
+                                                                /* Most recent raw samples kept                         */
+#define  OS_CFG_TIMESERIES_RAW_SIZE                       256u
+                                                                /* 1-minute summaries kept                              */
+#define  OS_CFG_TIMESERIES_MINUTE_SIZE                    180u
+                                                                /* 1-hour summaries kept                                */
+#define  OS_CFG_TIMESERIES_HOUR_SIZE                       72u
 
 #endif
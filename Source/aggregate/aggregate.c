@@ -0,0 +1,113 @@
+/**
+ * @file   aggregate.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Windowed Sensor Statistics.
+ *
+ *         Summarizes a window of sensor readings per channel as count, mean, variance,
+ *         min, and max, so a task can sample quickly but only report one summary per
+ *         window. Each sample updates the window in O(1) without storing it.
+ *
+ *         The variance uses Welford's online algorithm. The textbook sum and sum of
+ *         squares method subtracts two large, nearly equal numbers at the end, which in
+ *         single precision loses all of the variance of a reading like 997.71 mbar that
+ *         only changes in the second decimal place. Welford only accumulates differences
+ *         from the running mean, which stay small.
+ *
+ *         References:
+ *             - Welford, "Note on a Method for Calculating Corrected Sums of Squares and
+ *               Products", Technometrics, 1962.
+ */
+
+#include "aggregate.h"
+
+#include <bsp.h>
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+static void stats_reset(Aggregate_Stats* p_stats)
+{
+    p_stats->count = 0;
+    p_stats->mean  = 0.0f;
+    p_stats->m2    = 0.0f;
+    p_stats->min   = 0.0f;
+    p_stats->max   = 0.0f;
+}
+
+static void stats_add(Aggregate_Stats* p_stats, float value)
+{
+    float delta;
+
+    p_stats->count++;
+
+    if (p_stats->count == 1U)
+    {
+        p_stats->mean = value;
+        p_stats->min  = value;
+        p_stats->max  = value;
+        return;
+    }
+
+    if (value < p_stats->min)
+    {
+        p_stats->min = value;
+    }
+
+    if (value > p_stats->max)
+    {
+        p_stats->max = value;
+    }
+
+    delta          = value - p_stats->mean;
+    p_stats->mean += delta / (float) p_stats->count;
+    p_stats->m2   += delta * (value - p_stats->mean);
+}
+
+void aggregate_reset(Aggregate_Window* p_window)
+{
+    p_window->start_ns    = 0;
+    p_window->end_ns      = 0;
+    p_window->num_samples = 0;
+
+    stats_reset(&p_window->temperature);
+    stats_reset(&p_window->humidity);
+    stats_reset(&p_window->pressure);
+}
+
+void aggregate_add(Aggregate_Window* p_window, const Sensor_Data* p_data)
+{
+    if (p_window->num_samples == 0U)
+    {
+        p_window->start_ns = p_data->timestamp_ns;
+    }
+
+    p_window->end_ns = p_data->timestamp_ns;
+    p_window->num_samples++;
+
+    if (p_data->temperature_is_valid == true)
+    {
+        stats_add(&p_window->temperature, p_data->temperature);
+    }
+
+    if (p_data->humidity_is_valid == true)
+    {
+        stats_add(&p_window->humidity, p_data->humidity);
+    }
+
+    if (p_data->pressure_is_valid == true)
+    {
+        stats_add(&p_window->pressure, p_data->pressure);
+    }
+}
+
+/* Sample variance (n - 1), 0 with fewer than two samples */
+float aggregate_variance(const Aggregate_Stats* p_stats)
+{
+    if (p_stats->count < 2U)
+    {
+        return 0.0f;
+    }
+
+    return p_stats->m2 / (float) (p_stats->count - 1U);
+}
@@ -0,0 +1,37 @@
+/**
+ * @file   aggregate.h
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Windowed Sensor Statistics.
+ */
+
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+#include <bsp.h>
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint32_t count; /* Valid samples in the window, other fields unset if 0 */
+    float    mean;
+    float    m2;    /* Sum of squared differences from the mean (Welford)  */
+    float    min;
+    float    max;
+} Aggregate_Stats;
+
+typedef struct
+{
+    uint64_t        start_ns;    /* Timestamp of the first sample */
+    uint64_t        end_ns;      /* Timestamp of the last sample  */
+    uint32_t        num_samples; /* Samples added, valid or not   */
+    Aggregate_Stats temperature;
+    Aggregate_Stats humidity;
+    Aggregate_Stats pressure;
+} Aggregate_Window;
+
+void  aggregate_reset   (Aggregate_Window* p_window);
+void  aggregate_add     (Aggregate_Window* p_window, const Sensor_Data* p_data);
+float aggregate_variance(const Aggregate_Stats* p_stats);
+
+#endif /* AGGREGATE_H */
@@ -0,0 +1,323 @@
+/**
+ * @file   alarm.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Threshold Alarms.
+ *
+ *         Each channel has a low and a high alarm. An alarm is raised when a reading
+ *         goes past its limit and cleared only once a reading is back inside the limit
+ *         by the hysteresis, so a value sitting on the limit does not toggle the alarm
+ *         on every read. Channels that are not valid in a reading keep their state.
+ *
+ *         `alarm_evaluate` runs in the sensor task right after the sensor read, before
+ *         the reading is stored, filtered, or reported. When an alarm changes state it
+ *         drives the outputs directly: the alarm's bit in the event flag group and
+ *         OS_CFG_ALARM_LED (on while any alarm is active). Nothing goes through the logger
+ *         queue, so the latency does not depend on how many log lines are waiting.
+ *
+ *         The flag bits are levels (set while active), so a task can wait for an alarm to
+ *         be raised or to clear with `alarm_wait`, and a task that starts waiting late
+ *         still sees an active alarm. Every state change records two latencies in the alarm
+ *         stats: from the end of the sensor read to the LED being driven, the part this code
+ *         controls, and from the start of the read (`Sensor_Data.timestamp_ns`) to the LED,
+ *         which adds the conversions and bus transfers and is what an alarm spec is about.
+ *         Posting the flags follows immediately, and a subscriber with a higher priority than
+ *         the sensor task runs as part of that post, after the stats are updated.
+ */
+
+#include "alarm.h"
+
+#include <os.h>
+#include <bsp.h>
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Configured limits are in 0.01 units, like the telemetry frame fields */
+#define ALARM_SCALE        (0.01f)
+#define ALARM_NUM_CHANNELS (3U)
+
+static OS_FLAG_GRP     AlarmFlags;
+static Alarm_Threshold AlarmThresholds[ALARM_NUM_CHANNELS];
+static OS_FLAGS        AlarmActive;
+static Alarm_Stats     AlarmStats;
+
+static void threshold_init(Alarm_ChannelTypeDef channel, int32_t low, int32_t high, uint32_t hysteresis)
+{
+    AlarmThresholds[channel].low        = (float) low * ALARM_SCALE;
+    AlarmThresholds[channel].high       = (float) high * ALARM_SCALE;
+    AlarmThresholds[channel].hysteresis = (float) hysteresis * ALARM_SCALE;
+}
+
+/* Saturates rather than wrapping, a read stuck in bus recovery can take seconds */
+static uint32_t alarm_latency(uint64_t now_ns, uint64_t since_ns)
+{
+    uint64_t latency_ns;
+
+    latency_ns = now_ns - since_ns;
+
+    return (latency_ns > UINT32_MAX) ? UINT32_MAX : (uint32_t) latency_ns;
+}
+
+static uint32_t count_alarms(OS_FLAGS alarms)
+{
+    uint32_t count;
+
+    for (count = 0; alarms != 0U; count++)
+    {
+        alarms &= alarms - 1U;
+    }
+
+    return count;
+}
+
+/* Returns the new state of the channel's two alarms */
+static OS_FLAGS channel_evaluate(const Alarm_Threshold* p_threshold, float value, OS_FLAGS active,
+                                 OS_FLAGS low_bit, OS_FLAGS high_bit)
+{
+    if ((active & low_bit) == 0U)
+    {
+        if (value < p_threshold->low)
+        {
+            active |= low_bit;
+        }
+    }
+    else if (value >= (p_threshold->low + p_threshold->hysteresis))
+    {
+        active &= ~low_bit;
+    }
+
+    if ((active & high_bit) == 0U)
+    {
+        if (value > p_threshold->high)
+        {
+            active |= high_bit;
+        }
+    }
+    else if (value <= (p_threshold->high - p_threshold->hysteresis))
+    {
+        active &= ~high_bit;
+    }
+
+    return active;
+}
+
+void alarm_init(OS_ERR* p_err)
+{
+    threshold_init(Alarm_Temperature,
+                   OS_CFG_ALARM_TEMPERATURE_LOW,
+                   OS_CFG_ALARM_TEMPERATURE_HIGH,
+                   OS_CFG_ALARM_TEMPERATURE_HYSTERESIS);
+    threshold_init(Alarm_Humidity,
+                   OS_CFG_ALARM_HUMIDITY_LOW,
+                   OS_CFG_ALARM_HUMIDITY_HIGH,
+                   OS_CFG_ALARM_HUMIDITY_HYSTERESIS);
+    threshold_init(Alarm_Pressure,
+                   OS_CFG_ALARM_PRESSURE_LOW,
+                   OS_CFG_ALARM_PRESSURE_HIGH,
+                   OS_CFG_ALARM_PRESSURE_HYSTERESIS);
+
+    AlarmActive = 0;
+
+    AlarmStats.num_raised             = 0;
+    AlarmStats.num_cleared            = 0;
+    AlarmStats.latency_last_ns        = 0;
+    AlarmStats.latency_max_ns         = 0;
+    AlarmStats.sample_latency_last_ns = 0;
+    AlarmStats.sample_latency_max_ns  = 0;
+
+    OSFlagCreate((OS_FLAG_GRP*) &AlarmFlags,
+                 (CPU_CHAR*)    "Alarm Flags",
+                 (OS_FLAGS)     0,
+                 (OS_ERR*)      p_err);
+}
+
+/* Takes effect on the next reading, active alarms stay active until the new limits clear them */
+void alarm_set_threshold(Alarm_ChannelTypeDef channel, const Alarm_Threshold* p_threshold, OS_ERR* p_err)
+{
+    CPU_SR_ALLOC();
+
+    if (((uint32_t) channel >= ALARM_NUM_CHANNELS) || (p_threshold == NULL))
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return;
+    }
+
+    CPU_CRITICAL_ENTER();
+    AlarmThresholds[channel] = *p_threshold;
+    CPU_CRITICAL_EXIT();
+
+    *p_err = OS_ERR_NONE;
+}
+
+/* Only call from the sensor task, `ready_ns` is when the read finished. Returns the alarms that changed state */
+OS_FLAGS alarm_evaluate(const Sensor_Data* p_data, uint64_t ready_ns, OS_ERR* p_err)
+{
+    Alarm_Threshold thresholds[ALARM_NUM_CHANNELS];
+    OS_FLAGS active;
+    OS_FLAGS raised;
+    OS_FLAGS cleared;
+    uint64_t now_ns;
+    uint32_t latency_ns;
+    uint32_t sample_latency_ns;
+    BSP_RESULT result;
+    CPU_SR_ALLOC();
+
+    if (p_data == NULL)
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return 0;
+    }
+
+    CPU_CRITICAL_ENTER();
+    thresholds[Alarm_Temperature] = AlarmThresholds[Alarm_Temperature];
+    thresholds[Alarm_Humidity]    = AlarmThresholds[Alarm_Humidity];
+    thresholds[Alarm_Pressure]    = AlarmThresholds[Alarm_Pressure];
+    CPU_CRITICAL_EXIT();
+
+    active = AlarmActive;
+
+    if (p_data->temperature_is_valid == true)
+    {
+        active = channel_evaluate(&thresholds[Alarm_Temperature], p_data->temperature, active,
+                                  ALARM_TEMPERATURE_LOW, ALARM_TEMPERATURE_HIGH);
+    }
+
+    if (p_data->humidity_is_valid == true)
+    {
+        active = channel_evaluate(&thresholds[Alarm_Humidity], p_data->humidity, active,
+                                  ALARM_HUMIDITY_LOW, ALARM_HUMIDITY_HIGH);
+    }
+
+    if (p_data->pressure_is_valid == true)
+    {
+        active = channel_evaluate(&thresholds[Alarm_Pressure], p_data->pressure, active,
+                                  ALARM_PRESSURE_LOW, ALARM_PRESSURE_HIGH);
+    }
+
+    raised  = active & ~AlarmActive;
+    cleared = AlarmActive & ~active;
+
+    *p_err = OS_ERR_NONE;
+
+    if ((raised | cleared) == 0U)
+    {
+        return 0;
+    }
+
+    result = BSP_SUCCESS;
+
+    /* The LED only changes when the first alarm is raised or the last one is cleared */
+    if ((AlarmActive == 0U) || (active == 0U))
+    {
+        result = (active != 0U) ? BSP_LED_On(OS_CFG_ALARM_LED) : BSP_LED_Off(OS_CFG_ALARM_LED);
+    }
+
+    AlarmActive = active;
+
+    /* Measured and recorded before posting, a higher priority subscriber runs inside OSFlagPost */
+    now_ns            = BSP_Timebase_GetNs();
+    latency_ns        = alarm_latency(now_ns, ready_ns);
+    sample_latency_ns = alarm_latency(now_ns, p_data->timestamp_ns);
+
+    CPU_CRITICAL_ENTER();
+
+    AlarmStats.num_raised             += count_alarms(raised);
+    AlarmStats.num_cleared            += count_alarms(cleared);
+    AlarmStats.latency_last_ns         = latency_ns;
+    AlarmStats.sample_latency_last_ns  = sample_latency_ns;
+
+    if (latency_ns > AlarmStats.latency_max_ns)
+    {
+        AlarmStats.latency_max_ns = latency_ns;
+    }
+
+    if (sample_latency_ns > AlarmStats.sample_latency_max_ns)
+    {
+        AlarmStats.sample_latency_max_ns = sample_latency_ns;
+    }
+
+    CPU_CRITICAL_EXIT();
+
+    if (raised != 0U)
+    {
+        (void) OSFlagPost((OS_FLAG_GRP*) &AlarmFlags,
+                          (OS_FLAGS)     raised,
+                          (OS_OPT)       OS_OPT_POST_FLAG_SET,
+                          (OS_ERR*)      p_err);
+    }
+
+    if ((cleared != 0U) && (*p_err == OS_ERR_NONE))
+    {
+        (void) OSFlagPost((OS_FLAG_GRP*) &AlarmFlags,
+                          (OS_FLAGS)     cleared,
+                          (OS_OPT)       OS_OPT_POST_FLAG_CLR,
+                          (OS_ERR*)      p_err);
+    }
+
+    /* The flags are still posted if the LED failed */
+    if ((result != BSP_SUCCESS) && (*p_err == OS_ERR_NONE))
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+    }
+
+    return raised | cleared;
+}
+
+OS_FLAGS alarm_get_active(void)
+{
+    return AlarmActive;
+}
+
+/* Wait until any of `alarms` is raised (or, with `raised` false, any of them is clear). Returns those alarms */
+OS_FLAGS alarm_wait(OS_FLAGS alarms, bool raised, OS_TICK timeout, OS_ERR* p_err)
+{
+    if ((alarms == 0U) || ((alarms & ~ALARM_ALL) != 0U))
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return 0;
+    }
+
+    return OSFlagPend((OS_FLAG_GRP*) &AlarmFlags,
+                      (OS_FLAGS)     alarms,
+                      (OS_TICK)      timeout,
+                      (OS_OPT)       ((raised == true) ? OS_OPT_PEND_FLAG_SET_ANY : OS_OPT_PEND_FLAG_CLR_ANY) |
+                                     OS_OPT_PEND_BLOCKING,
+                      (CPU_TS*)      NULL,
+                      (OS_ERR*)      p_err);
+}
+
+void alarm_get_stats(Alarm_Stats* p_stats, OS_ERR* p_err)
+{
+    CPU_SR_ALLOC();
+
+    if (p_stats == NULL)
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return;
+    }
+
+    CPU_CRITICAL_ENTER();
+    *p_stats = AlarmStats;
+    CPU_CRITICAL_EXIT();
+
+    *p_err = OS_ERR_NONE;
+}
+
+void alarm_reset_stats(OS_ERR* p_err)
+{
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+
+    AlarmStats.num_raised             = 0;
+    AlarmStats.num_cleared            = 0;
+    AlarmStats.latency_last_ns        = 0;
+    AlarmStats.latency_max_ns         = 0;
+    AlarmStats.sample_latency_last_ns = 0;
+    AlarmStats.sample_latency_max_ns  = 0;
+
+    CPU_CRITICAL_EXIT();
+
+    *p_err = OS_ERR_NONE;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file   alarm.h
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Threshold Alarms.
+ */
+
+#ifndef ALARM_H
+#define ALARM_H
+
+#include <os.h>
+#include <bsp.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Event flag bits, one per alarm, set while the alarm is active */
+#define ALARM_TEMPERATURE_LOW  ((OS_FLAGS) (1U << 0))
+#define ALARM_TEMPERATURE_HIGH ((OS_FLAGS) (1U << 1))
+#define ALARM_HUMIDITY_LOW     ((OS_FLAGS) (1U << 2))
+#define ALARM_HUMIDITY_HIGH    ((OS_FLAGS) (1U << 3))
+#define ALARM_PRESSURE_LOW     ((OS_FLAGS) (1U << 4))
+#define ALARM_PRESSURE_HIGH    ((OS_FLAGS) (1U << 5))
+#define ALARM_ALL              ((OS_FLAGS) 0x3FU)
+
+typedef enum
+{
+    Alarm_Temperature,
+    Alarm_Humidity,
+    Alarm_Pressure,
+} Alarm_ChannelTypeDef;
+
+typedef struct
+{
+    float low;        /* Raised below this value                          */
+    float high;       /* Raised above this value                          */
+    float hysteresis; /* Cleared once back inside the limits by this much */
+} Alarm_Threshold;
+
+typedef struct
+{
+    uint32_t num_raised;
+    uint32_t num_cleared;
+    uint32_t latency_last_ns;        /* End of the sensor read to the LED driven, last change */
+    uint32_t latency_max_ns;         /* Same, worst case                                     */
+    uint32_t sample_latency_last_ns; /* Start of the sensor read to the LED driven, last one */
+    uint32_t sample_latency_max_ns;  /* Same, worst case                                     */
+} Alarm_Stats;
+
+void     alarm_init         (OS_ERR* p_err);
+void     alarm_set_threshold(Alarm_ChannelTypeDef channel, const Alarm_Threshold* p_threshold, OS_ERR* p_err);
+OS_FLAGS alarm_evaluate     (const Sensor_Data* p_data, uint64_t ready_ns, OS_ERR* p_err);
+OS_FLAGS alarm_get_active   (void);
+OS_FLAGS alarm_wait         (OS_FLAGS alarms, bool raised, OS_TICK timeout, OS_ERR* p_err);
+void     alarm_get_stats    (Alarm_Stats* p_stats, OS_ERR* p_err);
+void     alarm_reset_stats  (OS_ERR* p_err);
+
+#endif /* ALARM_H */
@@ -5,12 +5,29 @@
  *
  *         The application task is responsible for creating other tasks
  *         in the system and maintaining an application heartbeat.
+ *
+ *         At startup it runs whatever benchmarks the build enables (Source/bench,
+ *         Source/kbench, Source/lbench) or the hosted sensor driver check. With
+ *         OS_CFG_PROFILER_EN it logs a profile every OS_CFG_PROFILER_PERIOD ticks.
  */
 
 #include "app_task.h"
 
+#include <bench.h>
 #include <logger_task.h>
 #include <sensor_task.h>
+#if defined(APP_KBENCH)
+#include <kbench.h>
+#endif
+#if defined(APP_LBENCH)
+#include <lbench.h>
+#endif
+#if defined(APP_SENSORCHECK)
+#include <sensor_check.h>
+#endif
+#if (OS_CFG_PROFILER_EN > 0u)
+#include <profiler.h>
+#endif
 
 #include <os.h>
 #include <bsp.h>
@@ -62,6 +79,9 @@ void app_task(void* p_arg)
 {
     OS_ERR err;
     BSP_RESULT result;
+#if (OS_CFG_PROFILER_EN > 0u)
+    OS_TICK profile_start;
+#endif
 
     result = BSP_Init();
     app_error_handler("BSP_Init failed:", (uint32_t) result, (uint32_t) BSP_SUCCESS);
@@ -73,10 +93,60 @@ void app_task(void* p_arg)
     logger_create(&err);
     app_error_handler("logger_create failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
 
+#if defined(APP_KBENCH)
+    kbench_run(&err);
+    app_error_handler("kbench_run failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+#endif
+
+#if defined(APP_LBENCH)
+    lbench_run(&AppTaskTCB, &err);
+    app_error_handler("lbench_run failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+#endif
+
+#if defined(APP_SENSORCHECK)
+    sensor_check_run();
+#endif
+
+#if (OS_CFG_APP_TASK_CRC_BENCH_EN > 0u)
+    bench_crc_run(&AppTaskTCB, &err);
+    app_error_handler("bench_crc_run failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+#endif
+
+#if (OS_CFG_APP_TASK_COMP_BENCH_EN > 0u)
+    bench_comp_run(&AppTaskTCB, &err);
+    app_error_handler("bench_comp_run failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+#endif
+
+#if (OS_CFG_APP_TASK_FILTER_BENCH_EN > 0u)
+    bench_filter_run(&AppTaskTCB, &err);
+    app_error_handler("bench_filter_run failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+#endif
+
+#if (OS_CFG_APP_TASK_OSR_BENCH_EN > 0u)
+    bench_osr_run(&AppTaskTCB, &err);
+    app_error_handler("bench_osr_run failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+#endif
+
+#if (OS_CFG_APP_TASK_I2C_BENCH_EN > 0u)
+    bench_i2c_run(&AppTaskTCB, &err);
+    app_error_handler("bench_i2c_run failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+#endif
+
     /* Create sensor task */
     sensor_create(&err);
     app_error_handler("sensor_create failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
 
+#if (OS_CFG_APP_TASK_ALARM_BENCH_EN > 0u)
+    bench_alarm_run(&AppTaskTCB, &err);
+    app_error_handler("bench_alarm_run failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+#endif
+
+#if (OS_CFG_PROFILER_EN > 0u)
+    profiler_start(&err);
+    app_error_handler("profiler_start failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+    profile_start = OSTimeGet(&err);
+#endif
+
     while (1)
     {
         result = BSP_LED_Toggle(LED_GREEN);
@@ -85,6 +155,21 @@ void app_task(void* p_arg)
         logger_log(&AppTaskTCB, &err, "App Task Heartbeat");
         app_error_handler("logger_log failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
 
+#if (OS_CFG_PROFILER_EN > 0u)
+        if ((OS_TICK) (OSTimeGet(&err) - profile_start) >= OS_CFG_PROFILER_PERIOD)
+        {
+            profiler_stop(&err);
+            app_error_handler("profiler_stop failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+
+            profiler_dump(&AppTaskTCB, &err);
+            app_error_handler("profiler_dump failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+
+            profiler_start(&err);
+            app_error_handler("profiler_start failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+            profile_start = OSTimeGet(&err);
+        }
+#endif
+
         OSTimeDly((OS_TICK) OS_CFG_APP_TASK_POLLING_INTERVAL,
                   (OS_OPT)  OS_OPT_TIME_DLY,
                   (OS_ERR*) &err);
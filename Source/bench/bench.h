@@ -0,0 +1,22 @@
+/**
+ * @file   bench.h
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Startup Benchmarks.
+ *
+ *         Each benchmark logs its results as `p_tcb` and is compiled out unless its
+ *         OS_CFG_APP_TASK_<NAME>_BENCH_EN option is set. Failures are returned in `p_err`.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <os.h>
+
+void bench_crc_run   (OS_TCB* p_tcb, OS_ERR* p_err);
+void bench_comp_run  (OS_TCB* p_tcb, OS_ERR* p_err);
+void bench_filter_run(OS_TCB* p_tcb, OS_ERR* p_err);
+void bench_osr_run   (OS_TCB* p_tcb, OS_ERR* p_err);
+void bench_i2c_run   (OS_TCB* p_tcb, OS_ERR* p_err);
+void bench_alarm_run (OS_TCB* p_tcb, OS_ERR* p_err);
+
+#endif /* BENCH_H */
@@ -0,0 +1,131 @@
+/**
+ * @file   bench_alarm.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Alarm Latency Benchmark.
+ *
+ *         Measures the alarm latency with OS_CFG_APP_TASK_ALARM_BENCH_EN set, once the sensor
+ *         task is running: it moves the temperature high limit across every reading to raise
+ *         and clear the alarm ALARM_BENCH_CHANGES times, logs the p50 and max of both alarm
+ *         latencies (alarm.c), then restores the configured limits.
+ *
+ *         The caller must be above the sensor task, so it wakes inside the flag post.
+ */
+
+#include "bench.h"
+
+#include <alarm.h>
+#include <logger_task.h>
+
+#include <os.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#if (OS_CFG_APP_TASK_ALARM_BENCH_EN > 0u)
+
+#if (OS_CFG_ALARM_EN == 0u)
+#error "OS_CFG_APP_TASK_ALARM_BENCH_EN needs OS_CFG_ALARM_EN"
+#endif
+
+/* Even, so the alarm ends up cleared */
+#define ALARM_BENCH_CHANGES  (64U)
+#define ALARM_BENCH_LIMIT    (1000.0f)
+#define ALARM_BENCH_TIMEOUT  (10U * OS_CFG_TICK_RATE_HZ)
+#define ALARM_BENCH_MSG_SIZE (96U)
+
+static uint32_t AlarmBenchSample[ALARM_BENCH_CHANGES];
+static uint32_t AlarmBenchRead[ALARM_BENCH_CHANGES];
+
+static int bench_alarm_compare(const void* p_a, const void* p_b)
+{
+    uint32_t a = *(const uint32_t*) p_a;
+    uint32_t b = *(const uint32_t*) p_b;
+
+    return (a > b) - (a < b);
+}
+
+static void bench_alarm_row(OS_TCB* p_tcb, const char* p_name, uint32_t* p_latencies, OS_ERR* p_err)
+{
+    char msg[ALARM_BENCH_MSG_SIZE];
+
+    qsort(p_latencies, ALARM_BENCH_CHANGES, sizeof(p_latencies[0]), bench_alarm_compare);
+
+    (void) snprintf(msg, sizeof(msg), "%s p50=%luns max=%luns (%u changes)", p_name,
+                    (unsigned long) p_latencies[(ALARM_BENCH_CHANGES - 1U) / 2U],
+                    (unsigned long) p_latencies[ALARM_BENCH_CHANGES - 1U], ALARM_BENCH_CHANGES);
+
+    logger_log(p_tcb, p_err, msg);
+}
+
+void bench_alarm_run(OS_TCB* p_tcb, OS_ERR* p_err)
+{
+    uint32_t i;
+    bool raise;
+    Alarm_Threshold threshold;
+    Alarm_Stats stats;
+
+    threshold.low        = -ALARM_BENCH_LIMIT;
+    threshold.hysteresis = 0.0f;
+
+    for (i = 0; i < ALARM_BENCH_CHANGES; i++)
+    {
+        /* Every reading is above a limit far below it and below a limit far above it */
+        raise          = ((i % 2U) == 0U);
+        threshold.high = raise ? -ALARM_BENCH_LIMIT : ALARM_BENCH_LIMIT;
+
+        alarm_set_threshold(Alarm_Temperature, &threshold, p_err);
+
+        if (*p_err != OS_ERR_NONE)
+        {
+            return;
+        }
+
+        (void) alarm_wait(ALARM_TEMPERATURE_HIGH, raise, ALARM_BENCH_TIMEOUT, p_err);
+
+        if (*p_err != OS_ERR_NONE)
+        {
+            return;
+        }
+
+        alarm_get_stats(&stats, p_err);
+
+        if (*p_err != OS_ERR_NONE)
+        {
+            return;
+        }
+
+        AlarmBenchSample[i] = stats.sample_latency_last_ns;
+        AlarmBenchRead[i]   = stats.latency_last_ns;
+    }
+
+    threshold.low        = (float) OS_CFG_ALARM_TEMPERATURE_LOW * 0.01f;
+    threshold.high       = (float) OS_CFG_ALARM_TEMPERATURE_HIGH * 0.01f;
+    threshold.hysteresis = (float) OS_CFG_ALARM_TEMPERATURE_HYSTERESIS * 0.01f;
+
+    alarm_set_threshold(Alarm_Temperature, &threshold, p_err);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    bench_alarm_row(p_tcb, "Alarm sample-to-LED:", AlarmBenchSample, p_err);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    bench_alarm_row(p_tcb, "Alarm read-to-LED:", AlarmBenchRead, p_err);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    alarm_reset_stats(p_err);
+}
+
+#endif
@@ -0,0 +1,78 @@
+/**
+ * @file   bench_comp.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  MS8607 Compensation Benchmark.
+ *
+ *         Logs the cycles/conversion of the float and fixed point MS8607 compensation paths
+ *         (ms8607_comp.c), once at startup with OS_CFG_APP_TASK_COMP_BENCH_EN set.
+ */
+
+#include "bench.h"
+
+#include <logger_task.h>
+
+#include <os.h>
+#include <bsp.h>
+#include <ms8607_comp.h>
+
+#include <stdint.h>
+
+#if (OS_CFG_APP_TASK_COMP_BENCH_EN > 0u)
+
+#define COMP_BENCH_READINGS (256U)
+
+/* Datasheet example calibration */
+static const MS8607_Prom CompBenchProm = {{0, 46372, 43981, 29059, 27842, 31553, 28165}};
+
+static MS8607_Raw CompBenchRaw[COMP_BENCH_READINGS];
+static volatile int32_t CompBenchSink;
+
+void bench_comp_run(OS_TCB* p_tcb, OS_ERR* p_err)
+{
+    uint32_t i;
+    float temperature;
+    float pressure;
+    float humidity;
+    MS8607_Result result;
+    CPU_TS start;
+    CPU_TS cycles;
+
+    /* Readings around 20 degC, spanning both sides of the second-order correction */
+    for (i = 0; i < COMP_BENCH_READINGS; i++)
+    {
+        CompBenchRaw[i].d1 = 6465444U + (i * 97U);
+        CompBenchRaw[i].d2 = 8077636U - (128U * 1024U) + (i * 1024U);
+        CompBenchRaw[i].d3 = (uint16_t) (20000U + (i * 64U));
+    }
+
+    start = OS_TS_GET();
+
+    for (i = 0; i < COMP_BENCH_READINGS; i++)
+    {
+        ms8607_comp_float(&CompBenchProm, &CompBenchRaw[i], &temperature, &pressure, &humidity);
+        CompBenchSink = (int32_t) (temperature + pressure + humidity);
+    }
+
+    cycles = OS_TS_GET() - start;
+
+    logger_log_float(p_tcb, p_err, "MS8607 float cycles/conversion:", (float) cycles / (float) COMP_BENCH_READINGS);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    start = OS_TS_GET();
+
+    for (i = 0; i < COMP_BENCH_READINGS; i++)
+    {
+        ms8607_comp_fixed(&CompBenchProm, &CompBenchRaw[i], &result);
+        CompBenchSink = result.temperature + result.pressure + result.humidity;
+    }
+
+    cycles = OS_TS_GET() - start;
+
+    logger_log_float(p_tcb, p_err, "MS8607 fixed cycles/conversion:", (float) cycles / (float) COMP_BENCH_READINGS);
+}
+
+#endif
@@ -0,0 +1,70 @@
+/**
+ * @file   bench_crc.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  CRC Benchmark.
+ *
+ *         Logs the cost in cycles/byte of each CRC algorithm and mode in bsp_crc.c, once at
+ *         startup with OS_CFG_APP_TASK_CRC_BENCH_EN set.
+ */
+
+#include "bench.h"
+
+#include <logger_task.h>
+
+#include <os.h>
+#include <bsp.h>
+
+#include <stdint.h>
+
+#if (OS_CFG_APP_TASK_CRC_BENCH_EN > 0u)
+
+#define CRC_BENCH_SIZE (1024U)
+
+static uint8_t CrcBenchBuf[CRC_BENCH_SIZE];
+
+void bench_crc_run(OS_TCB* p_tcb, OS_ERR* p_err)
+{
+    static const char* const messages[2][3] = {
+        {"CRC-16 software cycles/byte:", "CRC-16 polled cycles/byte:", "CRC-16 DMA cycles/byte:"},
+        {"CRC-32 software cycles/byte:", "CRC-32 polled cycles/byte:", "CRC-32 DMA cycles/byte:"},
+    };
+    static const CRC_AlgoTypeDef algos[2] = {CRC_Algo_CRC16_CCITT, CRC_Algo_CRC32};
+    static const CRC_ModeTypeDef modes[3] = {CRC_Mode_Software, CRC_Mode_Polled, CRC_Mode_DMA};
+
+    uint32_t i;
+    uint32_t j;
+    uint32_t crc;
+    CPU_TS start;
+    CPU_TS cycles;
+    BSP_RESULT result;
+
+    for (i = 0; i < CRC_BENCH_SIZE; i++)
+    {
+        CrcBenchBuf[i] = (uint8_t) (i * 31U + 7U);
+    }
+
+    for (i = 0; i < 2U; i++)
+    {
+        for (j = 0; j < 3U; j++)
+        {
+            start  = OS_TS_GET();
+            result = BSP_CRC_Calculate(algos[i], modes[j], CrcBenchBuf, CRC_BENCH_SIZE, &crc);
+            cycles = OS_TS_GET() - start;
+
+            if (result != BSP_SUCCESS)
+            {
+                *p_err = OS_ERR_OPT_INVALID;
+                return;
+            }
+
+            logger_log_float(p_tcb, p_err, messages[i][j], (float) cycles / (float) CRC_BENCH_SIZE);
+
+            if (*p_err != OS_ERR_NONE)
+            {
+                return;
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,101 @@
+/**
+ * @file   bench_filter.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Filter Benchmark.
+ *
+ *         Logs the cycles/reading of each filter in filter.c and a checksum of its outputs,
+ *         once at startup with OS_CFG_APP_TASK_FILTER_BENCH_EN set. The checksums are the
+ *         same on every build when the SIMD and portable kernels agree bit for bit.
+ */
+
+#include "bench.h"
+
+#include <filter.h>
+#include <logger_task.h>
+
+#include <os.h>
+
+#include <stdint.h>
+
+#if (OS_CFG_APP_TASK_FILTER_BENCH_EN > 0u)
+
+#define FILTER_BENCH_READINGS (256U)
+#define FILTER_BENCH_WINDOW   (8U)
+#define FILTER_BENCH_ALPHA    (8192U)
+
+static int16_t FilterBenchInput[FILTER_BENCH_READINGS];
+static Filter_Bank FilterBenchBank;
+
+/* FNV-1a over the outputs, the same on every build if the kernels are bit-exact */
+static uint32_t bench_filter_checksum(uint32_t hash, int16_t value)
+{
+    hash ^= (uint16_t) value;
+
+    return hash * 16777619U;
+}
+
+void bench_filter_run(OS_TCB* p_tcb, OS_ERR* p_err)
+{
+    static const char* const messages[3][2] = {
+        {"Moving average cycles/reading:", "Moving average checksum ="},
+        {"Low-pass cycles/reading:", "Low-pass checksum ="},
+        {"Median cycles/reading:", "Median checksum ="},
+    };
+    static const Filter_TypeDef types[3] = {Filter_MovingAverage, Filter_LowPass, Filter_Median};
+
+    uint32_t i;
+    uint32_t j;
+    uint32_t lcg;
+    uint32_t hash;
+    int16_t out[3];
+    CPU_TS start;
+    CPU_TS cycles;
+
+    /* A slow ramp with noise and occasional spikes */
+    lcg = 1U;
+
+    for (i = 0; i < FILTER_BENCH_READINGS; i++)
+    {
+        lcg                 = (lcg * 1103515245U) + 12345U;
+        FilterBenchInput[i] = (int16_t) ((int32_t) i + (int32_t) ((lcg >> 16) % 64U) - 32 +
+                                         ((((lcg >> 8) & 0x1FU) == 0U) ? 2000 : 0));
+    }
+
+    for (i = 0; i < 3U; i++)
+    {
+        filter_init(&FilterBenchBank, types[i], FILTER_BENCH_WINDOW, FILTER_BENCH_ALPHA);
+
+        hash   = 2166136261U;
+        cycles = 0;
+
+        for (j = 0; j < FILTER_BENCH_READINGS; j++)
+        {
+            /* One reading is one sample on each channel */
+            start  = OS_TS_GET();
+            out[0] = filter_update(&FilterBenchBank, &FilterBenchBank.temperature, FilterBenchInput[j]);
+            out[1] = filter_update(&FilterBenchBank, &FilterBenchBank.humidity, (int16_t) -FilterBenchInput[j]);
+            out[2] = filter_update(&FilterBenchBank, &FilterBenchBank.pressure, (int16_t) (FilterBenchInput[j] * 4));
+            cycles += OS_TS_GET() - start;
+
+            hash = bench_filter_checksum(hash, out[0]);
+            hash = bench_filter_checksum(hash, out[1]);
+            hash = bench_filter_checksum(hash, out[2]);
+        }
+
+        logger_log_float(p_tcb, p_err, messages[i][0], (float) cycles / (float) FILTER_BENCH_READINGS);
+
+        if (*p_err != OS_ERR_NONE)
+        {
+            return;
+        }
+
+        logger_log_int(p_tcb, p_err, messages[i][1], hash);
+
+        if (*p_err != OS_ERR_NONE)
+        {
+            return;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ * @file   bench_i2c.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  I2C Speed Benchmark.
+ *
+ *         Logs one line per I2C SCL speed with the measured time per full MS8607 read and
+ *         how much of it the bus transfers take (from the i2c.c transfer counters), once at
+ *         startup with OS_CFG_APP_TASK_I2C_BENCH_EN set. The rest is conversion time, which
+ *         does not depend on the bus speed, so the fastest resolution is used to make the
+ *         difference visible.
+ */
+
+#include "bench.h"
+
+#include <logger_task.h>
+
+#include <os.h>
+#include <bsp.h>
+
+#include <stdio.h>
+#include <stdint.h>
+
+#if (OS_CFG_APP_TASK_I2C_BENCH_EN > 0u)
+
+#define I2C_BENCH_READS    (32U)
+#define I2C_BENCH_MSG_SIZE (96U)
+
+void bench_i2c_run(OS_TCB* p_tcb, OS_ERR* p_err)
+{
+    static const char* const names[] = {"100 kHz:", "400 kHz:", "1 MHz:"};
+
+    uint32_t i;
+    uint32_t j;
+    uint64_t start_ns;
+    uint64_t elapsed_ns;
+    Sensor_Resolution resolution;
+    Sensor_BusStats stats;
+    Sensor_Data data;
+    char msg[I2C_BENCH_MSG_SIZE];
+
+    resolution.osr           = Sensor_OSR_256;
+    resolution.rh_resolution = Sensor_RH_8Bit;
+
+    if ((BSP_Sensor_Reset(Sensor_MS8607) != BSP_SUCCESS) ||
+        (BSP_Sensor_SetResolution(Sensor_MS8607, &resolution) != BSP_SUCCESS))
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return;
+    }
+
+    for (i = 0; i <= (uint32_t) Sensor_BusSpeed_1MHz; i++)
+    {
+        /* A speed the bus timing cannot meet at the current clock is reported and skipped */
+        if (BSP_Sensor_SetBusSpeed(Sensor_MS8607, (Sensor_BusSpeedTypeDef) i) != BSP_SUCCESS)
+        {
+            (void) snprintf(msg, sizeof(msg), "%s not supported", names[i]);
+            logger_log(p_tcb, p_err, msg);
+
+            if (*p_err != OS_ERR_NONE)
+            {
+                return;
+            }
+
+            continue;
+        }
+
+        /* The first read at a new speed is not timed, it may include the switch */
+        if ((BSP_Sensor_Read(Sensor_MS8607, &data) != BSP_SUCCESS) || (BSP_Sensor_ResetBusStats() != BSP_SUCCESS))
+        {
+            *p_err = OS_ERR_OPT_INVALID;
+            return;
+        }
+
+        start_ns = BSP_Timebase_GetNs();
+
+        /* Failed reads are counted rather than fatal, the MS8607 is only specified up to 400 kHz */
+        for (j = 0; j < I2C_BENCH_READS; j++)
+        {
+            (void) BSP_Sensor_Read(Sensor_MS8607, &data);
+        }
+
+        elapsed_ns = BSP_Timebase_GetNs() - start_ns;
+
+        if (BSP_Sensor_GetBusStats(&stats) != BSP_SUCCESS)
+        {
+            *p_err = OS_ERR_OPT_INVALID;
+            return;
+        }
+
+        (void) snprintf(msg, sizeof(msg), "%s read=%.2fms bus=%.1fus/read transfers=%lu errors=%lu failures=%lu",
+                        names[i], (double) elapsed_ns / (1e6 * (double) I2C_BENCH_READS),
+                        (double) stats.transfer_ns / (1e3 * (double) I2C_BENCH_READS),
+                        (unsigned long) stats.num_transfers, (unsigned long) stats.num_errors,
+                        (unsigned long) stats.num_failures);
+
+        logger_log(p_tcb, p_err, msg);
+
+        if (*p_err != OS_ERR_NONE)
+        {
+            return;
+        }
+    }
+
+    /* The sensor task applies its own speed and resolution */
+    if ((BSP_Sensor_SetBusSpeed(Sensor_MS8607, Sensor_BusSpeed_100kHz) != BSP_SUCCESS) ||
+        (BSP_Sensor_ResetBusStats() != BSP_SUCCESS))
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+    }
+}
+
+#endif
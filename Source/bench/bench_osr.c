@@ -0,0 +1,136 @@
+/**
+ * @file   bench_osr.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Sensor Resolution Benchmark.
+ *
+ *         Logs one line per MS8607 resolution setting with the measured time per read and
+ *         the noise on each channel, once at startup with OS_CFG_APP_TASK_OSR_BENCH_EN set.
+ *         The noise is the standard deviation of the difference between consecutive reads
+ *         divided by sqrt(2), which cancels out slow changes in the actual weather.
+ */
+
+#include "bench.h"
+
+#include <aggregate.h>
+#include <logger_task.h>
+
+#include <os.h>
+#include <bsp.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#if (OS_CFG_APP_TASK_OSR_BENCH_EN > 0u)
+
+#define OSR_BENCH_READS    (32U)
+#define OSR_BENCH_MSG_SIZE (96U)
+
+static void bench_osr_row(OS_TCB* p_tcb, const char* p_name, const Sensor_Resolution* p_resolution, OS_ERR* p_err)
+{
+    uint32_t i;
+    uint32_t latency_us;
+    uint64_t start_ns;
+    uint64_t elapsed_ns;
+    Sensor_Data prev;
+    Sensor_Data curr;
+    Sensor_Data delta;
+    Aggregate_Window window;
+    char msg[OSR_BENCH_MSG_SIZE];
+
+    /* The first read at a new setting is not timed */
+    if ((BSP_Sensor_SetResolution(Sensor_MS8607, p_resolution) != BSP_SUCCESS) ||
+        (BSP_Sensor_GetLatency(Sensor_MS8607, &latency_us) != BSP_SUCCESS) ||
+        (BSP_Sensor_Read(Sensor_MS8607, &prev) != BSP_SUCCESS))
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return;
+    }
+
+    aggregate_reset(&window);
+    start_ns = BSP_Timebase_GetNs();
+
+    for (i = 0; i < OSR_BENCH_READS; i++)
+    {
+        if (BSP_Sensor_Read(Sensor_MS8607, &curr) != BSP_SUCCESS)
+        {
+            *p_err = OS_ERR_OPT_INVALID;
+            return;
+        }
+
+        delta                      = curr;
+        delta.temperature          = curr.temperature - prev.temperature;
+        delta.temperature_is_valid = curr.temperature_is_valid && prev.temperature_is_valid;
+        delta.humidity             = curr.humidity - prev.humidity;
+        delta.humidity_is_valid    = curr.humidity_is_valid && prev.humidity_is_valid;
+        delta.pressure             = curr.pressure - prev.pressure;
+        delta.pressure_is_valid    = curr.pressure_is_valid && prev.pressure_is_valid;
+
+        aggregate_add(&window, &delta);
+        prev = curr;
+    }
+
+    elapsed_ns = BSP_Timebase_GetNs() - start_ns;
+
+    (void) snprintf(msg, sizeof(msg), "%s conv=%luus read=%.2fms T=%.4fdegC RH=%.3f%% P=%.4fmbar", p_name,
+                    (unsigned long) latency_us, (double) elapsed_ns / (1e6 * (double) OSR_BENCH_READS),
+                    (double) sqrtf(aggregate_variance(&window.temperature) / 2.0f),
+                    (double) sqrtf(aggregate_variance(&window.humidity) / 2.0f),
+                    (double) sqrtf(aggregate_variance(&window.pressure) / 2.0f));
+
+    logger_log(p_tcb, p_err, msg);
+}
+
+void bench_osr_run(OS_TCB* p_tcb, OS_ERR* p_err)
+{
+    static const char* const osr_names[] = {"OSR 256:", "OSR 512:", "OSR 1024:", "OSR 2048:", "OSR 4096:", "OSR 8192:"};
+    static const char* const rh_names[]  = {"RH 8-bit:", "RH 10-bit:", "RH 11-bit:", "RH 12-bit:"};
+
+    uint32_t i;
+    Sensor_Resolution resolution;
+
+    if (BSP_Sensor_Reset(Sensor_MS8607) != BSP_SUCCESS)
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return;
+    }
+
+    /* Pressure and temperature, humidity at its fastest so it adds the least to each read */
+    resolution.rh_resolution = Sensor_RH_8Bit;
+
+    for (i = 0; i <= (uint32_t) Sensor_OSR_8192; i++)
+    {
+        resolution.osr = (Sensor_OSRTypeDef) i;
+        bench_osr_row(p_tcb, osr_names[i], &resolution, p_err);
+
+        if (*p_err != OS_ERR_NONE)
+        {
+            return;
+        }
+    }
+
+    /* Humidity, pressure and temperature at their fastest */
+    resolution.osr = Sensor_OSR_256;
+
+    for (i = 0; i <= (uint32_t) Sensor_RH_12Bit; i++)
+    {
+        resolution.rh_resolution = (Sensor_RHResolutionTypeDef) i;
+        bench_osr_row(p_tcb, rh_names[i], &resolution, p_err);
+
+        if (*p_err != OS_ERR_NONE)
+        {
+            return;
+        }
+    }
+
+    /* The sensor task applies its own setting after its reset */
+    resolution.osr           = Sensor_OSR_8192;
+    resolution.rh_resolution = Sensor_RH_12Bit;
+
+    if (BSP_Sensor_SetResolution(Sensor_MS8607, &resolution) != BSP_SUCCESS)
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+    }
+}
+
+#endif
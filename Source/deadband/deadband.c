@@ -0,0 +1,117 @@
+/**
+ * @file   deadband.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Change-Driven (Deadband) Reporting.
+ *
+ *         Temperature and pressure barely move between reads, so reporting every reading
+ *         mostly repeats the previous one. A channel is only reported when it has moved
+ *         further than its threshold from the last value that was reported, or when it has
+ *         not been reported for `max_age_ns`. Comparing against the last reported value
+ *         (rather than the previous reading) means a slow drift is still reported once it
+ *         adds up, and the max age gives the receiver a heartbeat to tell a stable value
+ *         from a lost link.
+ */
+
+#include "deadband.h"
+
+#include <bsp.h>
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+static void channel_init(Deadband_Channel* p_channel, float threshold)
+{
+    p_channel->threshold  = threshold;
+    p_channel->last_value = 0.0f;
+    p_channel->last_ns    = 0;
+    p_channel->has_value  = false;
+}
+
+static bool exceeds(float a, float b, float threshold)
+{
+    return ((a - b) > threshold) || ((b - a) > threshold);
+}
+
+/* Returns whether `value` should be reported, and if so remembers it as the last report */
+static bool channel_apply(Deadband_Channel* p_channel, float value, uint64_t now_ns, uint64_t max_age_ns)
+{
+    bool report;
+
+    if (p_channel->has_value == false)
+    {
+        report = true;
+    }
+    else if (exceeds(value, p_channel->last_value, p_channel->threshold) == true)
+    {
+        report = true;
+    }
+    else
+    {
+        report = (max_age_ns > 0U) && ((now_ns - p_channel->last_ns) >= max_age_ns);
+    }
+
+    if (report == true)
+    {
+        p_channel->last_value = value;
+        p_channel->last_ns    = now_ns;
+        p_channel->has_value  = true;
+    }
+
+    return report;
+}
+
+void deadband_init(Deadband_Filter* p_filter, float temperature, float humidity, float pressure,
+                   uint64_t max_age_ns)
+{
+    p_filter->max_age_ns = max_age_ns;
+
+    channel_init(&p_filter->temperature, temperature);
+    channel_init(&p_filter->humidity, humidity);
+    channel_init(&p_filter->pressure, pressure);
+}
+
+/* Clears the valid flag of every channel that does not need reporting, returns false if none is left */
+bool deadband_apply(Deadband_Filter* p_filter, Sensor_Data* p_data)
+{
+    if (p_data->temperature_is_valid == true)
+    {
+        p_data->temperature_is_valid = channel_apply(&p_filter->temperature, p_data->temperature,
+                                                     p_data->timestamp_ns, p_filter->max_age_ns);
+    }
+
+    if (p_data->humidity_is_valid == true)
+    {
+        p_data->humidity_is_valid = channel_apply(&p_filter->humidity, p_data->humidity,
+                                                  p_data->timestamp_ns, p_filter->max_age_ns);
+    }
+
+    if (p_data->pressure_is_valid == true)
+    {
+        p_data->pressure_is_valid = channel_apply(&p_filter->pressure, p_data->pressure,
+                                                  p_data->timestamp_ns, p_filter->max_age_ns);
+    }
+
+    return (p_data->temperature_is_valid == true) ||
+           (p_data->humidity_is_valid == true) ||
+           (p_data->pressure_is_valid == true);
+}
+
+/* Whether any channel valid in both readings moved further than its threshold between them */
+bool deadband_changed(const Deadband_Filter* p_filter, const Sensor_Data* p_prev, const Sensor_Data* p_curr)
+{
+    if ((p_prev->temperature_is_valid == true) && (p_curr->temperature_is_valid == true) &&
+        (exceeds(p_curr->temperature, p_prev->temperature, p_filter->temperature.threshold) == true))
+    {
+        return true;
+    }
+
+    if ((p_prev->humidity_is_valid == true) && (p_curr->humidity_is_valid == true) &&
+        (exceeds(p_curr->humidity, p_prev->humidity, p_filter->humidity.threshold) == true))
+    {
+        return true;
+    }
+
+    return (p_prev->pressure_is_valid == true) && (p_curr->pressure_is_valid == true) &&
+           (exceeds(p_curr->pressure, p_prev->pressure, p_filter->pressure.threshold) == true);
+}
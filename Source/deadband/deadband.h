@@ -0,0 +1,36 @@
+/**
+ * @file   deadband.h
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Change-Driven (Deadband) Reporting.
+ */
+
+#ifndef DEADBAND_H
+#define DEADBAND_H
+
+#include <bsp.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct
+{
+    float    threshold;  /* Report once the value moves further than this   */
+    float    last_value; /* Last reported value, unset if `has_value` false */
+    uint64_t last_ns;    /* Timestamp of the last report                    */
+    bool     has_value;
+} Deadband_Channel;
+
+typedef struct
+{
+    uint64_t         max_age_ns; /* Report at least this often, 0 disables */
+    Deadband_Channel temperature;
+    Deadband_Channel humidity;
+    Deadband_Channel pressure;
+} Deadband_Filter;
+
+void deadband_init   (Deadband_Filter* p_filter, float temperature, float humidity, float pressure,
+                      uint64_t max_age_ns);
+bool deadband_apply  (Deadband_Filter* p_filter, Sensor_Data* p_data);
+bool deadband_changed(const Deadband_Filter* p_filter, const Sensor_Data* p_prev, const Sensor_Data* p_curr);
+
+#endif /* DEADBAND_H */
@@ -0,0 +1,308 @@
+/**
+ * @file   filter.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Per-Channel Sensor Filters.
+ *
+ *         Moving average, one-pole IIR low-pass, and median-of-N filters for each channel
+ *         of `Sensor_Data`. Samples are kept as 16-bit fixed point, in the same 0.01 units
+ *         as the telemetry frame fields but relative to the first valid sample of the
+ *         channel, so that pressure (around 100000 counts) also fits. Readings more than
+ *         327.67 units away from the first one saturate.
+ *
+ *         The kernels work on the whole window of packed 16-bit samples. When the compiler
+ *         targets the Cortex-M7 DSP extension (`__ARM_FEATURE_DSP`) and OS_CFG_FILTER_SIMD_EN
+ *         is set, they use the SIMD instructions:
+ *
+ *             - Moving average: SMLAD adds two samples per instruction.
+ *             - Low-pass: SMLAWB does the 32x16 multiply-accumulate of the update.
+ *             - Median: SSUB16 and SEL compare two samples against the candidate at once,
+ *               and SADD16 keeps both lanes' counts in one register.
+ *
+ *         Otherwise (including the hosted build) the portable C kernels below are used. Both
+ *         produce bit-identical results. OS_CFG_APP_TASK_FILTER_BENCH_EN logs cycles/reading
+ *         and a checksum of the outputs for each filter, and the checksums must match between
+ *         the device, the device with OS_CFG_FILTER_SIMD_EN cleared, and the hosted build.
+ */
+
+#include "filter.h"
+
+#include <os.h>
+#include <bsp.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if (OS_CFG_FILTER_SIMD_EN > 0u) && defined(__ARM_FEATURE_DSP)
+#define FILTER_SIMD_EN (1)
+#include <arm_acle.h>
+#else
+#define FILTER_SIMD_EN (0)
+#endif
+
+/* Low-pass state is kept with 8 extra fraction bits, so small steps are not lost */
+#define LOWPASS_SHIFT  (8)
+
+/* A 1 in both 16-bit lanes */
+#define LANE_ONES      (0x00010001)
+
+#if (FILTER_SIMD_EN > 0)
+static int32_t load_pair(const int16_t* p_x)
+{
+    int32_t pair;
+
+    memcpy(&pair, p_x, sizeof(pair));
+
+    return pair;
+}
+#endif
+
+static int32_t kernel_sum(const int16_t* p_x, uint32_t n)
+{
+    int32_t sum;
+    uint32_t i;
+
+    sum = 0;
+    i   = 0;
+
+#if (FILTER_SIMD_EN > 0)
+    /* Dot product with a vector of ones, two samples per instruction */
+    for (; (i + 1U) < n; i += 2U)
+    {
+        sum = __smlad(load_pair(&p_x[i]), LANE_ONES, sum);
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        sum += p_x[i];
+    }
+
+    return sum;
+}
+
+/* state += (sample - state) * alpha, written as ((2 * diff) * alpha) >> 16 to match SMLAWB */
+static int32_t kernel_lowpass(int32_t state, int16_t sample, int16_t alpha)
+{
+    int32_t diff;
+
+    /* At most 2^25, so doubling it cannot overflow */
+    diff = ((int32_t) sample * (1 << LOWPASS_SHIFT)) - state;
+
+#if (FILTER_SIMD_EN > 0)
+    return __smlawb(diff * 2, (int32_t) alpha, state);
+#else
+    return state + (int32_t) (((int64_t) (diff * 2) * alpha) >> 16);
+#endif
+}
+
+/* Number of samples below `x`, and at or below `x` */
+static void kernel_rank(const int16_t* p_x, uint32_t n, int16_t x, uint32_t* p_below, uint32_t* p_not_above)
+{
+    uint32_t below;
+    uint32_t not_above;
+    uint32_t i;
+#if (FILTER_SIMD_EN > 0)
+    int32_t pair;
+    int32_t dup;
+    int32_t below_lanes;
+    int32_t not_above_lanes;
+#endif
+
+    below     = 0;
+    not_above = 0;
+    i         = 0;
+
+#if (FILTER_SIMD_EN > 0)
+    dup             = (int32_t) ((uint32_t) (uint16_t) x * (uint32_t) LANE_ONES);
+    below_lanes     = 0;
+    not_above_lanes = 0;
+
+    for (; (i + 1U) < n; i += 2U)
+    {
+        pair = load_pair(&p_x[i]);
+
+        /* GE flags set in the lanes where pair >= x, SEL then picks 0 there and 1 elsewhere */
+        (void) __ssub16(pair, dup);
+        below_lanes = __sadd16(below_lanes, __sel(0, LANE_ONES));
+
+        /* GE flags set in the lanes where x >= pair */
+        (void) __ssub16(dup, pair);
+        not_above_lanes = __sadd16(not_above_lanes, __sel(LANE_ONES, 0));
+    }
+
+    below     = ((uint32_t) below_lanes & 0xFFFFU) + ((uint32_t) below_lanes >> 16);
+    not_above = ((uint32_t) not_above_lanes & 0xFFFFU) + ((uint32_t) not_above_lanes >> 16);
+#endif
+
+    for (; i < n; i++)
+    {
+        below     += (p_x[i] < x) ? 1U : 0U;
+        not_above += (p_x[i] <= x) ? 1U : 0U;
+    }
+
+    *p_below     = below;
+    *p_not_above = not_above;
+}
+
+/* Rank selection, the lower median for an even window. O(n^2) compares, but n is small and no copy is sorted */
+static int16_t kernel_median(const int16_t* p_x, uint32_t n)
+{
+    uint32_t i;
+    uint32_t k;
+    uint32_t below;
+    uint32_t not_above;
+
+    k = (n - 1U) / 2U;
+
+    for (i = 0; i < n; i++)
+    {
+        kernel_rank(p_x, n, p_x[i], &below, &not_above);
+
+        if ((below <= k) && (k < not_above))
+        {
+            break;
+        }
+    }
+
+    return p_x[i];
+}
+
+/* Round to nearest, halves away from zero, `den` must be positive */
+static int32_t div_round(int32_t num, int32_t den)
+{
+    return (num >= 0) ? ((num + (den / 2)) / den) : -((-num + (den / 2)) / den);
+}
+
+static void channel_reset(Filter_Channel* p_channel)
+{
+    memset(p_channel->history, 0, sizeof(p_channel->history));
+
+    p_channel->count      = 0;
+    p_channel->next       = 0;
+    p_channel->state      = 0;
+    p_channel->offset     = 0;
+    p_channel->has_offset = false;
+}
+
+static void channel_apply(Filter_Bank* p_bank, Filter_Channel* p_channel, float* p_value)
+{
+    float scaled;
+    int32_t centi;
+    int32_t delta;
+
+    scaled = *p_value * 100.0f;
+    centi  = (int32_t) ((scaled >= 0.0f) ? (scaled + 0.5f) : (scaled - 0.5f));
+
+    if (p_channel->has_offset == false)
+    {
+        p_channel->offset     = centi;
+        p_channel->has_offset = true;
+    }
+
+    delta = centi - p_channel->offset;
+
+    if (delta > INT16_MAX)
+    {
+        delta = INT16_MAX;
+    }
+    else if (delta < INT16_MIN)
+    {
+        delta = INT16_MIN;
+    }
+
+    *p_value = (float) (p_channel->offset + filter_update(p_bank, p_channel, (int16_t) delta)) / 100.0f;
+}
+
+void filter_init(Filter_Bank* p_bank, Filter_TypeDef type, uint32_t window, uint16_t alpha)
+{
+    if (window < 1U)
+    {
+        window = 1U;
+    }
+    else if (window > FILTER_MAX_WINDOW)
+    {
+        window = FILTER_MAX_WINDOW;
+    }
+
+    if (alpha < 1U)
+    {
+        alpha = 1U;
+    }
+    else if (alpha > (uint16_t) INT16_MAX)
+    {
+        alpha = (uint16_t) INT16_MAX;
+    }
+
+    p_bank->type   = type;
+    p_bank->window = window;
+    p_bank->alpha  = (int16_t) alpha;
+
+    channel_reset(&p_bank->temperature);
+    channel_reset(&p_bank->humidity);
+    channel_reset(&p_bank->pressure);
+}
+
+/* Adds one sample (relative to the channel offset) and returns the filter output */
+int16_t filter_update(const Filter_Bank* p_bank, Filter_Channel* p_channel, int16_t sample)
+{
+    bool first;
+
+    first = (p_channel->count == 0U);
+
+    p_channel->history[p_channel->next] = sample;
+    p_channel->next                     = (p_channel->next + 1U) % p_bank->window;
+
+    if (p_channel->count < p_bank->window)
+    {
+        p_channel->count++;
+    }
+
+    switch (p_bank->type)
+    {
+    case Filter_MovingAverage:
+        return (int16_t) div_round(kernel_sum(p_channel->history, p_channel->count), (int32_t) p_channel->count);
+
+    case Filter_LowPass:
+        if (first == true)
+        {
+            p_channel->state = (int32_t) sample * (1 << LOWPASS_SHIFT);
+        }
+        else
+        {
+            p_channel->state = kernel_lowpass(p_channel->state, sample, p_bank->alpha);
+        }
+
+        return (int16_t) ((p_channel->state + (1 << (LOWPASS_SHIFT - 1))) >> LOWPASS_SHIFT);
+
+    case Filter_Median:
+        return kernel_median(p_channel->history, p_channel->count);
+
+    /* Filter_None, or bad input */
+    default:
+        return sample;
+    }
+}
+
+void filter_apply(Filter_Bank* p_bank, Sensor_Data* p_data)
+{
+    if (p_bank->type == Filter_None)
+    {
+        return;
+    }
+
+    if (p_data->temperature_is_valid == true)
+    {
+        channel_apply(p_bank, &p_bank->temperature, &p_data->temperature);
+    }
+
+    if (p_data->humidity_is_valid == true)
+    {
+        channel_apply(p_bank, &p_bank->humidity, &p_data->humidity);
+    }
+
+    if (p_data->pressure_is_valid == true)
+    {
+        channel_apply(p_bank, &p_bank->pressure, &p_data->pressure);
+    }
+}
@@ -0,0 +1,50 @@
+/**
+ * @file   filter.h
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Per-Channel Sensor Filters.
+ */
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <bsp.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Longest moving average or median window */
+#define FILTER_MAX_WINDOW (16U)
+
+typedef enum
+{
+    Filter_None,
+    Filter_MovingAverage,
+    Filter_LowPass,
+    Filter_Median,
+} Filter_TypeDef;
+
+typedef struct
+{
+    int16_t  history[FILTER_MAX_WINDOW]; /* Ring of samples, relative to `offset`      */
+    uint32_t count;                      /* Samples in `history`, up to the window     */
+    uint32_t next;                       /* Ring index of the next sample              */
+    int32_t  state;                      /* Low-pass output, 2^8 per count             */
+    int32_t  offset;                     /* First valid sample, 0.01 units             */
+    bool     has_offset;
+} Filter_Channel;
+
+typedef struct
+{
+    Filter_TypeDef type;
+    uint32_t       window;               /* Moving average and median length           */
+    int16_t        alpha;                /* Low-pass coefficient, Q15 in (0, 1)        */
+    Filter_Channel temperature;
+    Filter_Channel humidity;
+    Filter_Channel pressure;
+} Filter_Bank;
+
+void    filter_init  (Filter_Bank* p_bank, Filter_TypeDef type, uint32_t window, uint16_t alpha);
+int16_t filter_update(const Filter_Bank* p_bank, Filter_Channel* p_channel, int16_t sample);
+void    filter_apply (Filter_Bank* p_bank, Sensor_Data* p_data);
+
+#endif /* FILTER_H */
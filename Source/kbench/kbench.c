@@ -0,0 +1,558 @@
+/**
+ * @file   kbench.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Kernel Primitive Benchmarks.
+ *
+ *         Measures the uCOS-III primitives this application is built on, with the timestamp
+ *         timer (`OS_TS_GET`, the DWT cycle counter on the board and nanoseconds on the hosted
+ *         build, the first line logged is its frequency). Each primitive is timed
+ *         OS_CFG_KBENCH_SAMPLES times after a few untimed warm-up iterations, and reported as
+ *         min/median/max through the logger once every primitive has been measured:
+ *
+ *             - Timestamp read: two back-to-back `OS_TS_GET`, included in every other result.
+ *             - `OSMemGet` and `OSMemPut` on a partition of their own.
+ *             - `OSTaskQPost` to a higher priority task blocked in `OSTaskQPend`, up to its return.
+ *             - `OSMutexPend` then `OSMutexPost` of a free mutex.
+ *             - `OSMutexPost` of a mutex a higher priority task is blocked on, up to its
+ *               `OSMutexPend` return. This includes undoing the priority inheritance.
+ *             - `OSSemPost` from an interrupt (`BSP_SWI_Trigger`) to the return of `OSSemPend`
+ *               in the task it readies, which includes `OSIntExit` and the context switch.
+ *             - Context switch: a task blocking in `OSTaskSemPend` up to the task it switches to
+ *               running again.
+ *
+ *         The tasks that take part run above the benchmark task (OS_CFG_KBENCH_HELPER_PRIO),
+ *         so each handoff is a preemption. Ticks and the tasks of higher priority still run
+ *         during the measurements, which shows in the max column.
+ *
+ *         This is only built into the kbench.elf target (`APP_KBENCH`, `make kbench` or
+ *         `make kbench-hosted`), where the application task runs it once at startup. On the
+ *         hosted build the software interrupt comes from the next tick, which does not change
+ *         what is measured, and every time is host time on the POSIX port, so its results are
+ *         for comparing hosted runs with each other.
+ */
+
+#include "kbench.h"
+
+#include <logger_task.h>
+
+#include <os.h>
+#include <bsp.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define KBENCH_WARMUP          (4U)
+#define KBENCH_ITERATIONS      (OS_CFG_KBENCH_SAMPLES + KBENCH_WARMUP)
+
+#define KBENCH_MEM_BLOCKS      (4U)
+#define KBENCH_MEM_BLOCK_SIZE  (32U)
+
+/* The hosted software interrupt waits for the next tick */
+#define KBENCH_ISR_TIMEOUT     (10U)
+
+#define KBENCH_MSG_SIZE        (96U)
+
+typedef enum
+{
+    Kbench_Timestamp,
+    Kbench_MemGet,
+    Kbench_MemPut,
+    Kbench_TaskQ,
+    Kbench_MutexFree,
+    Kbench_MutexContended,
+    Kbench_IsrSem,
+    Kbench_Switch,
+    Kbench_NumTests,
+} Kbench_TestTypeDef;
+
+typedef struct
+{
+    CPU_TS min;
+    CPU_TS median;
+    CPU_TS max;
+} Kbench_Result;
+
+static OS_TCB  KbenchTaskTCB;
+static CPU_STK KbenchTaskStack[OS_CFG_KBENCH_TASK_STK_SIZE];
+static OS_TCB  KbenchHelperTCB;
+static CPU_STK KbenchHelperStack[OS_CFG_KBENCH_HELPER_STK_SIZE];
+
+static OS_SEM   KbenchDoneSem;
+static OS_SEM   KbenchIsrSem;
+static OS_MUTEX KbenchMutex;
+static OS_MEM   KbenchMem;
+static CPU_INT32U KbenchMemStorage[KBENCH_MEM_BLOCKS][KBENCH_MEM_BLOCK_SIZE / sizeof(CPU_INT32U)];
+
+/* Set right before the measured primitive, by whichever side starts it */
+static volatile CPU_TS KbenchStart;
+
+static CPU_TS   KbenchSamples[OS_CFG_KBENCH_SAMPLES];
+static uint32_t KbenchNumSamples;
+static uint32_t KbenchNumSkipped;
+
+static Kbench_Result KbenchResults[Kbench_NumTests];
+
+static void kbench_error_handler(const char* msg, uint32_t actual, uint32_t expected)
+{
+    /* New errors are ignored, since there is no other course of action */
+    OS_ERR err;
+
+    if (actual != expected)
+    {
+        /* Attempt to log an error message */
+        logger_log_int(&KbenchTaskTCB, &err, msg, actual);
+
+        /* Attempt to turn on the red LED */
+        (void) BSP_LED_On(LED_RED);
+
+        /* Suspend the current task */
+        OSTaskSuspend((OS_TCB*) NULL,
+                      (OS_ERR*) &err);
+    }
+}
+
+static void kbench_record(CPU_TS sample)
+{
+    if (KbenchNumSkipped < KBENCH_WARMUP)
+    {
+        KbenchNumSkipped++;
+    }
+    else if (KbenchNumSamples < OS_CFG_KBENCH_SAMPLES)
+    {
+        KbenchSamples[KbenchNumSamples++] = sample;
+    }
+}
+
+static int kbench_compare(const void* p_a, const void* p_b)
+{
+    CPU_TS a = *(const CPU_TS*) p_a;
+    CPU_TS b = *(const CPU_TS*) p_b;
+
+    return (a > b) - (a < b);
+}
+
+/* Summarizes the samples recorded for `test` and starts over */
+static void kbench_summarize(Kbench_TestTypeDef test)
+{
+    kbench_error_handler("Kernel bench samples missing:", KbenchNumSamples, OS_CFG_KBENCH_SAMPLES);
+
+    qsort(KbenchSamples, KbenchNumSamples, sizeof(KbenchSamples[0]), kbench_compare);
+
+    KbenchResults[test].min    = KbenchSamples[0];
+    KbenchResults[test].median = KbenchSamples[KbenchNumSamples / 2U];
+    KbenchResults[test].max    = KbenchSamples[KbenchNumSamples - 1U];
+
+    KbenchNumSamples = 0;
+    KbenchNumSkipped = 0;
+}
+
+/* Runs right away, and every time it is readied, until it is deleted */
+static void kbench_helper_create(OS_TASK_PTR p_task)
+{
+    OS_ERR err;
+
+    OSTaskCreate((OS_TCB*)      &KbenchHelperTCB,
+                 (CPU_CHAR*)    "Kernel Bench Helper",
+                 (OS_TASK_PTR)  p_task,
+                 (void*)        NULL,
+                 (OS_PRIO)      OS_CFG_KBENCH_HELPER_PRIO,
+                 (CPU_STK*)     &KbenchHelperStack,
+                 (CPU_STK_SIZE) OS_CFG_KBENCH_HELPER_STK_SIZE / 10,
+                 (CPU_STK_SIZE) OS_CFG_KBENCH_HELPER_STK_SIZE,
+                 (OS_MSG_QTY)   1,
+                 (OS_TICK)      0,
+                 (void*)        0,
+                 (OS_OPT)       OS_OPT_TASK_STK_CHK | OS_OPT_TASK_STK_CLR,
+                 (OS_ERR*)      &err);
+    kbench_error_handler("OSTaskCreate failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+}
+
+static void kbench_helper_delete(void)
+{
+    OS_ERR err;
+
+    OSTaskDel((OS_TCB*) &KbenchHelperTCB,
+              (OS_ERR*) &err);
+    kbench_error_handler("OSTaskDel failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+}
+
+static void kbench_taskq_helper(void* p_arg)
+{
+    OS_MSG_SIZE size;
+    OS_ERR err;
+
+    while (1)
+    {
+        (void) OSTaskQPend((OS_TICK)      0,
+                           (OS_OPT)       OS_OPT_PEND_BLOCKING,
+                           (OS_MSG_SIZE*) &size,
+                           (CPU_TS*)      NULL,
+                           (OS_ERR*)      &err);
+        kbench_record(OS_TS_GET() - KbenchStart);
+        kbench_error_handler("OSTaskQPend failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+    }
+}
+
+static void kbench_mutex_helper(void* p_arg)
+{
+    OS_ERR err;
+
+    while (1)
+    {
+        /* Readied while the benchmark task holds the mutex */
+        (void) OSTaskSemPend((OS_TICK) 0,
+                             (OS_OPT)  OS_OPT_PEND_BLOCKING,
+                             (CPU_TS*) NULL,
+                             (OS_ERR*) &err);
+        kbench_error_handler("OSTaskSemPend failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+
+        OSMutexPend((OS_MUTEX*) &KbenchMutex,
+                    (OS_TICK)   0,
+                    (OS_OPT)    OS_OPT_PEND_BLOCKING,
+                    (CPU_TS*)   NULL,
+                    (OS_ERR*)   &err);
+        kbench_record(OS_TS_GET() - KbenchStart);
+        kbench_error_handler("OSMutexPend failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+
+        OSMutexPost((OS_MUTEX*) &KbenchMutex,
+                    (OS_OPT)    OS_OPT_POST_NONE,
+                    (OS_ERR*)   &err);
+        kbench_error_handler("OSMutexPost failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+    }
+}
+
+static void kbench_isr(void)
+{
+    OS_ERR err;
+
+    KbenchStart = OS_TS_GET();
+
+    OSSemPost((OS_SEM*) &KbenchIsrSem,
+              (OS_OPT)  OS_OPT_POST_1,
+              (OS_ERR*) &err);
+}
+
+static void kbench_isr_helper(void* p_arg)
+{
+    OS_ERR err;
+
+    while (1)
+    {
+        (void) OSSemPend((OS_SEM*) &KbenchIsrSem,
+                         (OS_TICK) 0,
+                         (OS_OPT)  OS_OPT_PEND_BLOCKING,
+                         (CPU_TS*) NULL,
+                         (OS_ERR*) &err);
+        kbench_record(OS_TS_GET() - KbenchStart);
+        kbench_error_handler("OSSemPend failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+
+        /* The benchmark task waits for the sample before triggering the next interrupt */
+        (void) OSTaskSemPost((OS_TCB*) &KbenchTaskTCB,
+                             (OS_OPT)  OS_OPT_POST_NONE,
+                             (OS_ERR*) &err);
+        kbench_error_handler("OSTaskSemPost failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+    }
+}
+
+static void kbench_switch_helper(void* p_arg)
+{
+    OS_ERR err;
+
+    while (1)
+    {
+        /* The benchmark task takes the sample once it runs again */
+        KbenchStart = OS_TS_GET();
+
+        (void) OSTaskSemPend((OS_TICK) 0,
+                             (OS_OPT)  OS_OPT_PEND_BLOCKING,
+                             (CPU_TS*) NULL,
+                             (OS_ERR*) &err);
+        kbench_error_handler("OSTaskSemPend failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+    }
+}
+
+static void kbench_timestamp(void)
+{
+    uint32_t i;
+    CPU_TS start;
+
+    for (i = 0; i < KBENCH_ITERATIONS; i++)
+    {
+        start = OS_TS_GET();
+        kbench_record(OS_TS_GET() - start);
+    }
+
+    kbench_summarize(Kbench_Timestamp);
+}
+
+static void kbench_mem(void)
+{
+    uint32_t i;
+    void* p_block;
+    CPU_TS start;
+    OS_ERR err;
+
+    for (i = 0; i < KBENCH_ITERATIONS; i++)
+    {
+        start   = OS_TS_GET();
+        p_block = OSMemGet((OS_MEM*) &KbenchMem,
+                           (OS_ERR*) &err);
+        kbench_record(OS_TS_GET() - start);
+        kbench_error_handler("OSMemGet failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+
+        OSMemPut((OS_MEM*) &KbenchMem,
+                 (void*)   p_block,
+                 (OS_ERR*) &err);
+        kbench_error_handler("OSMemPut failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+    }
+
+    kbench_summarize(Kbench_MemGet);
+
+    for (i = 0; i < KBENCH_ITERATIONS; i++)
+    {
+        p_block = OSMemGet((OS_MEM*) &KbenchMem,
+                           (OS_ERR*) &err);
+        kbench_error_handler("OSMemGet failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+
+        start = OS_TS_GET();
+        OSMemPut((OS_MEM*) &KbenchMem,
+                 (void*)   p_block,
+                 (OS_ERR*) &err);
+        kbench_record(OS_TS_GET() - start);
+        kbench_error_handler("OSMemPut failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+    }
+
+    kbench_summarize(Kbench_MemPut);
+}
+
+static void kbench_taskq(void)
+{
+    uint32_t i;
+    OS_ERR err;
+
+    kbench_helper_create(kbench_taskq_helper);
+
+    for (i = 0; i < KBENCH_ITERATIONS; i++)
+    {
+        /* The helper preempts and takes the sample before the post returns */
+        KbenchStart = OS_TS_GET();
+        OSTaskQPost((OS_TCB*)     &KbenchHelperTCB,
+                    (void*)       NULL,
+                    (OS_MSG_SIZE) 0,
+                    (OS_OPT)      OS_OPT_POST_FIFO,
+                    (OS_ERR*)     &err);
+        kbench_error_handler("OSTaskQPost failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+    }
+
+    kbench_helper_delete();
+    kbench_summarize(Kbench_TaskQ);
+}
+
+static void kbench_mutex(void)
+{
+    uint32_t i;
+    CPU_TS start;
+    OS_ERR err;
+
+    for (i = 0; i < KBENCH_ITERATIONS; i++)
+    {
+        start = OS_TS_GET();
+        OSMutexPend((OS_MUTEX*) &KbenchMutex,
+                    (OS_TICK)   0,
+                    (OS_OPT)    OS_OPT_PEND_BLOCKING,
+                    (CPU_TS*)   NULL,
+                    (OS_ERR*)   &err);
+        OSMutexPost((OS_MUTEX*) &KbenchMutex,
+                    (OS_OPT)    OS_OPT_POST_NONE,
+                    (OS_ERR*)   &err);
+        kbench_record(OS_TS_GET() - start);
+        kbench_error_handler("OSMutexPend/Post failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+    }
+
+    kbench_summarize(Kbench_MutexFree);
+
+    kbench_helper_create(kbench_mutex_helper);
+
+    for (i = 0; i < KBENCH_ITERATIONS; i++)
+    {
+        OSMutexPend((OS_MUTEX*) &KbenchMutex,
+                    (OS_TICK)   0,
+                    (OS_OPT)    OS_OPT_PEND_BLOCKING,
+                    (CPU_TS*)   NULL,
+                    (OS_ERR*)   &err);
+        kbench_error_handler("OSMutexPend failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+
+        /* The helper runs until it blocks on the mutex, raising this task to its priority */
+        (void) OSTaskSemPost((OS_TCB*) &KbenchHelperTCB,
+                             (OS_OPT)  OS_OPT_POST_NONE,
+                             (OS_ERR*) &err);
+        kbench_error_handler("OSTaskSemPost failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+
+        KbenchStart = OS_TS_GET();
+        OSMutexPost((OS_MUTEX*) &KbenchMutex,
+                    (OS_OPT)    OS_OPT_POST_NONE,
+                    (OS_ERR*)   &err);
+        kbench_error_handler("OSMutexPost failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+    }
+
+    kbench_helper_delete();
+    kbench_summarize(Kbench_MutexContended);
+}
+
+static void kbench_isr_sem(void)
+{
+    uint32_t i;
+    BSP_RESULT result;
+    OS_ERR err;
+
+    kbench_helper_create(kbench_isr_helper);
+
+    for (i = 0; i < KBENCH_ITERATIONS; i++)
+    {
+        result = BSP_SWI_Trigger(kbench_isr);
+        kbench_error_handler("BSP_SWI_Trigger failed:", (uint32_t) result, (uint32_t) BSP_SUCCESS);
+
+        (void) OSTaskSemPend((OS_TICK) KBENCH_ISR_TIMEOUT,
+                             (OS_OPT)  OS_OPT_PEND_BLOCKING,
+                             (CPU_TS*) NULL,
+                             (OS_ERR*) &err);
+        kbench_error_handler("OSTaskSemPend failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+    }
+
+    kbench_helper_delete();
+    kbench_summarize(Kbench_IsrSem);
+}
+
+static void kbench_switch(void)
+{
+    uint32_t i;
+    OS_ERR err;
+
+    kbench_helper_create(kbench_switch_helper);
+
+    for (i = 0; i < KBENCH_ITERATIONS; i++)
+    {
+        (void) OSTaskSemPost((OS_TCB*) &KbenchHelperTCB,
+                             (OS_OPT)  OS_OPT_POST_NONE,
+                             (OS_ERR*) &err);
+        kbench_record(OS_TS_GET() - KbenchStart);
+        kbench_error_handler("OSTaskSemPost failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+    }
+
+    kbench_helper_delete();
+    kbench_summarize(Kbench_Switch);
+}
+
+static void kbench_report(void)
+{
+    static const char* const names[Kbench_NumTests] = {
+        "Timestamp read:", "OSMemGet:", "OSMemPut:", "OSTaskQPost to pend:", "OSMutexPend/Post free:",
+        "OSMutexPost to waiter:", "ISR OSSemPost to task:", "Context switch:",
+    };
+
+    uint32_t i;
+    CPU_TS_TMR_FREQ freq;
+    CPU_ERR cpu_err;
+    OS_ERR err;
+    char msg[KBENCH_MSG_SIZE];
+
+    freq = CPU_TS_TmrFreqGet(&cpu_err);
+
+    logger_log_int(&KbenchTaskTCB, &err, "Timestamp Hz:", (uint32_t) freq);
+    kbench_error_handler("logger_log_int failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+
+    for (i = 0; i < (uint32_t) Kbench_NumTests; i++)
+    {
+        (void) snprintf(msg, sizeof(msg), "%s min=%lu median=%lu max=%lu", names[i],
+                        (unsigned long) KbenchResults[i].min, (unsigned long) KbenchResults[i].median,
+                        (unsigned long) KbenchResults[i].max);
+
+        logger_log(&KbenchTaskTCB, &err, msg);
+        kbench_error_handler("logger_log failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+    }
+}
+
+/* Runs the benchmarks to completion, call once from a task above OS_CFG_KBENCH_TASK_PRIO */
+void kbench_run(OS_ERR* p_err)
+{
+    OSSemCreate(&KbenchDoneSem, "Kernel Bench Done", 0, p_err);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    OSSemCreate(&KbenchIsrSem, "Kernel Bench ISR", 0, p_err);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    OSMutexCreate(&KbenchMutex, "Kernel Bench Mutex", p_err);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    OSMemCreate((OS_MEM*)     &KbenchMem,
+                (CPU_CHAR*)   "Kernel Bench Blocks",
+                (void*)       KbenchMemStorage,
+                (OS_MEM_QTY)  KBENCH_MEM_BLOCKS,
+                (OS_MEM_SIZE) KBENCH_MEM_BLOCK_SIZE,
+                (OS_ERR*)     p_err);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    OSTaskCreate((OS_TCB*)      &KbenchTaskTCB,
+                 (CPU_CHAR*)    "Kernel Bench Task",
+                 (OS_TASK_PTR)  kbench_task,
+                 (void*)        NULL,
+                 (OS_PRIO)      OS_CFG_KBENCH_TASK_PRIO,
+                 (CPU_STK*)     &KbenchTaskStack,
+                 (CPU_STK_SIZE) OS_CFG_KBENCH_TASK_STK_SIZE / 10,
+                 (CPU_STK_SIZE) OS_CFG_KBENCH_TASK_STK_SIZE,
+                 (OS_MSG_QTY)   0,
+                 (OS_TICK)      0,
+                 (void*)        0,
+                 (OS_OPT)       OS_OPT_TASK_STK_CHK | OS_OPT_TASK_STK_CLR,
+                 (OS_ERR*)      p_err);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    (void) OSSemPend((OS_SEM*) &KbenchDoneSem,
+                     (OS_TICK) 0,
+                     (OS_OPT)  OS_OPT_PEND_BLOCKING,
+                     (CPU_TS*) NULL,
+                     (OS_ERR*) p_err);
+}
+
+void kbench_task(void* p_arg)
+{
+    OS_ERR err;
+
+    kbench_timestamp();
+    kbench_mem();
+    kbench_taskq();
+    kbench_mutex();
+    kbench_isr_sem();
+    kbench_switch();
+
+    kbench_report();
+
+    OSSemPost((OS_SEM*) &KbenchDoneSem,
+              (OS_OPT)  OS_OPT_POST_1,
+              (OS_ERR*) &err);
+    kbench_error_handler("OSSemPost failed:", (uint32_t) err, (uint32_t) OS_ERR_NONE);
+
+    OSTaskDel((OS_TCB*) NULL,
+              (OS_ERR*) &err);
+}
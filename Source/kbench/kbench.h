@@ -0,0 +1,15 @@
+/**
+ * @file   kbench.h
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Kernel Primitive Benchmarks.
+ */
+
+#ifndef KBENCH_H
+#define KBENCH_H
+
+#include <os.h>
+
+void kbench_run (OS_ERR* p_err);
+void kbench_task(void* p_arg);
+
+#endif /* KBENCH_H */
@@ -0,0 +1,401 @@
+/**
+ * @file   lbench.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Logger Throughput and Latency Benchmark.
+ *
+ *         Loads the logger with synthetic producer tasks and measures what comes out on the
+ *         wire, so a logger change can be judged by numbers rather than by watching the serial
+ *         console. Producer n calls `logger_log` OS_CFG_LBENCH_RATES[n] times per second, on
+ *         absolute ticks, with a payload of OS_CFG_LBENCH_SIZES[n] characters (plus the usual
+ *         timestamp and task name prefix). Producers never wait on the logger: a message that
+ *         finds no free buffer or a full queue is dropped, like for any other task.
+ *
+ *         After OS_CFG_LBENCH_DURATION seconds the logger statistics are read and reported:
+ *
+ *             - Messages/s and bytes/s that completed on the wire during the window.
+ *             - Drop rate, the messages `logger_log` failed on over the messages attempted.
+ *             - p50/p99/max post-to-wire latency in microseconds of the messages posted during
+ *               the window, including the ones still queued when it closes, which reach the
+ *               wire while the logger drains. The max is exact, the percentiles are exact over
+ *               up to OS_CFG_LBENCH_LATENCY_SAMPLES latencies sampled uniformly from them
+ *               (reservoir sampling from `logger_set_hook`).
+ *
+ *         This is only built into the lbench.elf target (`APP_LBENCH`, `make lbench` or
+ *         `make lbench-hosted`), where the application task runs it once at startup. On the
+ *         hosted build, run with SIM_UART_PTY set so the wire is paced like USART3, on stdout
+ *         only the logger's own overhead is measured.
+ */
+
+#include "lbench.h"
+
+#include <logger_task.h>
+
+#include <os.h>
+#include <bsp.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LBENCH_MAX_SIZE      (80U)
+#define LBENCH_NAME_SIZE     (20U)
+#define LBENCH_MSG_SIZE      (96U)
+
+#define LBENCH_NUM_PRODUCERS (sizeof(LbenchRates) / sizeof(LbenchRates[0]))
+
+/* Producers sleep at most one message period, which is at most a second */
+#define LBENCH_STOP_TIMEOUT  (2U * OS_CFG_TICK_RATE_HZ)
+
+/* Ticks without a record going out after which the logger is considered drained */
+#define LBENCH_DRAIN_TICKS   (100U)
+
+static const uint32_t LbenchRates[] = OS_CFG_LBENCH_RATES;
+static const uint32_t LbenchSizes[] = OS_CFG_LBENCH_SIZES;
+
+static OS_TCB  LbenchTCB[LBENCH_NUM_PRODUCERS];
+static CPU_STK LbenchStack[LBENCH_NUM_PRODUCERS][OS_CFG_LBENCH_PRODUCER_STK_SIZE];
+static char    LbenchNames[LBENCH_NUM_PRODUCERS][LBENCH_NAME_SIZE];
+
+static OS_SEM LbenchDoneSem;
+
+static volatile bool LbenchRunning;
+static OS_TICK       LbenchStartTick;
+
+/* Written by each producer only */
+static uint32_t LbenchAttempts[LBENCH_NUM_PRODUCERS];
+static uint32_t LbenchDrops[LBENCH_NUM_PRODUCERS];
+
+/* Written by the logger task only, through the hook */
+static uint32_t LbenchLatencies[OS_CFG_LBENCH_LATENCY_SAMPLES];
+static uint32_t LbenchNumLatencies;
+static uint32_t LbenchMaxLatency;
+static uint32_t LbenchLcg;
+
+/* When the window closed, written by the benchmark task only */
+static uint64_t LbenchEndNs;
+
+static void lbench_latency_hook(uint32_t wire_latency_us)
+{
+    uint32_t i;
+    uint64_t end_ns;
+    uint64_t post_ns;
+    CPU_SR_ALLOC();
+
+    /* The benchmark task is above the logger task, so this is the only read that can tear */
+    CPU_CRITICAL_ENTER();
+    end_ns = LbenchEndNs;
+    CPU_CRITICAL_EXIT();
+
+    /* Producers post on ticks before the one that closes the window, microseconds do not matter */
+    post_ns = BSP_Timebase_GetNs() - ((uint64_t) wire_latency_us * 1000U);
+
+    if (post_ns > end_ns)
+    {
+        return;
+    }
+
+    if (wire_latency_us > LbenchMaxLatency)
+    {
+        LbenchMaxLatency = wire_latency_us;
+    }
+
+    /* Reservoir sampling, every record of the window is kept with the same probability */
+    if (LbenchNumLatencies < OS_CFG_LBENCH_LATENCY_SAMPLES)
+    {
+        LbenchLatencies[LbenchNumLatencies] = wire_latency_us;
+    }
+    else
+    {
+        LbenchLcg = (LbenchLcg * 1103515245U) + 12345U;
+        i         = (uint32_t) (((uint64_t) LbenchLcg * (LbenchNumLatencies + 1U)) >> 32);
+
+        if (i < OS_CFG_LBENCH_LATENCY_SAMPLES)
+        {
+            LbenchLatencies[i] = wire_latency_us;
+        }
+    }
+
+    LbenchNumLatencies++;
+}
+
+static int lbench_compare(const void* p_a, const void* p_b)
+{
+    uint32_t a = *(const uint32_t*) p_a;
+    uint32_t b = *(const uint32_t*) p_b;
+
+    return (a > b) - (a < b);
+}
+
+/* Nearest-rank percentile of the sorted samples */
+static uint32_t lbench_percentile(uint32_t num_samples, uint32_t percent)
+{
+    if (num_samples == 0U)
+    {
+        return 0;
+    }
+
+    return LbenchLatencies[((num_samples * percent) + 99U) / 100U - 1U];
+}
+
+static void lbench_report(OS_TCB* p_tcb, const Logger_Stats* p_stats, uint64_t window_ns, OS_ERR* p_err)
+{
+    uint32_t i;
+    uint32_t offered;
+    uint32_t attempts;
+    uint32_t drops;
+    uint32_t num_samples;
+    double window_s;
+    char msg[LBENCH_MSG_SIZE];
+
+    offered  = 0;
+    attempts = 0;
+    drops    = 0;
+
+    for (i = 0; i < LBENCH_NUM_PRODUCERS; i++)
+    {
+        offered  += LbenchRates[i];
+        attempts += LbenchAttempts[i];
+        drops    += LbenchDrops[i];
+    }
+
+    num_samples = (LbenchNumLatencies < OS_CFG_LBENCH_LATENCY_SAMPLES) ? LbenchNumLatencies : OS_CFG_LBENCH_LATENCY_SAMPLES;
+    qsort(LbenchLatencies, num_samples, sizeof(LbenchLatencies[0]), lbench_compare);
+
+    window_s = (double) window_ns / 1e9;
+
+    (void) snprintf(msg, sizeof(msg), "Logger bench: %lu producers, %lu msg/s offered, %.2f s",
+                    (unsigned long) LBENCH_NUM_PRODUCERS, (unsigned long) offered, window_s);
+    logger_log(p_tcb, p_err, msg);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    (void) snprintf(msg, sizeof(msg), "Throughput: %.1f msg/s %.0f B/s",
+                    (double) p_stats->num_records / window_s, (double) p_stats->num_bytes / window_s);
+    logger_log(p_tcb, p_err, msg);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    (void) snprintf(msg, sizeof(msg), "Drops: %lu/%lu (%.3f%%) alloc=%lu post=%lu", (unsigned long) drops,
+                    (unsigned long) attempts, (attempts > 0U) ? (100.0 * (double) drops / (double) attempts) : 0.0,
+                    (unsigned long) p_stats->num_alloc_failures, (unsigned long) p_stats->num_post_failures);
+    logger_log(p_tcb, p_err, msg);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    (void) snprintf(msg, sizeof(msg), "Wire latency us: p50=%lu p99=%lu max=%lu (%lu of %lu)",
+                    (unsigned long) lbench_percentile(num_samples, 50U),
+                    (unsigned long) lbench_percentile(num_samples, 99U),
+                    (unsigned long) LbenchMaxLatency, (unsigned long) num_samples,
+                    (unsigned long) LbenchNumLatencies);
+    logger_log(p_tcb, p_err, msg);
+}
+
+/* Waits until the logger has had nothing to transmit for LBENCH_DRAIN_TICKS */
+static void lbench_drain(OS_ERR* p_err)
+{
+    Logger_Stats stats;
+    uint32_t num_records;
+
+    logger_get_stats(&stats, p_err);
+
+    do
+    {
+        num_records = stats.num_records;
+
+        OSTimeDly((OS_TICK) LBENCH_DRAIN_TICKS,
+                  (OS_OPT)  OS_OPT_TIME_DLY,
+                  (OS_ERR*) p_err);
+
+        if (*p_err != OS_ERR_NONE)
+        {
+            return;
+        }
+
+        logger_get_stats(&stats, p_err);
+    } while (stats.num_records != num_records);
+}
+
+/* Runs the benchmark to completion and logs the results as `p_tcb`, call once from a task above the producers */
+void lbench_run(OS_TCB* p_tcb, OS_ERR* p_err)
+{
+    uint32_t i;
+    uint64_t start_ns;
+    uint64_t window_ns;
+    Logger_Stats stats;
+    OS_ERR err;
+
+    if (sizeof(LbenchSizes) != sizeof(LbenchRates))
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return;
+    }
+
+    for (i = 0; i < LBENCH_NUM_PRODUCERS; i++)
+    {
+        if ((LbenchRates[i] == 0U) || (LbenchSizes[i] > LBENCH_MAX_SIZE))
+        {
+            *p_err = OS_ERR_OPT_INVALID;
+            return;
+        }
+    }
+
+    OSSemCreate(&LbenchDoneSem, "Logger Bench Done", 0, p_err);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    /* Whatever was logged before starts the window with an empty queue */
+    lbench_drain(p_err);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    LbenchNumLatencies = 0;
+    LbenchMaxLatency   = 0;
+    LbenchLcg          = 1U;
+    LbenchEndNs        = UINT64_MAX;
+
+    logger_reset_stats(p_err);
+    logger_set_hook(lbench_latency_hook);
+
+    LbenchRunning      = true;
+    LbenchStartTick    = OSTimeGet(p_err);
+    start_ns           = BSP_Timebase_GetNs();
+
+    for (i = 0; i < LBENCH_NUM_PRODUCERS; i++)
+    {
+        (void) snprintf(LbenchNames[i], LBENCH_NAME_SIZE, "Logger Bench %lu", (unsigned long) i);
+
+        OSTaskCreate((OS_TCB*)      &LbenchTCB[i],
+                     (CPU_CHAR*)    LbenchNames[i],
+                     (OS_TASK_PTR)  lbench_producer,
+                     (void*)        (uintptr_t) i,
+                     (OS_PRIO)      OS_CFG_LBENCH_PRODUCER_PRIO,
+                     (CPU_STK*)     &LbenchStack[i][0],
+                     (CPU_STK_SIZE) OS_CFG_LBENCH_PRODUCER_STK_SIZE / 10,
+                     (CPU_STK_SIZE) OS_CFG_LBENCH_PRODUCER_STK_SIZE,
+                     (OS_MSG_QTY)   0,
+                     (OS_TICK)      0,
+                     (void*)        0,
+                     (OS_OPT)       OS_OPT_TASK_STK_CHK | OS_OPT_TASK_STK_CLR,
+                     (OS_ERR*)      p_err);
+
+        if (*p_err != OS_ERR_NONE)
+        {
+            return;
+        }
+    }
+
+    OSTimeDly((OS_TICK) (OS_CFG_LBENCH_DURATION * OS_CFG_TICK_RATE_HZ),
+              (OS_OPT)  OS_OPT_TIME_DLY,
+              (OS_ERR*) p_err);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    /* Nothing else runs between these, the caller is above the producers and the logger */
+    LbenchRunning = false;
+    LbenchEndNs   = BSP_Timebase_GetNs();
+    logger_get_stats(&stats, p_err);
+    window_ns = LbenchEndNs - start_ns;
+
+    for (i = 0; i < LBENCH_NUM_PRODUCERS; i++)
+    {
+        (void) OSSemPend((OS_SEM*) &LbenchDoneSem,
+                         (OS_TICK) LBENCH_STOP_TIMEOUT,
+                         (OS_OPT)  OS_OPT_PEND_BLOCKING,
+                         (CPU_TS*) NULL,
+                         (OS_ERR*) p_err);
+
+        if (*p_err != OS_ERR_NONE)
+        {
+            return;
+        }
+    }
+
+    /* The hook stays installed until the messages posted during the window are on the wire */
+    lbench_drain(p_err);
+    logger_set_hook(NULL);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    lbench_report(p_tcb, &stats, window_ns, p_err);
+
+    /* The application's own statistics start after the benchmark */
+    lbench_drain(&err);
+    logger_reset_stats(&err);
+}
+
+void lbench_producer(void* p_arg)
+{
+    uint32_t index;
+    uint32_t sent;
+    OS_TICK due;
+    OS_TICK now;
+    OS_ERR err;
+    char payload[LBENCH_MAX_SIZE + 1U];
+
+    index = (uint32_t) (uintptr_t) p_arg;
+    sent  = 0;
+
+    memset(payload, (int) ('a' + (index % 26U)), LbenchSizes[index]);
+    payload[LbenchSizes[index]] = '\0';
+
+    while (1)
+    {
+        /* Message n is due n / rate seconds after the start, so the rate does not drift */
+        due = LbenchStartTick + (OS_TICK) (((uint64_t) (sent + 1U) * OS_CFG_TICK_RATE_HZ) / LbenchRates[index]);
+        now = OSTimeGet(&err);
+
+        /* Unsigned subtraction handles the tick counter wrapping, a late message goes out right away */
+        if ((OS_TICK) (now - due) >= ((OS_TICK) ~0u >> 1))
+        {
+            OSTimeDly((OS_TICK) due,
+                      (OS_OPT)  OS_OPT_TIME_MATCH,
+                      (OS_ERR*) &err);
+        }
+
+        if (LbenchRunning == false)
+        {
+            break;
+        }
+
+        logger_log(&LbenchTCB[index], &err, payload);
+
+        LbenchAttempts[index]++;
+
+        if (err != OS_ERR_NONE)
+        {
+            LbenchDrops[index]++;
+        }
+
+        sent++;
+    }
+
+    OSSemPost((OS_SEM*) &LbenchDoneSem,
+              (OS_OPT)  OS_OPT_POST_1,
+              (OS_ERR*) &err);
+
+    OSTaskDel((OS_TCB*) NULL,
+              (OS_ERR*) &err);
+}
@@ -0,0 +1,15 @@
+/**
+ * @file   lbench.h
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Logger Throughput and Latency Benchmark.
+ */
+
+#ifndef LBENCH_H
+#define LBENCH_H
+
+#include <os.h>
+
+void lbench_run     (OS_TCB* p_tcb, OS_ERR* p_err);
+void lbench_producer(void* p_arg);
+
+#endif /* LBENCH_H */
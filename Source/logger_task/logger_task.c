@@ -8,6 +8,29 @@
  *         by calling the `logger_log` APIs. These APIs will send a message to
  *         the logger task containing the log message and the logger task will
  *         transmit it using bsp_uart.c.
+ *
+ *         Every record is timestamped by the kernel when it is posted to the
+ *         logger task queue (OS_CFG_TS_EN) and again when `BSP_UART_Transmit`
+ *         completes. The difference is accumulated into fixed-size latency
+ *         histograms, along with the task queue high-water mark and the
+ *         low-water mark of free log buffers, so `NUM_LOG_BUFFERS` and
+ *         `OS_CFG_LOGGER_TASK_QUEUE_SIZE` can be sized from measurements.
+ *         Benchmarks that need every latency rather than a histogram
+ *         (lbench.c) get them from `logger_set_hook`.
+ *
+ *         When OS_CFG_LOGGER_TASK_BOOST_EN is enabled, the logger task is
+ *         temporarily raised to OS_CFG_LOGGER_TASK_BOOST_PRIO once its queue
+ *         reaches the high watermark and dropped back to its normal priority
+ *         once the backlog has drained to the low watermark. This lets a
+ *         burst of producers be absorbed without exhausting the log buffers,
+ *         while keeping the logger out of the way the rest of the time.
+ *
+ *         When OS_CFG_LOGGER_TASK_CRC_BATCH_SIZE is non-zero, the logger keeps
+ *         a CRC-32 (bsp_crc.c) of every byte it transmits and, after that many
+ *         records, writes a checkpoint line with the CRC of the batch. The host
+ *         tools use it to detect bytes lost or corrupted on the serial link.
+ *         Records whose transmit failed are left out, the host may not have
+ *         seen them.
  */
 
 #include "logger_task.h"
@@ -16,8 +39,11 @@
 #include <bsp.h>
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdarg.h>
+#include <string.h>
 
 #define TIMEOUT_TICKS   (1000U)
 #define NUM_LOG_BUFFERS (16U)
@@ -30,6 +56,212 @@ static CPU_STK LoggerTaskStack[OS_CFG_LOGGER_TASK_STK_SIZE];
 static OS_MEM LogMem;
 static char   LogBuf[NUM_LOG_BUFFERS][LOG_BUF_SIZE];
 
+static Logger_Stats LoggerStats;
+static Logger_LatencyHook LoggerHook;
+
+#if (OS_CFG_LOGGER_TASK_BOOST_EN > 0u)
+static bool    LoggerBoosted;
+static OS_TICK LoggerBoostStart;
+#endif
+
+#if (OS_CFG_LOGGER_TASK_CRC_BATCH_SIZE > 0u)
+static uint32_t LoggerBatchCrc;
+static uint32_t LoggerBatchCount;
+#endif
+
+/* The nano printf library has no 64-bit integer support, so timestamps are split before formatting */
+static void logger_timestamp(uint32_t* p_sec, uint32_t* p_usec)
+{
+    uint64_t curr_time_ns;
+
+    curr_time_ns = BSP_Timebase_GetNs();
+    *p_sec       = (uint32_t) (curr_time_ns / 1000000000ULL);
+    *p_usec      = (uint32_t) ((curr_time_ns % 1000000000ULL) / 1000ULL);
+}
+
+/* Bucket 0 holds latencies below 1 us, bucket n holds [2^(n-1), 2^n) us, the last bucket is open ended */
+static uint32_t latency_bucket(uint32_t latency_us)
+{
+    uint32_t bucket;
+
+    bucket = 0;
+
+    while ((latency_us > 0U) && (bucket < (LOGGER_LATENCY_HIST_SIZE - 1U)))
+    {
+        latency_us >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+static void logger_record_latency(CPU_TS post_ts, CPU_TS dequeue_ts, CPU_TS wire_ts, OS_MSG_SIZE size)
+{
+    uint32_t queue_us;
+    uint32_t wire_us;
+    Logger_LatencyHook hook;
+    CPU_SR_ALLOC();
+
+    /* Unsigned subtraction handles a single wrap of the timestamp timer */
+    queue_us = (uint32_t) CPU_TS32_to_uSec((CPU_TS32) (dequeue_ts - post_ts));
+    wire_us  = (uint32_t) CPU_TS32_to_uSec((CPU_TS32) (wire_ts - post_ts));
+
+    CPU_CRITICAL_ENTER();
+
+    LoggerStats.num_records++;
+    LoggerStats.num_bytes += size;
+    LoggerStats.queue_latency_hist[latency_bucket(queue_us)]++;
+    LoggerStats.wire_latency_hist[latency_bucket(wire_us)]++;
+
+    if (wire_us > LoggerStats.wire_latency_max_us)
+    {
+        LoggerStats.wire_latency_max_us = wire_us;
+    }
+
+    hook = LoggerHook;
+
+    CPU_CRITICAL_EXIT();
+
+    if (hook != NULL)
+    {
+        hook(wire_us);
+    }
+}
+
+#if (OS_CFG_LOGGER_TASK_BOOST_EN > 0u)
+/* Called by producers after a successful post, raises the logger task if the backlog is too deep */
+static void logger_boost_raise(void)
+{
+    OS_ERR err;
+    OS_ERR lock_err;
+
+    /* Scheduler is locked so the watermark check and priority change are atomic with respect to other tasks */
+    OSSchedLock(&lock_err);
+
+    if (lock_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    if ((LoggerBoosted == false) &&
+        (LoggerTaskTCB.MsgQ.NbrEntries >= OS_CFG_LOGGER_TASK_BOOST_HIGH_WATERMARK))
+    {
+        OSTaskChangePrio((OS_TCB*) &LoggerTaskTCB,
+                         (OS_PRIO) OS_CFG_LOGGER_TASK_BOOST_PRIO,
+                         (OS_ERR*) &err);
+
+        if (err == OS_ERR_NONE)
+        {
+            LoggerBoosted    = true;
+            LoggerBoostStart = OSTimeGet(&err);
+            LoggerStats.num_boosts++;
+        }
+    }
+
+    /* The logger task may preempt us here if it was just boosted */
+    OSSchedUnlock(&lock_err);
+}
+
+/* Called by the logger task after each record, restores its priority once the backlog has drained */
+static void logger_boost_lower(void)
+{
+    OS_ERR err;
+    OS_ERR lock_err;
+    OS_TICK boost_ticks;
+
+    OSSchedLock(&lock_err);
+
+    if (lock_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    if ((LoggerBoosted == true) &&
+        (LoggerTaskTCB.MsgQ.NbrEntries <= OS_CFG_LOGGER_TASK_BOOST_LOW_WATERMARK))
+    {
+        OSTaskChangePrio((OS_TCB*) &LoggerTaskTCB,
+                         (OS_PRIO) OS_CFG_LOGGER_TASK_PRIO,
+                         (OS_ERR*) &err);
+
+        if (err == OS_ERR_NONE)
+        {
+            LoggerBoosted = false;
+            boost_ticks   = OSTimeGet(&err) - LoggerBoostStart;
+
+            LoggerStats.boost_ticks_total += boost_ticks;
+
+            if (boost_ticks > LoggerStats.boost_ticks_max)
+            {
+                LoggerStats.boost_ticks_max = boost_ticks;
+            }
+        }
+    }
+
+    OSSchedUnlock(&lock_err);
+}
+#endif
+
+#if (OS_CFG_LOGGER_TASK_CRC_BATCH_SIZE > 0u)
+/* Called by the logger task for every record it transmitted successfully */
+static void logger_batch_crc(const uint8_t* p_msg, OS_MSG_SIZE size)
+{
+    int n_chars;
+    uint32_t curr_time_sec;
+    uint32_t curr_time_usec;
+    char checkpoint[TMP_BUF_SIZE];
+
+    if (BSP_CRC_Accumulate(CRC_Algo_CRC32, CRC_Mode_Polled, p_msg, size, &LoggerBatchCrc) != BSP_SUCCESS)
+    {
+        (void) BSP_LED_On(LED_RED);
+    }
+
+    LoggerBatchCount++;
+
+    if (LoggerBatchCount >= OS_CFG_LOGGER_TASK_CRC_BATCH_SIZE)
+    {
+        /*
+         * Transmitted directly rather than queued, so the checkpoint always directly follows the
+         * last record of the batch and is not itself part of any batch.
+         */
+        logger_timestamp(&curr_time_sec, &curr_time_usec);
+
+        n_chars = snprintf(checkpoint, TMP_BUF_SIZE, "[%lu.%06lu][%s] CRC32: 0x%08lx (%lu records)\n",
+                           (unsigned long) curr_time_sec, (unsigned long) curr_time_usec, LoggerTaskTCB.NamePtr,
+                           (unsigned long) LoggerBatchCrc, (unsigned long) LoggerBatchCount);
+
+        if ((n_chars > 0) && (n_chars < (int) TMP_BUF_SIZE))
+        {
+            (void) BSP_UART_Transmit((uint8_t*) checkpoint, (size_t) n_chars, TIMEOUT_TICKS);
+        }
+
+        LoggerBatchCrc   = 0;
+        LoggerBatchCount = 0;
+    }
+}
+#endif
+
+static void logger_reset_stats_locked(void)
+{
+    uint32_t i;
+
+    LoggerStats.num_records         = 0;
+    LoggerStats.num_bytes           = 0;
+    LoggerStats.num_alloc_failures  = 0;
+    LoggerStats.num_post_failures   = 0;
+    LoggerStats.queue_depth_max     = 0;
+    LoggerStats.buffers_free_min    = NUM_LOG_BUFFERS;
+    LoggerStats.wire_latency_max_us = 0;
+    LoggerStats.num_boosts          = 0;
+    LoggerStats.boost_ticks_total   = 0;
+    LoggerStats.boost_ticks_max     = 0;
+
+    for (i = 0; i < LOGGER_LATENCY_HIST_SIZE; i++)
+    {
+        LoggerStats.queue_latency_hist[i] = 0;
+        LoggerStats.wire_latency_hist[i]  = 0;
+    }
+}
+
 void logger_create(OS_ERR* p_err)
 {
     OSTaskCreate((OS_TCB*)      &LoggerTaskTCB,
@@ -49,6 +281,8 @@ void logger_create(OS_ERR* p_err)
 
 void logger_init(OS_ERR* p_err)
 {
+    logger_reset_stats_locked();
+
     OSMemCreate((OS_MEM*)     &LogMem,
                 (CPU_CHAR*)   "Log Buffers",
                 (void*)       LogBuf,
@@ -65,20 +299,32 @@ void logger_task(void* p_arg)
         uint8_t* p_msg;
         BSP_RESULT result;
         OS_MSG_SIZE msg_size;
+        CPU_TS post_ts;
+        CPU_TS dequeue_ts;
 
-        /* Wait for other tasks to send messages to log */
+        /* Wait for other tasks to send messages to log, the kernel reports when it was posted */
         p_msg = (uint8_t*) OSTaskQPend((OS_TICK)      0,
                                        (OS_OPT)       OS_OPT_PEND_BLOCKING,
                                        (OS_MSG_SIZE*) &msg_size,
-                                       (CPU_TS*)      NULL,
+                                       (CPU_TS*)      &post_ts,
                                        (OS_ERR*)      &err);
 
         if (err == OS_ERR_NONE)
         {
+            dequeue_ts = OS_TS_GET();
+
             /* Log the message using the RTOS-aware UART driver */
             result = BSP_UART_Transmit(p_msg, msg_size, TIMEOUT_TICKS);
 
-            if (result != BSP_SUCCESS)
+            if (result == BSP_SUCCESS)
+            {
+                logger_record_latency(post_ts, dequeue_ts, OS_TS_GET(), msg_size);
+
+#if (OS_CFG_LOGGER_TASK_CRC_BATCH_SIZE > 0u)
+                logger_batch_crc(p_msg, msg_size);
+#endif
+            }
+            else
             {
                 /*
                  * Signal that an error occurred, but don't suspend the current
@@ -105,55 +351,112 @@ void logger_task(void* p_arg)
                 OSTaskSuspend((OS_TCB*) NULL,
                               (OS_ERR*) &err);
             }
+
+#if (OS_CFG_LOGGER_TASK_BOOST_EN > 0u)
+            logger_boost_lower();
+#endif
         }
     }
 }
 
+/* Get a log buffer from the pool, tracking the pool low-water mark and exhaustion */
+static void* logger_alloc(OS_ERR* p_err)
+{
+    void* p_buf;
+    CPU_SR_ALLOC();
+
+    p_buf = OSMemGet((OS_MEM*) &LogMem,
+                     (OS_ERR*) p_err);
+
+    CPU_CRITICAL_ENTER();
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        LoggerStats.num_alloc_failures++;
+    }
+    else if (LogMem.NbrFree < LoggerStats.buffers_free_min)
+    {
+        LoggerStats.buffers_free_min = LogMem.NbrFree;
+    }
+
+    CPU_CRITICAL_EXIT();
+
+    return p_buf;
+}
+
+/* Send a filled log buffer to the logger task, the buffer is returned to the pool on failure */
+static void logger_post(void* p_buf, OS_MSG_SIZE size, OS_ERR* p_err)
+{
+    OS_ERR ignored_error;
+    CPU_SR_ALLOC();
+
+    OSTaskQPost((OS_TCB*)     &LoggerTaskTCB,
+                (void*)       p_buf,
+                (OS_MSG_SIZE) size,
+                (OS_OPT)      OS_OPT_POST_FIFO,
+                (OS_ERR*)     p_err);
+
+    CPU_CRITICAL_ENTER();
+
+    if (*p_err == OS_ERR_NONE)
+    {
+        /* Track the high-water mark of the logger task queue */
+        if (LoggerTaskTCB.MsgQ.NbrEntries > LoggerStats.queue_depth_max)
+        {
+            LoggerStats.queue_depth_max = LoggerTaskTCB.MsgQ.NbrEntries;
+        }
+
+        CPU_CRITICAL_EXIT();
+
+#if (OS_CFG_LOGGER_TASK_BOOST_EN > 0u)
+        logger_boost_raise();
+#endif
+
+        /* Success! */
+        return;
+    }
+
+    LoggerStats.num_post_failures++;
+    CPU_CRITICAL_EXIT();
+
+    /* If a failure happens after we called OSMemGet, put the buffer back */
+    OSMemPut((OS_MEM*) &LogMem,
+             (void*)   p_buf,
+             (OS_ERR*) &ignored_error);
+}
+
 void logger_log(OS_TCB* p_tcb, OS_ERR* p_err, const char* p_msg)
 {
     void* p_buf;
     int n_chars;
-    uint32_t curr_time;
+    uint32_t curr_time_sec;
+    uint32_t curr_time_usec;
     OS_ERR ignored_error;
 
-    curr_time = (uint32_t) OSTimeGet(p_err);
+    logger_timestamp(&curr_time_sec, &curr_time_usec);
+
+    p_buf = logger_alloc(p_err);
 
     if (*p_err == OS_ERR_NONE)
     {
-        p_buf = OSMemGet((OS_MEM*) &LogMem,
-                         (OS_ERR*) p_err);
+        n_chars = snprintf(p_buf, LOG_BUF_SIZE, "[%lu.%06lu][%s] %s\n", (unsigned long) curr_time_sec,
+                           (unsigned long) curr_time_usec, p_tcb->NamePtr, p_msg);
 
-        if (*p_err == OS_ERR_NONE)
+        /*
+         * If we run out of buffer space, we will not raise an error and
+         * just log the trimmed message. More robust error handling
+         * would check that chars_written is also less than
+         * (LOG_BUF_SIZE - 1) to be certain it will fit in p_buf.
+         */
+        if (n_chars > 0)
         {
-            n_chars = snprintf(p_buf, LOG_BUF_SIZE, "[%lu][%s] %s\n", curr_time, p_tcb->NamePtr, p_msg);
-
-            /*
-             * If we run out of buffer space, we will not raise an error and
-             * just log the trimmed message. More robust error handling
-             * would check that chars_written is also less than
-             * (LOG_BUF_SIZE - 1) to be certain it will fit in p_buf.
-             */
-            if (n_chars > 0)
-            {
-                OSTaskQPost((OS_TCB*)     &LoggerTaskTCB,
-                            (void*)       p_buf,
-                            (OS_MSG_SIZE) n_chars,
-                            (OS_OPT)      OS_OPT_POST_FIFO,
-                            (OS_ERR*)     p_err);
-
-                if (*p_err == OS_ERR_NONE)
-                {
-                    /* Success! */
-                    return;
-                }
-            }
-            else
-            {
-                /* Indicate sprintf error to caller */
-                *p_err = OS_ERR_OPT_INVALID;
-            }
+            logger_post(p_buf, (OS_MSG_SIZE) n_chars, p_err);
+        }
+        else
+        {
+            /* Indicate sprintf error to caller */
+            *p_err = OS_ERR_OPT_INVALID;
 
-            /* If a failure happens after we called OSMemGet, put the buffer back */
             OSMemPut((OS_MEM*) &LogMem,
                      (void*)   p_buf,
                      (OS_ERR*) &ignored_error);
@@ -161,13 +464,71 @@ void logger_log(OS_TCB* p_tcb, OS_ERR* p_err, const char* p_msg)
     }
 }
 
+/* Log raw bytes (e.g. binary telemetry frames) without a timestamp or task name prefix */
+void logger_write(OS_ERR* p_err, const uint8_t* p_data, size_t size)
+{
+    void* p_buf;
+
+    if ((p_data == NULL) || (size == 0U) || (size > LOG_BUF_SIZE))
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return;
+    }
+
+    p_buf = logger_alloc(p_err);
+
+    if (*p_err == OS_ERR_NONE)
+    {
+        memcpy(p_buf, p_data, size);
+        logger_post(p_buf, (OS_MSG_SIZE) size, p_err);
+    }
+}
+
+void logger_get_stats(Logger_Stats* p_stats, OS_ERR* p_err)
+{
+    CPU_SR_ALLOC();
+
+    if (p_stats == NULL)
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return;
+    }
+
+    CPU_CRITICAL_ENTER();
+    *p_stats = LoggerStats;
+    CPU_CRITICAL_EXIT();
+
+    *p_err = OS_ERR_NONE;
+}
+
+void logger_reset_stats(OS_ERR* p_err)
+{
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    logger_reset_stats_locked();
+    CPU_CRITICAL_EXIT();
+
+    *p_err = OS_ERR_NONE;
+}
+
+/* Installs `hook` (NULL removes it), which runs in the logger task so it must not log */
+void logger_set_hook(Logger_LatencyHook hook)
+{
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    LoggerHook = hook;
+    CPU_CRITICAL_EXIT();
+}
+
 /* Warning: Places a fairly large buffer (TMP_BUF_SIZE) on the calling task's stack */
 void logger_log_int(OS_TCB* p_tcb, OS_ERR* p_err, const char* p_msg, uint32_t value)
 {
     int n_chars;
     char temp_buf[TMP_BUF_SIZE];
 
-    n_chars = snprintf(temp_buf, TMP_BUF_SIZE, "%s %lu", p_msg, value);
+    n_chars = snprintf(temp_buf, TMP_BUF_SIZE, "%s %lu", p_msg, (unsigned long) value);
 
     if (n_chars > 0)
     {
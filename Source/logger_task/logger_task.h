@@ -9,13 +9,40 @@
 
 #include <os.h>
 
+#include <stddef.h>
 #include <stdint.h>
 
-void logger_init     (OS_ERR* p_err);
-void logger_create   (OS_ERR* p_err);
-void logger_task     (void* p_arg);
-void logger_log      (OS_TCB* p_tcb, OS_ERR* p_err, const char* p_msg);
-void logger_log_int  (OS_TCB* p_tcb, OS_ERR* p_err, const char* p_msg, uint32_t value);
-void logger_log_float(OS_TCB* p_tcb, OS_ERR* p_err, const char* p_msg, float value);
+/* Number of power-of-two latency buckets, the last bucket collects everything >= 2^18 us */
+#define LOGGER_LATENCY_HIST_SIZE (20U)
+
+typedef struct
+{
+    uint32_t   num_records;                                  /* Records transmitted successfully       */
+    uint64_t   num_bytes;                                    /* Bytes of those records on the wire     */
+    uint32_t   num_alloc_failures;                           /* Log buffer pool exhausted              */
+    uint32_t   num_post_failures;                            /* Logger task queue full (or other)      */
+    OS_MSG_QTY queue_depth_max;                              /* High-water mark of the task queue      */
+    OS_MEM_QTY buffers_free_min;                             /* Low-water mark of free log buffers     */
+    uint32_t   wire_latency_max_us;                          /* Worst post-to-wire latency             */
+    uint32_t   num_boosts;                                   /* Times the logger priority was raised   */
+    OS_TICK    boost_ticks_total;                            /* Total ticks spent at boosted priority  */
+    OS_TICK    boost_ticks_max;                              /* Longest single boost                   */
+    uint32_t   queue_latency_hist[LOGGER_LATENCY_HIST_SIZE]; /* Post to dequeue by the logger task     */
+    uint32_t   wire_latency_hist[LOGGER_LATENCY_HIST_SIZE];  /* Post to UART transmit complete         */
+} Logger_Stats;
+
+/* Called by the logger task with the post-to-wire latency of every record transmitted */
+typedef void (*Logger_LatencyHook)(uint32_t wire_latency_us);
+
+void logger_init       (OS_ERR* p_err);
+void logger_create     (OS_ERR* p_err);
+void logger_task       (void* p_arg);
+void logger_log        (OS_TCB* p_tcb, OS_ERR* p_err, const char* p_msg);
+void logger_log_int    (OS_TCB* p_tcb, OS_ERR* p_err, const char* p_msg, uint32_t value);
+void logger_log_float  (OS_TCB* p_tcb, OS_ERR* p_err, const char* p_msg, float value);
+void logger_write      (OS_ERR* p_err, const uint8_t* p_data, size_t size);
+void logger_get_stats  (Logger_Stats* p_stats, OS_ERR* p_err);
+void logger_reset_stats(OS_ERR* p_err);
+void logger_set_hook   (Logger_LatencyHook hook);
 
 #endif /* LOGGER_TASK_H */
@@ -4,8 +4,12 @@
  * @brief  Application Entry Point.
  */
 
+#include <alarm.h>
 #include <app_task.h>
 #include <logger_task.h>
+#include <os_app_hooks.h>
+#include <snapshot.h>
+#include <timeseries.h>
 
 #include <os.h>
 
@@ -39,6 +43,9 @@ int main(void)
     OSInit(&err);
     main_error_handler(err == OS_ERR_NONE);
 
+    /* Install application hooks, the tick hook drives the BSP timebase */
+    App_OS_SetAllHooks();
+
     /*
      * Initialize other kernel objects (memory pool, queue, mutex, etc).
      * Note that only task kernel objects are initialized here, BSP kernel
@@ -47,6 +54,15 @@ int main(void)
     logger_init(&err);
     main_error_handler(err == OS_ERR_NONE);
 
+    timeseries_init(&err);
+    main_error_handler(err == OS_ERR_NONE);
+
+    snapshot_init(&err);
+    main_error_handler(err == OS_ERR_NONE);
+
+    alarm_init(&err);
+    main_error_handler(err == OS_ERR_NONE);
+
     /*
      * Recommended to only enable a single task initially and then enable
      * others tasks from it (uCOS-III The Real-Time Kernel: Page 73).
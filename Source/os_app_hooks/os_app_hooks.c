@@ -27,6 +27,7 @@
 #define   MICRIUM_SOURCE
 #include  <os.h>
 #include  "os_app_hooks.h"
+#include  <bsp.h>
 
 
 /*
@@ -125,6 +126,9 @@ void  App_OS_ClrAllHooks (void)
 
 void  App_OS_IdleTaskHook (void)
 {
+    BSP_Timebase_Idle();                                        /* Virtual time passes here in the hosted build, and    */
+                                                                /* then the call does not return                        */
+
     /* TODO: Enter low-power mode */
 }
 
@@ -258,5 +262,5 @@ void  App_OS_TaskSwHook (void)
 
 void  App_OS_TimeTickHook (void)
 {
-
+    BSP_Timebase_Tick();                                        /* Latch tick count and cycle counter for the timebase  */
 }
@@ -0,0 +1,184 @@
+/**
+ * @file   profiler.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Statistical PC-Sampling Profiler.
+ *
+ *         Shows where the CPU time goes without a debugger attached. The sampler interrupt
+ *         in bsp_sampler.c fires OS_CFG_PROFILER_RATE_HZ times per second and reports the
+ *         interrupted PC and task, and each (PC, task) pair is counted in a fixed-size open
+ *         addressing hash table of OS_CFG_PROFILER_SLOTS entries. A sample that finds no
+ *         slot within PROFILER_MAX_PROBES is counted as dropped, so the table never needs
+ *         to grow or lock.
+ *
+ *         `profiler_dump` logs the table through the logger, one line per slot between a
+ *         header and a trailer, then clears it:
+ *
+ *             PROF begin rate=<hz> samples=<n> dropped=<n> slots=<n>
+ *             PROF <pc> <count> <task name, or (interrupt)>
+ *             PROF end
+ *
+ *         Tools/profiler/profile.py turns a captured log into flat and per-task profiles by
+ *         symbolizing the PCs against build/main.elf. The sampler must be stopped before the
+ *         dump, as the table is read without any locking. Everything here is compiled out
+ *         unless OS_CFG_PROFILER_EN is set, the table alone is 12 KiB of RAM by default.
+ */
+
+#include "profiler.h"
+
+#include <logger_task.h>
+
+#include <os.h>
+#include <bsp.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#if (OS_CFG_PROFILER_EN > 0u)
+
+#if ((OS_CFG_PROFILER_SLOTS & (OS_CFG_PROFILER_SLOTS - 1u)) != 0u)
+#error "OS_CFG_PROFILER_SLOTS must be a power of two"
+#endif
+
+#define PROFILER_MAX_PROBES (8U)
+#define PROFILER_MSG_SIZE   (80U)
+
+typedef struct
+{
+    uint32_t pc;
+    OS_TCB*  p_tcb;
+    uint32_t count;
+} Profiler_Slot;
+
+/* Written by the sampler interrupt only, while it is running */
+static Profiler_Slot ProfilerSlots[OS_CFG_PROFILER_SLOTS];
+static uint32_t      ProfilerSamples;
+static uint32_t      ProfilerDropped;
+static uint32_t      ProfilerSlotsUsed;
+
+static void profiler_sample(uint32_t pc, OS_TCB* p_tcb)
+{
+    uint32_t key;
+    uint32_t i;
+    uint32_t probe;
+    Profiler_Slot* p_slot;
+
+    ProfilerSamples++;
+
+    /* Fibonacci hash, Thumb PCs are 2 byte aligned so the low bit carries nothing */
+    key = (pc >> 1) ^ (uint32_t) (uintptr_t) p_tcb;
+    i   = ((key * 2654435761U) >> 16) & (OS_CFG_PROFILER_SLOTS - 1U);
+
+    for (probe = 0; probe < PROFILER_MAX_PROBES; probe++)
+    {
+        p_slot = &ProfilerSlots[i];
+
+        if (p_slot->count == 0U)
+        {
+            p_slot->pc    = pc;
+            p_slot->p_tcb = p_tcb;
+            p_slot->count = 1;
+            ProfilerSlotsUsed++;
+            return;
+        }
+
+        if ((p_slot->pc == pc) && (p_slot->p_tcb == p_tcb))
+        {
+            p_slot->count++;
+            return;
+        }
+
+        i = (i + 1U) & (OS_CFG_PROFILER_SLOTS - 1U);
+    }
+
+    ProfilerDropped++;
+}
+
+/* Logs a line, waiting for the logger rather than dropping part of the profile */
+static void profiler_log(OS_TCB* p_tcb, OS_ERR* p_err, const char* p_msg)
+{
+    OS_ERR err;
+
+    while (1)
+    {
+        logger_log(p_tcb, p_err, p_msg);
+
+        if ((*p_err != OS_ERR_MEM_NO_FREE_BLKS) && (*p_err != OS_ERR_Q_MAX))
+        {
+            return;
+        }
+
+        OSTimeDly((OS_TICK) 1,
+                  (OS_OPT)  OS_OPT_TIME_DLY,
+                  (OS_ERR*) &err);
+
+        if (err != OS_ERR_NONE)
+        {
+            *p_err = err;
+            return;
+        }
+    }
+}
+
+void profiler_start(OS_ERR* p_err)
+{
+    if (BSP_Sampler_Start(OS_CFG_PROFILER_RATE_HZ, profiler_sample) != BSP_SUCCESS)
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return;
+    }
+
+    *p_err = OS_ERR_NONE;
+}
+
+void profiler_stop(OS_ERR* p_err)
+{
+    if (BSP_Sampler_Stop() != BSP_SUCCESS)
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return;
+    }
+
+    *p_err = OS_ERR_NONE;
+}
+
+void profiler_dump(OS_TCB* p_tcb, OS_ERR* p_err)
+{
+    uint32_t i;
+    const Profiler_Slot* p_slot;
+    char msg[PROFILER_MSG_SIZE];
+
+    snprintf(msg, sizeof(msg), "PROF begin rate=%lu samples=%lu dropped=%lu slots=%lu",
+             (unsigned long) OS_CFG_PROFILER_RATE_HZ, (unsigned long) ProfilerSamples,
+             (unsigned long) ProfilerDropped, (unsigned long) ProfilerSlotsUsed);
+    profiler_log(p_tcb, p_err, msg);
+
+    for (i = 0; (i < OS_CFG_PROFILER_SLOTS) && (*p_err == OS_ERR_NONE); i++)
+    {
+        p_slot = &ProfilerSlots[i];
+
+        if (p_slot->count == 0U)
+        {
+            continue;
+        }
+
+        snprintf(msg, sizeof(msg), "PROF 0x%08lx %lu %s", (unsigned long) p_slot->pc,
+                 (unsigned long) p_slot->count,
+                 (p_slot->p_tcb != NULL) ? (const char*) p_slot->p_tcb->NamePtr : "(interrupt)");
+        profiler_log(p_tcb, p_err, msg);
+    }
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    profiler_log(p_tcb, p_err, "PROF end");
+
+    memset(ProfilerSlots, 0, sizeof(ProfilerSlots));
+    ProfilerSamples   = 0;
+    ProfilerDropped   = 0;
+    ProfilerSlotsUsed = 0;
+}
+
+#endif
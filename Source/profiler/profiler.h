@@ -0,0 +1,16 @@
+/**
+ * @file   profiler.h
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Statistical PC-Sampling Profiler.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <os.h>
+
+void profiler_start(OS_ERR* p_err);
+void profiler_stop (OS_ERR* p_err);
+void profiler_dump (OS_TCB* p_tcb, OS_ERR* p_err);
+
+#endif /* PROFILER_H */
@@ -0,0 +1,564 @@
+/**
+ * @file   sample_block.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Compressed Columnar Sample Blocks.
+ *
+ *         Stores a run of samples column by column, so each column can be compressed
+ *         using how slowly it changes from one sample to the next:
+ *
+ *             Header (16 bytes, little-endian)
+ *                 0   1  Version (SAMPLE_BLOCK_VERSION)
+ *                 1   1  Number of channels (SAMPLE_BLOCK_NUM_CHANNELS)
+ *                 2   2  Number of samples
+ *                 4   2  Block size in bytes, including the header
+ *                 6   2  Reserved (0)
+ *                 8   8  Timestamp of the first sample (ns)
+ *
+ *             Bit stream (MSB first, padded to a whole byte)
+ *                 Timestamps: delta-of-delta of every later sample, where the
+ *                 delta before the first sample is 0:
+ *                     '0'                    dod == 0
+ *                     '10'   + 16 bits       dod fits in int16
+ *                     '110'  + 24 bits       dod fits in int24
+ *                     '1110' + 32 bits       dod fits in int32
+ *                     '1111' + 64 bits       otherwise
+ *                 Validity bitmap: one bit per sample, one channel after the other.
+ *                 Channels: the valid values of each channel, one channel after the
+ *                 other, XOR-compressed as in Facebook's Gorilla:
+ *                     32 bits                first value
+ *                     '0'                    same as previous value
+ *                     '10' + bits            XOR fits in the previous meaningful bits
+ *                     '11' + 5 bits leading zeros + 5 bits (length - 1) + bits
+ *
+ *         At a fixed sample rate the timestamps cost little more than the jitter, and the
+ *         slowly changing MS8607 values only differ in their low mantissa bits.
+ *
+ *         The APIs return 0 for any error (bad arguments, buffer too small, corrupt block)
+ *         instead of an OS_ERR, so this file has no uCOS dependency.
+ *
+ *         References:
+ *             - Pelkonen et al., "Gorilla: A Fast, Scalable, In-Memory Time Series
+ *               Database", VLDB 2015.
+ */
+
+#include "sample_block.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Worst case bits per sample: timestamp, validity, and a full XOR record per channel */
+#define WORST_TS_BITS    (4U + 64U)
+#define WORST_VALUE_BITS (2U + 5U + 5U + 32U)
+
+typedef struct
+{
+    uint8_t* p_buf;
+    size_t   size;
+    size_t   bit_pos;
+    bool     overflow;
+} Bit_Writer;
+
+typedef struct
+{
+    const uint8_t* p_buf;
+    size_t         size;
+    size_t         bit_pos;
+    bool           underflow;
+} Bit_Reader;
+
+static void put_bits(Bit_Writer* p_writer, uint64_t value, uint32_t n_bits)
+{
+    size_t byte;
+    uint32_t bit;
+
+    if ((p_writer->bit_pos + n_bits) > (p_writer->size * 8U))
+    {
+        p_writer->overflow = true;
+        return;
+    }
+
+    while (n_bits > 0U)
+    {
+        n_bits--;
+        byte = p_writer->bit_pos / 8U;
+        bit  = 7U - (uint32_t) (p_writer->bit_pos % 8U);
+
+        if (((value >> n_bits) & 1U) != 0U)
+        {
+            p_writer->p_buf[byte] |= (uint8_t) (1U << bit);
+        }
+        else
+        {
+            p_writer->p_buf[byte] &= (uint8_t) ~(1U << bit);
+        }
+
+        p_writer->bit_pos++;
+    }
+}
+
+static uint64_t get_bits(Bit_Reader* p_reader, uint32_t n_bits)
+{
+    uint64_t value;
+    size_t byte;
+    uint32_t bit;
+
+    if ((p_reader->bit_pos + n_bits) > (p_reader->size * 8U))
+    {
+        p_reader->underflow = true;
+        return 0;
+    }
+
+    value = 0;
+
+    while (n_bits > 0U)
+    {
+        n_bits--;
+        byte  = p_reader->bit_pos / 8U;
+        bit   = 7U - (uint32_t) (p_reader->bit_pos % 8U);
+        value = (value << 1) | ((p_reader->p_buf[byte] >> bit) & 1U);
+        p_reader->bit_pos++;
+    }
+
+    return value;
+}
+
+static int64_t sign_extend(uint64_t value, uint32_t n_bits)
+{
+    uint64_t sign;
+
+    if (n_bits >= 64U)
+    {
+        return (int64_t) value;
+    }
+
+    sign = 1ULL << (n_bits - 1U);
+
+    return (int64_t) ((value ^ sign) - sign);
+}
+
+static bool fits_signed(int64_t value, uint32_t n_bits)
+{
+    int64_t limit;
+
+    limit = (int64_t) 1 << (n_bits - 1U);
+
+    return (value >= -limit) && (value < limit);
+}
+
+static void put_le16(uint8_t* p_buf, uint16_t value)
+{
+    p_buf[0] = (uint8_t) (value);
+    p_buf[1] = (uint8_t) (value >> 8);
+}
+
+static uint16_t get_le16(const uint8_t* p_buf)
+{
+    return (uint16_t) (p_buf[0] | (p_buf[1] << 8));
+}
+
+static void put_le64(uint8_t* p_buf, uint64_t value)
+{
+    uint32_t i;
+
+    for (i = 0; i < 8U; i++)
+    {
+        p_buf[i] = (uint8_t) (value >> (8U * i));
+    }
+}
+
+static uint64_t get_le64(const uint8_t* p_buf)
+{
+    uint32_t i;
+    uint64_t value;
+
+    value = 0;
+
+    for (i = 0; i < 8U; i++)
+    {
+        value |= (uint64_t) p_buf[i] << (8U * i);
+    }
+
+    return value;
+}
+
+static uint32_t float_bits(float value)
+{
+    uint32_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+
+    return bits;
+}
+
+static float bits_float(uint32_t bits)
+{
+    float value;
+
+    memcpy(&value, &bits, sizeof(value));
+
+    return value;
+}
+
+static void encode_timestamps(Bit_Writer* p_writer, Sample_Block_Getter get, void* p_ctx, uint32_t num_samples)
+{
+    uint32_t i;
+    uint64_t prev_ts;
+    int64_t prev_delta;
+    int64_t delta;
+    int64_t dod;
+
+    prev_ts    = get(p_ctx, 0)->timestamp_ns;
+    prev_delta = 0;
+
+    for (i = 1; i < num_samples; i++)
+    {
+        delta = (int64_t) (get(p_ctx, i)->timestamp_ns - prev_ts);
+        dod   = delta - prev_delta;
+
+        if (dod == 0)
+        {
+            put_bits(p_writer, 0x0U, 1);
+        }
+        else if (fits_signed(dod, 16))
+        {
+            put_bits(p_writer, 0x2U, 2);
+            put_bits(p_writer, (uint64_t) dod & 0xFFFFU, 16);
+        }
+        else if (fits_signed(dod, 24))
+        {
+            put_bits(p_writer, 0x6U, 3);
+            put_bits(p_writer, (uint64_t) dod & 0xFFFFFFU, 24);
+        }
+        else if (fits_signed(dod, 32))
+        {
+            put_bits(p_writer, 0xEU, 4);
+            put_bits(p_writer, (uint64_t) dod & 0xFFFFFFFFU, 32);
+        }
+        else
+        {
+            put_bits(p_writer, 0xFU, 4);
+            put_bits(p_writer, (uint64_t) dod, 64);
+        }
+
+        prev_ts    = get(p_ctx, i)->timestamp_ns;
+        prev_delta = delta;
+    }
+}
+
+static void encode_channel(Bit_Writer* p_writer, Sample_Block_Getter get, void* p_ctx, uint32_t num_samples,
+                           uint32_t channel)
+{
+    uint32_t i;
+    uint32_t bits;
+    uint32_t prev;
+    uint32_t diff;
+    uint32_t leading;
+    uint32_t trailing;
+    uint32_t prev_leading;
+    uint32_t prev_trailing;
+    bool first;
+    const Sample_Record* p_rec;
+
+    first         = true;
+    prev          = 0;
+    prev_leading  = 32;
+    prev_trailing = 0;
+
+    for (i = 0; i < num_samples; i++)
+    {
+        p_rec = get(p_ctx, i);
+
+        if ((p_rec->valid_mask & (1U << channel)) == 0U)
+        {
+            continue;
+        }
+
+        bits = float_bits(p_rec->value[channel]);
+
+        if (first == true)
+        {
+            put_bits(p_writer, bits, 32);
+            first = false;
+            prev  = bits;
+            continue;
+        }
+
+        diff  = bits ^ prev;
+        prev = bits;
+
+        if (diff == 0U)
+        {
+            put_bits(p_writer, 0x0U, 1);
+            continue;
+        }
+
+        leading  = (uint32_t) __builtin_clz(diff);
+        trailing = (uint32_t) __builtin_ctz(diff);
+
+        if ((prev_leading < 32U) && (leading >= prev_leading) && (trailing >= prev_trailing))
+        {
+            /* Meaningful bits fit in the previous window, reuse it */
+            put_bits(p_writer, 0x2U, 2);
+            put_bits(p_writer, diff >> prev_trailing, 32U - prev_leading - prev_trailing);
+        }
+        else
+        {
+            put_bits(p_writer, 0x3U, 2);
+            put_bits(p_writer, leading, 5);
+            put_bits(p_writer, 32U - leading - trailing - 1U, 5);
+            put_bits(p_writer, diff >> trailing, 32U - leading - trailing);
+
+            prev_leading  = leading;
+            prev_trailing = trailing;
+        }
+    }
+}
+
+static void decode_channel(Bit_Reader* p_reader, Sample_Record* p_out, uint32_t num_samples, uint32_t channel)
+{
+    uint32_t i;
+    uint32_t prev;
+    uint32_t length;
+    uint32_t prev_leading;
+    uint32_t prev_trailing;
+    bool first;
+
+    first         = true;
+    prev          = 0;
+    prev_leading  = 32;
+    prev_trailing = 0;
+
+    for (i = 0; (i < num_samples) && (p_reader->underflow == false); i++)
+    {
+        if ((p_out[i].valid_mask & (1U << channel)) == 0U)
+        {
+            p_out[i].value[channel] = 0.0f;
+            continue;
+        }
+
+        if (first == true)
+        {
+            prev  = (uint32_t) get_bits(p_reader, 32);
+            first = false;
+        }
+        else if (get_bits(p_reader, 1) != 0U)
+        {
+            if (get_bits(p_reader, 1) != 0U)
+            {
+                prev_leading  = (uint32_t) get_bits(p_reader, 5);
+                length        = (uint32_t) get_bits(p_reader, 5) + 1U;
+
+                /* A corrupt block could claim more than 32 bits */
+                if ((prev_leading + length) > 32U)
+                {
+                    p_reader->underflow = true;
+                    return;
+                }
+
+                prev_trailing = 32U - prev_leading - length;
+            }
+            else if (prev_leading >= 32U)
+            {
+                /* Window reused before one was set */
+                p_reader->underflow = true;
+                return;
+            }
+
+            prev ^= (uint32_t) get_bits(p_reader, 32U - prev_leading - prev_trailing) << prev_trailing;
+        }
+
+        p_out[i].value[channel] = bits_float(prev);
+    }
+}
+
+size_t sample_block_max_size(uint32_t num_samples)
+{
+    uint64_t bits;
+
+    bits = (uint64_t) num_samples * (WORST_TS_BITS + SAMPLE_BLOCK_NUM_CHANNELS * (1U + WORST_VALUE_BITS));
+
+    return SAMPLE_BLOCK_HEADER_SIZE + (size_t) ((bits + 7U) / 8U);
+}
+
+/* Returns the size of the block written to `p_block`, or 0 on error */
+size_t sample_block_encode(Sample_Block_Getter get, void* p_ctx, uint32_t num_samples,
+                           uint8_t* p_block, size_t block_size)
+{
+    uint32_t i;
+    uint32_t channel;
+    size_t total;
+    Bit_Writer writer;
+
+    if ((get == NULL) || (p_block == NULL) || (num_samples == 0U) || (num_samples > 0xFFFFU) ||
+        (block_size < SAMPLE_BLOCK_HEADER_SIZE))
+    {
+        return 0;
+    }
+
+    writer.p_buf    = &p_block[SAMPLE_BLOCK_HEADER_SIZE];
+    writer.size     = block_size - SAMPLE_BLOCK_HEADER_SIZE;
+    writer.bit_pos  = 0;
+    writer.overflow = false;
+
+    encode_timestamps(&writer, get, p_ctx, num_samples);
+
+    for (channel = 0; channel < SAMPLE_BLOCK_NUM_CHANNELS; channel++)
+    {
+        for (i = 0; i < num_samples; i++)
+        {
+            put_bits(&writer, (get(p_ctx, i)->valid_mask >> channel) & 1U, 1);
+        }
+    }
+
+    for (channel = 0; channel < SAMPLE_BLOCK_NUM_CHANNELS; channel++)
+    {
+        encode_channel(&writer, get, p_ctx, num_samples, channel);
+    }
+
+    /* Zero the padding bits of the last byte */
+    if ((writer.bit_pos % 8U) != 0U)
+    {
+        put_bits(&writer, 0, 8U - (uint32_t) (writer.bit_pos % 8U));
+    }
+
+    total = SAMPLE_BLOCK_HEADER_SIZE + (writer.bit_pos / 8U);
+
+    if ((writer.overflow == true) || (total > SAMPLE_BLOCK_MAX_SIZE))
+    {
+        return 0;
+    }
+
+    p_block[0] = SAMPLE_BLOCK_VERSION;
+    p_block[1] = SAMPLE_BLOCK_NUM_CHANNELS;
+    put_le16(&p_block[2], (uint16_t) num_samples);
+    put_le16(&p_block[4], (uint16_t) total);
+    put_le16(&p_block[6], 0);
+    put_le64(&p_block[8], get(p_ctx, 0)->timestamp_ns);
+
+    return total;
+}
+
+/* Returns the number of samples decoded into `p_out`, or 0 on error */
+uint32_t sample_block_decode(const uint8_t* p_block, size_t block_size, Sample_Record* p_out,
+                             uint32_t max_out)
+{
+    uint32_t i;
+    uint32_t channel;
+    uint32_t num_samples;
+    uint32_t tag;
+    size_t total;
+    int64_t delta;
+    int64_t dod;
+    Bit_Reader reader;
+
+    total = sample_block_size(p_block, block_size);
+
+    if ((total == 0U) || (p_out == NULL))
+    {
+        return 0;
+    }
+
+    num_samples = get_le16(&p_block[2]);
+
+    if ((num_samples == 0U) || (num_samples > max_out))
+    {
+        return 0;
+    }
+
+    reader.p_buf     = &p_block[SAMPLE_BLOCK_HEADER_SIZE];
+    reader.size      = total - SAMPLE_BLOCK_HEADER_SIZE;
+    reader.bit_pos   = 0;
+    reader.underflow = false;
+
+    p_out[0].timestamp_ns = get_le64(&p_block[8]);
+    delta                 = 0;
+
+    for (i = 1; i < num_samples; i++)
+    {
+        /* Count leading ones of the tag, up to four */
+        tag = 0;
+
+        while ((tag < 4U) && (get_bits(&reader, 1) != 0U))
+        {
+            tag++;
+        }
+
+        switch (tag)
+        {
+        case 0:
+            dod = 0;
+            break;
+
+        case 1:
+            dod = sign_extend(get_bits(&reader, 16), 16);
+            break;
+
+        case 2:
+            dod = sign_extend(get_bits(&reader, 24), 24);
+            break;
+
+        case 3:
+            dod = sign_extend(get_bits(&reader, 32), 32);
+            break;
+
+        default:
+            dod = (int64_t) get_bits(&reader, 64);
+            break;
+        }
+
+        delta                += dod;
+        p_out[i].timestamp_ns = p_out[i - 1U].timestamp_ns + (uint64_t) delta;
+    }
+
+    for (i = 0; i < num_samples; i++)
+    {
+        p_out[i].valid_mask = 0;
+    }
+
+    for (channel = 0; channel < SAMPLE_BLOCK_NUM_CHANNELS; channel++)
+    {
+        for (i = 0; i < num_samples; i++)
+        {
+            p_out[i].valid_mask |= (uint8_t) (get_bits(&reader, 1) << channel);
+        }
+    }
+
+    for (channel = 0; channel < SAMPLE_BLOCK_NUM_CHANNELS; channel++)
+    {
+        decode_channel(&reader, p_out, num_samples, channel);
+    }
+
+    if (reader.underflow == true)
+    {
+        return 0;
+    }
+
+    return num_samples;
+}
+
+/* Size of the block starting at `p_block` from its header, or 0 if it is not a valid block */
+size_t sample_block_size(const uint8_t* p_block, size_t available)
+{
+    size_t total;
+
+    if ((p_block == NULL) || (available < SAMPLE_BLOCK_HEADER_SIZE))
+    {
+        return 0;
+    }
+
+    if ((p_block[0] != SAMPLE_BLOCK_VERSION) || (p_block[1] != SAMPLE_BLOCK_NUM_CHANNELS))
+    {
+        return 0;
+    }
+
+    total = get_le16(&p_block[4]);
+
+    if ((total < SAMPLE_BLOCK_HEADER_SIZE) || (total > available))
+    {
+        return 0;
+    }
+
+    return total;
+}
@@ -0,0 +1,40 @@
+/**
+ * @file   sample_block.h
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Compressed Columnar Sample Blocks.
+ *
+ *         Only depends on the C standard library, so the same code is built into the
+ *         application and into the host tool in Tools/sample_block.
+ */
+
+#ifndef SAMPLE_BLOCK_H
+#define SAMPLE_BLOCK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SAMPLE_BLOCK_VERSION      (1U)
+#define SAMPLE_BLOCK_NUM_CHANNELS (3U)
+#define SAMPLE_BLOCK_HEADER_SIZE  (16U)
+
+/* Blocks record their size in 16 bits */
+#define SAMPLE_BLOCK_MAX_SIZE     (0xFFFFU)
+
+typedef struct
+{
+    uint64_t timestamp_ns;                     /* Must not decrease within a block      */
+    float    value[SAMPLE_BLOCK_NUM_CHANNELS]; /* Only valid values are stored          */
+    uint8_t  valid_mask;                       /* Bit n set if value[n] is valid        */
+} Sample_Record;
+
+/* Returns record `index` (0 is the oldest) of the caller's storage, which need not be contiguous */
+typedef const Sample_Record* (*Sample_Block_Getter)(void* p_ctx, uint32_t index);
+
+size_t   sample_block_max_size(uint32_t num_samples);
+size_t   sample_block_encode  (Sample_Block_Getter get, void* p_ctx, uint32_t num_samples,
+                               uint8_t* p_block, size_t block_size);
+uint32_t sample_block_decode  (const uint8_t* p_block, size_t block_size, Sample_Record* p_out,
+                               uint32_t max_out);
+size_t   sample_block_size    (const uint8_t* p_block, size_t available);
+
+#endif /* SAMPLE_BLOCK_H */
@@ -2,20 +2,97 @@
  * @file   sensor_task.c
  * @author Ben Brown <ben@beninter.net>
  * @brief  Sensor Task.
+ *
+ *         With OS_CFG_SENSOR_TASK_PERIODIC_EN the task is released on absolute tick
+ *         counts (`OS_OPT_TIME_MATCH`), one polling interval apart, instead of delaying
+ *         for a polling interval after each read. The read and reporting time then no
+ *         longer adds to the period, so samples stay on a fixed rate.
+ *
+ *         Each release records its jitter: how late the task actually started compared
+ *         to the ideal release time, measured with `BSP_Timebase_GetNs` against the first
+ *         release. In the relative delay mode the same schedule is used, so the jitter
+ *         grows with the drift. If a cycle overruns its period, the releases it overlapped are skipped
+ *         (keeping the original phase) and counted as missed deadlines.
+ *
+ *         A failed read (after the retries and bus recovery in i2c.c) loses only that sample: it
+ *         continues as a reading with no valid channels, which the later stages skip or report
+ *         as empty. Only OS_CFG_SENSOR_TASK_MAX_READ_FAILURES failures in a row stop the task.
+ *
+ *         With OS_CFG_ALARM_EN set, threshold alarms (alarm.c) are evaluated on every reading
+ *         right after the read, before anything else, and drive their outputs directly.
+ *
+ *         With OS_CFG_SENSOR_TASK_FILTER set, every reading is filtered per channel (filter.c)
+ *         after it is stored in the time-series store and before anything else uses it.
+ *
+ *         Every (filtered) reading is then published as the sensor's latest sample (snapshot.c),
+ *         where other tasks can read it or be woken by it without touching the sensor.
+ *
+ *         The sensor resolution (OS_CFG_SENSOR_TASK_OSR and OS_CFG_SENSOR_TASK_RH_RESOLUTION)
+ *         is applied after the reset, and the resulting conversion time of one read is logged.
+ *         The bus speed (OS_CFG_SENSOR_TASK_BUS_SPEED) is set before it, so the reset and the
+ *         calibration read already run at that speed.
+ *
+ *         Each channel is read every OS_CFG_SENSOR_TASK_<CHANNEL>_DIVIDER polling intervals, and
+ *         only the channels due in a slot are converted (`BSP_Sensor_ReadChannels`). The others
+ *         are not valid in that reading, which every later stage already handles. For example,
+ *         with a 100 ms interval, dividers of 1 (pressure), 10 (temperature), and 100 (humidity)
+ *         read pressure at 10 Hz and humidity at 0.1 Hz, and most slots skip the humidity
+ *         conversion, which is the slowest one. The polling interval is the period of the fastest
+ *         channel, so at least one divider must be 1. Slots are numbered by release, not by read,
+ *         so releases skipped after an overrun keep every channel on its phase.
+ *
+ *         With OS_CFG_SENSOR_TASK_AGGREGATE_WINDOW set, readings are summarized (aggregate.c)
+ *         and only one summary per window is reported, so the sample rate can be raised
+ *         without raising the UART bandwidth.
+ *
+ *         Otherwise, with OS_CFG_SENSOR_TASK_DEADBAND_EN only the channels that moved past their
+ *         deadband (or have not been reported for a while) are reported (deadband.c), and a
+ *         reading where nothing changed is not reported at all.
+ *
+ *         With OS_CFG_SENSOR_TASK_ADAPTIVE_EN the polling interval follows the readings: it is
+ *         halved whenever a channel moves past its deadband between two reads and stretched by
+ *         a quarter while they are stable, within the configured min and max. A fast change is
+ *         tracked within a few reads, while a stable sensor is polled (and woken) less often.
  */
 
 #include "sensor_task.h"
 
+#include <aggregate.h>
+#include <alarm.h>
+#include <deadband.h>
+#include <filter.h>
 #include <logger_task.h>
+#include <snapshot.h>
+#include <telemetry.h>
+#include <timeseries.h>
 
 #include <os.h>
 #include <bsp.h>
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdbool.h>
 
-static OS_TCB  SensorTaskTCB;
-static CPU_STK SensorTaskStack[OS_CFG_SENSOR_TASK_STK_SIZE];
+#if (OS_CFG_SENSOR_TASK_TEMPERATURE_DIVIDER == 0u) || (OS_CFG_SENSOR_TASK_HUMIDITY_DIVIDER == 0u) || \
+    (OS_CFG_SENSOR_TASK_PRESSURE_DIVIDER == 0u)
+#error "OS_CFG_SENSOR_TASK_*_DIVIDER must be at least 1"
+#endif
+
+#if (OS_CFG_SENSOR_TASK_TEMPERATURE_DIVIDER != 1u) && (OS_CFG_SENSOR_TASK_HUMIDITY_DIVIDER != 1u) && \
+    (OS_CFG_SENSOR_TASK_PRESSURE_DIVIDER != 1u)
+#error "At least one OS_CFG_SENSOR_TASK_*_DIVIDER must be 1, or some slots would read nothing"
+#endif
+
+#define NS_PER_TICK      (1000000000ULL / OS_CFG_TICK_RATE_HZ)
+#define SUMMARY_MSG_SIZE (96U)
+
+/* Configured deadbands are in 0.01 units, like the telemetry frame fields */
+#define DEADBAND_SCALE   (0.01f)
+
+static OS_TCB       SensorTaskTCB;
+static CPU_STK      SensorTaskStack[OS_CFG_SENSOR_TASK_STK_SIZE];
+static Sensor_Stats SensorStats;
 
 static void sensor_error_handler(const char* msg)
 {
@@ -33,6 +110,294 @@ static void sensor_error_handler(const char* msg)
                   (OS_ERR*) &err);
 }
 
+static uint32_t jitter_bucket(uint32_t jitter_us)
+{
+    uint32_t bucket;
+
+    bucket = 0;
+
+    while ((jitter_us > 0U) && (bucket < (SENSOR_JITTER_HIST_SIZE - 1U)))
+    {
+        jitter_us >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+static void sensor_record_release(uint64_t release_ns, uint64_t ideal_ns, uint32_t missed, OS_TICK interval)
+{
+    uint32_t jitter_us;
+    CPU_SR_ALLOC();
+
+    /* Never early on target, but the first release is only the reference point */
+    jitter_us = (release_ns > ideal_ns) ? (uint32_t) ((release_ns - ideal_ns) / 1000ULL) : 0U;
+
+    CPU_CRITICAL_ENTER();
+
+    SensorStats.num_samples++;
+    SensorStats.num_missed_deadlines += missed;
+    SensorStats.poll_interval         = (uint32_t) interval;
+    SensorStats.jitter_hist[jitter_bucket(jitter_us)]++;
+
+    if (jitter_us > SensorStats.jitter_max_us)
+    {
+        SensorStats.jitter_max_us = jitter_us;
+    }
+
+    CPU_CRITICAL_EXIT();
+}
+
+#if (OS_CFG_ALARM_EN > 0u)
+/* The outputs are already driven, this is only the record of it and may wait behind other log lines */
+static void sensor_report_alarm(void)
+{
+    OS_ERR err;
+    Alarm_Stats stats;
+
+    alarm_get_stats(&stats, &err);
+
+    logger_log_int(&SensorTaskTCB, &err, "Active Alarms =", (uint32_t) alarm_get_active());
+    logger_log_int(&SensorTaskTCB, &err, "Alarm Latency (ns) =", stats.latency_last_ns);
+    logger_log_int(&SensorTaskTCB, &err, "Alarm Sample Latency (ns) =", stats.sample_latency_last_ns);
+}
+#endif
+
+/* Channels due in a slot, every channel is due in the first one */
+static uint8_t sensor_channels_due(uint32_t slot)
+{
+    uint8_t channels;
+
+    channels = 0;
+
+    if ((slot % OS_CFG_SENSOR_TASK_TEMPERATURE_DIVIDER) == 0U)
+    {
+        channels |= SENSOR_CHANNEL_TEMPERATURE;
+    }
+
+    if ((slot % OS_CFG_SENSOR_TASK_HUMIDITY_DIVIDER) == 0U)
+    {
+        channels |= SENSOR_CHANNEL_HUMIDITY;
+    }
+
+    if ((slot % OS_CFG_SENSOR_TASK_PRESSURE_DIVIDER) == 0U)
+    {
+        channels |= SENSOR_CHANNEL_PRESSURE;
+    }
+
+    return channels;
+}
+
+static void sensor_record_failure(void)
+{
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    SensorStats.num_read_failures++;
+    CPU_CRITICAL_EXIT();
+}
+
+#if (OS_CFG_SENSOR_TASK_PERIODIC_EN > 0u)
+/* Advance to the next release that is still in the future and wait for it, returns the number of releases skipped */
+static uint32_t sensor_wait_release(OS_TICK* p_release, OS_TICK interval, OS_ERR* p_err)
+{
+    OS_TICK now;
+    uint32_t missed;
+
+    missed      = 0;
+    *p_release += interval;
+
+    now = OSTimeGet(p_err);
+
+    /* Unsigned subtraction handles the tick counter wrapping, a release due now is not missed */
+    while (((OS_TICK) (now - *p_release) != 0U) && ((OS_TICK) (now - *p_release) < ((OS_TICK) ~0u >> 1)))
+    {
+        *p_release += interval;
+        missed++;
+    }
+
+    OSTimeDly((OS_TICK) *p_release,
+              (OS_OPT)  OS_OPT_TIME_MATCH,
+              (OS_ERR*) p_err);
+
+    /* A tick arrived between reading the time and the delay, the release is now, not missed */
+    if (*p_err == OS_ERR_TIME_ZERO_DLY)
+    {
+        *p_err = OS_ERR_NONE;
+    }
+
+    return missed;
+}
+#endif
+
+#if (OS_CFG_SENSOR_TASK_ADAPTIVE_EN > 0u)
+static OS_TICK sensor_adapt_interval(OS_TICK interval, bool changed)
+{
+    if (changed == true)
+    {
+        interval /= 2U;
+    }
+    else
+    {
+        interval += (interval / 4U) + 1U;
+    }
+
+    if (interval < OS_CFG_SENSOR_TASK_POLLING_INTERVAL_MIN)
+    {
+        interval = OS_CFG_SENSOR_TASK_POLLING_INTERVAL_MIN;
+    }
+
+    if (interval > OS_CFG_SENSOR_TASK_POLLING_INTERVAL_MAX)
+    {
+        interval = OS_CFG_SENSOR_TASK_POLLING_INTERVAL_MAX;
+    }
+
+    return interval;
+}
+
+/* Keep the last valid value of each channel, so channels read at different rates are still compared */
+static void sensor_merge(Sensor_Data* p_last, const Sensor_Data* p_data)
+{
+    if (p_data->temperature_is_valid == true)
+    {
+        p_last->temperature          = p_data->temperature;
+        p_last->temperature_is_valid = true;
+    }
+
+    if (p_data->humidity_is_valid == true)
+    {
+        p_last->humidity          = p_data->humidity;
+        p_last->humidity_is_valid = true;
+    }
+
+    if (p_data->pressure_is_valid == true)
+    {
+        p_last->pressure          = p_data->pressure;
+        p_last->pressure_is_valid = true;
+    }
+}
+#endif
+
+#if (OS_CFG_SENSOR_TASK_TELEMETRY_EN > 0u)
+/* One binary frame per reading, the sequence number lets the host detect dropped frames */
+static void sensor_report_telemetry(Sensor_TypeDef sensor, const Sensor_Data* p_data, uint32_t iterations)
+{
+    OS_ERR err;
+    size_t frame_size;
+    uint8_t frame[TELEMETRY_FRAME_MAX_SIZE];
+
+    frame_size = telemetry_encode_sample(frame, sizeof(frame), (uint16_t) iterations, sensor, p_data, &err);
+
+    if (err == OS_ERR_NONE)
+    {
+        logger_write(&err, frame, frame_size);
+    }
+
+    if (err != OS_ERR_NONE)
+    {
+        sensor_error_handler("Failed to send telemetry");
+    }
+}
+#else
+/* One text line per value */
+static void sensor_report_text(const Sensor_Data* p_data, uint32_t iterations)
+{
+    OS_ERR err;
+
+    if (p_data->temperature_is_valid == true)
+    {
+        logger_log_float(&SensorTaskTCB, &err, "Temperature:", p_data->temperature);
+
+        if (err != OS_ERR_NONE)
+        {
+            sensor_error_handler("Failed to log temperature");
+        }
+    }
+
+    if (p_data->humidity_is_valid == true)
+    {
+        logger_log_float(&SensorTaskTCB, &err, "Humidity:", p_data->humidity);
+
+        if (err != OS_ERR_NONE)
+        {
+            sensor_error_handler("Failed to log humidity");
+        }
+    }
+
+    if (p_data->pressure_is_valid == true)
+    {
+        logger_log_float(&SensorTaskTCB, &err, "Pressure:", p_data->pressure);
+
+        if (err != OS_ERR_NONE)
+        {
+            sensor_error_handler("Failed to log pressure");
+        }
+    }
+
+    logger_log_int(&SensorTaskTCB, &err, "Number of Sensor Readings =", iterations);
+}
+#endif
+
+#if (OS_CFG_SENSOR_TASK_AGGREGATE_WINDOW > 0u)
+#if (OS_CFG_SENSOR_TASK_TELEMETRY_EN > 0u)
+/* One binary frame per window */
+static void sensor_report_summary(Sensor_TypeDef sensor, const Aggregate_Window* p_window, uint32_t windows)
+{
+    OS_ERR err;
+    size_t frame_size;
+    uint8_t frame[TELEMETRY_FRAME_MAX_SIZE];
+
+    frame_size = telemetry_encode_summary(frame, sizeof(frame), (uint16_t) windows, sensor, p_window, &err);
+
+    if (err == OS_ERR_NONE)
+    {
+        logger_write(&err, frame, frame_size);
+    }
+
+    if (err != OS_ERR_NONE)
+    {
+        sensor_error_handler("Failed to send telemetry");
+    }
+}
+#else
+static void sensor_log_stats(const char* p_name, const Aggregate_Stats* p_stats)
+{
+    OS_ERR err;
+    char msg[SUMMARY_MSG_SIZE];
+
+    if (p_stats->count == 0U)
+    {
+        return;
+    }
+
+    (void) snprintf(msg, sizeof(msg), "%s n=%lu mean=%.3f var=%.6f min=%.3f max=%.3f", p_name,
+                    (unsigned long) p_stats->count, (double) p_stats->mean, (double) aggregate_variance(p_stats),
+                    (double) p_stats->min, (double) p_stats->max);
+
+    logger_log(&SensorTaskTCB, &err, msg);
+
+    if (err != OS_ERR_NONE)
+    {
+        sensor_error_handler("Failed to log summary");
+    }
+}
+
+/* One text line per channel per window */
+static void sensor_report_summary(Sensor_TypeDef sensor, const Aggregate_Window* p_window, uint32_t windows)
+{
+    OS_ERR err;
+
+    (void) sensor;
+
+    sensor_log_stats("Temperature:", &p_window->temperature);
+    sensor_log_stats("Humidity:", &p_window->humidity);
+    sensor_log_stats("Pressure:", &p_window->pressure);
+
+    logger_log_int(&SensorTaskTCB, &err, "Number of Sensor Summaries =", windows);
+}
+#endif
+#endif
+
 void sensor_create(OS_ERR* p_err)
 {
     OSTaskCreate((OS_TCB*)      &SensorTaskTCB,
@@ -55,7 +420,34 @@ void sensor_task(void* p_arg)
     OS_ERR err;
     Sensor_Data data;
     uint32_t iterations;
+    uint32_t slot;
+    uint32_t missed;
+    uint32_t failures;
     Sensor_TypeDef curr_sensor;
+    OS_TICK first_release;
+    OS_TICK release;
+    OS_TICK interval;
+    uint64_t first_release_ns;
+#if (OS_CFG_SENSOR_TASK_FILTER > 0u)
+    Filter_Bank filter;
+#endif
+#if (OS_CFG_SENSOR_TASK_DEADBAND_EN > 0u) || (OS_CFG_SENSOR_TASK_ADAPTIVE_EN > 0u)
+    Deadband_Filter deadband;
+#endif
+#if (OS_CFG_SENSOR_TASK_ADAPTIVE_EN > 0u)
+    Sensor_Data prev;
+#endif
+#if (OS_CFG_SENSOR_TASK_AGGREGATE_WINDOW == 0u)
+    Sensor_Data report;
+    uint32_t reports;
+#endif
+#if (OS_CFG_SENSOR_TASK_AGGREGATE_WINDOW > 0u)
+    Aggregate_Window window;
+    uint32_t windows;
+#endif
+    Sensor_Resolution resolution;
+    uint32_t latency_us;
+    CPU_SR_ALLOC();
 
     /*
      * NOTE:
@@ -70,67 +462,238 @@ void sensor_task(void* p_arg)
 
     /* Initialize locals */
     iterations = 0;
+    slot       = 0;
+    failures   = 0;
+    interval   = OS_CFG_SENSOR_TASK_POLLING_INTERVAL;
 
     data.temperature_is_valid = false;
     data.humidity_is_valid    = false;
     data.pressure_is_valid    = false;
 
+#if (OS_CFG_SENSOR_TASK_FILTER > 0u)
+    filter_init(&filter,
+                (Filter_TypeDef) OS_CFG_SENSOR_TASK_FILTER,
+                OS_CFG_SENSOR_TASK_FILTER_WINDOW,
+                OS_CFG_SENSOR_TASK_FILTER_ALPHA);
+#endif
+#if (OS_CFG_SENSOR_TASK_DEADBAND_EN > 0u) || (OS_CFG_SENSOR_TASK_ADAPTIVE_EN > 0u)
+    deadband_init(&deadband,
+                  OS_CFG_SENSOR_TASK_DEADBAND_TEMPERATURE * DEADBAND_SCALE,
+                  OS_CFG_SENSOR_TASK_DEADBAND_HUMIDITY * DEADBAND_SCALE,
+                  OS_CFG_SENSOR_TASK_DEADBAND_PRESSURE * DEADBAND_SCALE,
+                  (uint64_t) OS_CFG_SENSOR_TASK_DEADBAND_MAX_AGE * NS_PER_TICK);
+#endif
+#if (OS_CFG_SENSOR_TASK_ADAPTIVE_EN > 0u)
+    prev = data;
+#endif
+#if (OS_CFG_SENSOR_TASK_AGGREGATE_WINDOW == 0u)
+    reports = 0;
+#endif
+
+#if (OS_CFG_SENSOR_TASK_AGGREGATE_WINDOW > 0u)
+    windows = 0;
+    aggregate_reset(&window);
+#endif
+
+    if (BSP_Sensor_SetBusSpeed(curr_sensor, (Sensor_BusSpeedTypeDef) OS_CFG_SENSOR_TASK_BUS_SPEED) != BSP_SUCCESS)
+    {
+        sensor_error_handler("Failed to set sensor bus speed");
+    }
+
     if (BSP_Sensor_Reset(curr_sensor) != BSP_SUCCESS)
     {
         sensor_error_handler("Failed to reset sensor");
     }
 
+    resolution.osr           = (Sensor_OSRTypeDef) OS_CFG_SENSOR_TASK_OSR;
+    resolution.rh_resolution = (Sensor_RHResolutionTypeDef) OS_CFG_SENSOR_TASK_RH_RESOLUTION;
+
+    if (BSP_Sensor_SetResolution(curr_sensor, &resolution) != BSP_SUCCESS)
+    {
+        sensor_error_handler("Failed to set sensor resolution");
+    }
+
+    if (BSP_Sensor_GetLatency(curr_sensor, &latency_us) != BSP_SUCCESS)
+    {
+        sensor_error_handler("Failed to get sensor latency");
+    }
+
+    logger_log_int(&SensorTaskTCB, &err, "Sensor Conversion Time (us) =", latency_us);
+
+    /*
+     * The first release is the current tick, all later ones are multiples of the polling interval
+     * after it. Read both clocks without a tick in between, then align the reference to the start
+     * of the tick so it matches when the kernel actually releases the task.
+     */
+    CPU_CRITICAL_ENTER();
+    release          = OSTimeGet(&err);
+    first_release_ns = BSP_Timebase_GetNs();
+    CPU_CRITICAL_EXIT();
+
+    first_release     = release;
+    first_release_ns -= first_release_ns % NS_PER_TICK;
+    missed            = 0;
+
     while (1)
     {
-        /* Read sensor */
-        if (BSP_Sensor_Read(curr_sensor, &data) != BSP_SUCCESS)
+        sensor_record_release(BSP_Timebase_GetNs(),
+                              first_release_ns + ((uint64_t) (OS_TICK) (release - first_release) * NS_PER_TICK),
+                              missed,
+                              interval);
+
+        /* Read the channels due in this slot */
+        if (BSP_Sensor_ReadChannels(curr_sensor, sensor_channels_due(slot), &data) == BSP_SUCCESS)
         {
-            sensor_error_handler("Failed to read sensor");
+            failures = 0;
         }
-
-        /* Log sensor data */
-        if (data.temperature_is_valid == true)
+        else
         {
-            logger_log_float(&SensorTaskTCB, &err, "Temperature:", data.temperature);
+            sensor_record_failure();
+            failures++;
 
-            if (err != OS_ERR_NONE)
+            if (failures >= OS_CFG_SENSOR_TASK_MAX_READ_FAILURES)
             {
-                sensor_error_handler("Failed to log temperature");
+                sensor_error_handler("Failed to read sensor");
             }
+
+            /* Lose this sample only, the bus has already been recovered */
+            data.temperature_is_valid = false;
+            data.humidity_is_valid    = false;
+            data.pressure_is_valid    = false;
         }
 
-        if (data.humidity_is_valid == true)
+#if (OS_CFG_ALARM_EN > 0u)
+        /* Raw values, so the alarm latency includes neither filter delay nor reporting */
+        if (alarm_evaluate(&data, BSP_Timebase_GetNs(), &err) != 0U)
         {
-            logger_log_float(&SensorTaskTCB, &err, "Humidity:", data.humidity);
-
-            if (err != OS_ERR_NONE)
-            {
-                sensor_error_handler("Failed to log humidity");
-            }
+            sensor_report_alarm();
         }
 
-        if (data.pressure_is_valid == true)
+        if (err != OS_ERR_NONE)
         {
-            logger_log_float(&SensorTaskTCB, &err, "Pressure:", data.pressure);
-
-            if (err != OS_ERR_NONE)
-            {
-                sensor_error_handler("Failed to log pressure");
-            }
+            sensor_error_handler("Failed to signal alarm");
         }
+#endif
 
         /* Track number of times the sensor has been read */
         iterations++;
-        logger_log_int(&SensorTaskTCB, &err, "Number of Sensor Readings =", iterations);
 
+#if (OS_CFG_SENSOR_TASK_TIMESERIES_EN > 0u)
+        /* Keep history on the device */
+        timeseries_insert(&data, &err);
+
+        if (err != OS_ERR_NONE)
+        {
+            sensor_error_handler("Failed to store sensor data");
+        }
+#endif
+
+#if (OS_CFG_SENSOR_TASK_FILTER > 0u)
+        filter_apply(&filter, &data);
+#endif
+
+        /* Share the reading with any other consumers */
+        snapshot_publish(curr_sensor, &data, &err);
+
+        if (err != OS_ERR_NONE)
+        {
+            sensor_error_handler("Failed to publish sensor data");
+        }
+
+        /* Report sensor data */
+#if (OS_CFG_SENSOR_TASK_AGGREGATE_WINDOW > 0u)
+        aggregate_add(&window, &data);
+
+        if (window.num_samples >= OS_CFG_SENSOR_TASK_AGGREGATE_WINDOW)
+        {
+            windows++;
+            sensor_report_summary(curr_sensor, &window, windows);
+            aggregate_reset(&window);
+        }
+#else
+        report = data;
+
+#if (OS_CFG_SENSOR_TASK_DEADBAND_EN > 0u)
+        if (deadband_apply(&deadband, &report) == true)
+#endif
+        {
+            /* Counted separately from reads so skipped readings do not look like lost frames */
+            reports++;
+
+#if (OS_CFG_SENSOR_TASK_TELEMETRY_EN > 0u)
+            sensor_report_telemetry(curr_sensor, &report, reports);
+#else
+            sensor_report_text(&report, iterations);
+#endif
+        }
+#endif
+
+#if (OS_CFG_SENSOR_TASK_ADAPTIVE_EN > 0u)
+        interval = sensor_adapt_interval(interval, deadband_changed(&deadband, &prev, &data));
+        sensor_merge(&prev, &data);
+#endif
+
+#if (OS_CFG_SENSOR_TASK_PERIODIC_EN > 0u)
+        /* Wait for the next release */
+        missed = sensor_wait_release(&release, interval, &err);
+#else
         /* Delay for polling interval */
-        OSTimeDly((OS_TICK) OS_CFG_SENSOR_TASK_POLLING_INTERVAL,
+        OSTimeDly((OS_TICK) interval,
                   (OS_OPT)  OS_OPT_TIME_DLY,
                   (OS_ERR*) &err);
 
+        /* Still measured against the fixed-rate schedule, so the jitter shows the accumulated drift */
+        release += interval;
+#endif
+
+        /*
+         * The slot of the release waited for. Same as (release - first_release) / interval, but
+         * also counts right when the adaptive interval changes.
+         */
+        slot += 1U + missed;
+
         if (err != OS_ERR_NONE)
         {
             sensor_error_handler("Failed to poll sensor");
         }
     }
 }
+
+void sensor_get_stats(Sensor_Stats* p_stats, OS_ERR* p_err)
+{
+    CPU_SR_ALLOC();
+
+    if (p_stats == NULL)
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return;
+    }
+
+    CPU_CRITICAL_ENTER();
+    *p_stats = SensorStats;
+    CPU_CRITICAL_EXIT();
+
+    *p_err = OS_ERR_NONE;
+}
+
+void sensor_reset_stats(OS_ERR* p_err)
+{
+    uint32_t i;
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+
+    SensorStats.num_samples          = 0;
+    SensorStats.num_missed_deadlines = 0;
+    SensorStats.num_read_failures    = 0;
+    SensorStats.jitter_max_us        = 0;
+
+    for (i = 0; i < SENSOR_JITTER_HIST_SIZE; i++)
+    {
+        SensorStats.jitter_hist[i] = 0;
+    }
+
+    CPU_CRITICAL_EXIT();
+
+    *p_err = OS_ERR_NONE;
+}
@@ -9,7 +9,24 @@
 
 #include <os.h>
 
-void sensor_create(OS_ERR* p_err);
-void sensor_task  (void* p_arg);
+#include <stdint.h>
+
+/* Number of power-of-two jitter buckets, the last bucket collects everything >= 2^14 us */
+#define SENSOR_JITTER_HIST_SIZE (16U)
+
+typedef struct
+{
+    uint32_t num_samples;                          /* Sensor reads started                       */
+    uint32_t num_missed_deadlines;                 /* Releases skipped because a cycle overran   */
+    uint32_t num_read_failures;                    /* Reads that failed, each loses one sample   */
+    uint32_t jitter_max_us;                        /* Worst release jitter                       */
+    uint32_t poll_interval;                        /* Current polling interval (OS_TICK)         */
+    uint32_t jitter_hist[SENSOR_JITTER_HIST_SIZE]; /* Actual minus ideal release time            */
+} Sensor_Stats;
+
+void sensor_create     (OS_ERR* p_err);
+void sensor_task       (void* p_arg);
+void sensor_get_stats  (Sensor_Stats* p_stats, OS_ERR* p_err);
+void sensor_reset_stats(OS_ERR* p_err);
 
 #endif /* APP_TASK_H */
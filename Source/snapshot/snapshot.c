@@ -0,0 +1,220 @@
+/**
+ * @file   snapshot.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Latest Sensor Sample Snapshot.
+ *
+ *         The sensor task publishes every reading here, so any number of tasks can use
+ *         the latest sample without reading the sensor again (and without taking the
+ *         sensor mutex or using the I2C bus).
+ *
+ *         The snapshot is a seqlock with two slots. The writer fills the slot readers
+ *         are not using, then increments the sequence number, which makes that slot
+ *         the latest. A reader copies the latest slot and retries if the sequence number
+ *         changed meanwhile. Neither side ever blocks the other. Using two slots matters
+ *         on a single core: a reader that preempts the writer mid-copy finds the
+ *         previous sample intact and finishes on its first try. A plain seqlock would
+ *         spin there forever, because the writer it waits for cannot run.
+ *
+ *         To be woken for new samples a task subscribes and gets its own bit in the
+ *         sensor's event flag group. Every publish sets all subscribed bits, and
+ *         `snapshot_wait` consumes only the caller's bit. A sample published while a
+ *         subscriber was busy therefore wakes it on its next wait, and subscribers never
+ *         consume each other's wake-ups. The sequence number returned by `snapshot_read`
+ *         counts the samples published, so a subscriber can tell how many it missed.
+ */
+
+#include "snapshot.h"
+
+#include <os.h>
+#include <bsp.h>
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/* Orders the slot copy against the sequence number, also a compiler barrier */
+#define SNAPSHOT_BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+typedef struct
+{
+    volatile uint32_t seq;         /* Samples published, the latest is in slot[seq % 2] */
+    Sensor_Data       slot[2];
+    OS_FLAG_GRP       flags;
+    OS_FLAGS          subscribers; /* Bits handed out by snapshot_subscribe             */
+} Snapshot;
+
+static Snapshot Snapshots[SNAPSHOT_NUM_SENSORS];
+
+/* Returns NULL for a sensor without a snapshot */
+static Snapshot* snapshot_get(Sensor_TypeDef sensor)
+{
+    if ((uint32_t) sensor >= SNAPSHOT_NUM_SENSORS)
+    {
+        return NULL;
+    }
+
+    return &Snapshots[sensor];
+}
+
+void snapshot_init(OS_ERR* p_err)
+{
+    uint32_t i;
+
+    for (i = 0; i < SNAPSHOT_NUM_SENSORS; i++)
+    {
+        Snapshots[i].seq         = 0;
+        Snapshots[i].subscribers = 0;
+
+        OSFlagCreate((OS_FLAG_GRP*) &Snapshots[i].flags,
+                     (CPU_CHAR*)    "Snapshot Flags",
+                     (OS_FLAGS)     0,
+                     (OS_ERR*)      p_err);
+
+        if (*p_err != OS_ERR_NONE)
+        {
+            return;
+        }
+    }
+}
+
+/* Only call from the task that reads the sensor, there must be a single writer per sensor */
+void snapshot_publish(Sensor_TypeDef sensor, const Sensor_Data* p_data, OS_ERR* p_err)
+{
+    Snapshot* p_snapshot;
+    uint32_t seq;
+    OS_FLAGS subscribers;
+
+    p_snapshot = snapshot_get(sensor);
+
+    if ((p_snapshot == NULL) || (p_data == NULL))
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return;
+    }
+
+    seq = p_snapshot->seq;
+
+    /* Readers only copy slot[seq % 2], the other one is free */
+    p_snapshot->slot[(seq + 1U) % 2U] = *p_data;
+    SNAPSHOT_BARRIER();
+    p_snapshot->seq = seq + 1U;
+    SNAPSHOT_BARRIER();
+
+    subscribers = p_snapshot->subscribers;
+
+    if (subscribers == 0U)
+    {
+        *p_err = OS_ERR_NONE;
+        return;
+    }
+
+    (void) OSFlagPost((OS_FLAG_GRP*) &p_snapshot->flags,
+                      (OS_FLAGS)     subscribers,
+                      (OS_OPT)       OS_OPT_POST_FLAG_SET,
+                      (OS_ERR*)      p_err);
+}
+
+/* Returns the sequence number of the copied sample, or 0 (and leaves p_data unchanged) before the first publish */
+uint32_t snapshot_read(Sensor_TypeDef sensor, Sensor_Data* p_data, OS_ERR* p_err)
+{
+    Snapshot* p_snapshot;
+    uint32_t seq;
+    Sensor_Data data;
+
+    p_snapshot = snapshot_get(sensor);
+
+    if ((p_snapshot == NULL) || (p_data == NULL))
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return 0;
+    }
+
+    do
+    {
+        seq = p_snapshot->seq;
+        SNAPSHOT_BARRIER();
+        data = p_snapshot->slot[seq % 2U];
+        SNAPSHOT_BARRIER();
+    } while (p_snapshot->seq != seq);
+
+    if (seq != 0U)
+    {
+        *p_data = data;
+    }
+
+    *p_err = OS_ERR_NONE;
+
+    return seq;
+}
+
+/* Returns the caller's flag bit, or 0 if every bit is taken */
+OS_FLAGS snapshot_subscribe(Sensor_TypeDef sensor, OS_ERR* p_err)
+{
+    Snapshot* p_snapshot;
+    OS_FLAGS subscriber;
+    CPU_SR_ALLOC();
+
+    p_snapshot = snapshot_get(sensor);
+
+    if (p_snapshot == NULL)
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return 0;
+    }
+
+    CPU_CRITICAL_ENTER();
+
+    /* Lowest clear bit */
+    subscriber               = ~p_snapshot->subscribers & (p_snapshot->subscribers + 1U);
+    p_snapshot->subscribers |= subscriber;
+
+    CPU_CRITICAL_EXIT();
+
+    *p_err = (subscriber != 0U) ? OS_ERR_NONE : OS_ERR_OPT_INVALID;
+
+    return subscriber;
+}
+
+void snapshot_unsubscribe(Sensor_TypeDef sensor, OS_FLAGS subscriber, OS_ERR* p_err)
+{
+    Snapshot* p_snapshot;
+    CPU_SR_ALLOC();
+
+    p_snapshot = snapshot_get(sensor);
+
+    if (p_snapshot == NULL)
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return;
+    }
+
+    CPU_CRITICAL_ENTER();
+    p_snapshot->subscribers &= ~subscriber;
+    CPU_CRITICAL_EXIT();
+
+    /* Drop a pending wake-up, so the bit starts clear for the next subscriber */
+    (void) OSFlagPost((OS_FLAG_GRP*) &p_snapshot->flags,
+                      (OS_FLAGS)     subscriber,
+                      (OS_OPT)       OS_OPT_POST_FLAG_CLR,
+                      (OS_ERR*)      p_err);
+}
+
+/* Wait (at most timeout ticks, 0 is forever) until a sample is published after the last wait */
+void snapshot_wait(Sensor_TypeDef sensor, OS_FLAGS subscriber, OS_TICK timeout, OS_ERR* p_err)
+{
+    Snapshot* p_snapshot;
+
+    p_snapshot = snapshot_get(sensor);
+
+    if ((p_snapshot == NULL) || (subscriber == 0U))
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return;
+    }
+
+    (void) OSFlagPend((OS_FLAG_GRP*) &p_snapshot->flags,
+                      (OS_FLAGS)     subscriber,
+                      (OS_TICK)      timeout,
+                      (OS_OPT)       OS_OPT_PEND_FLAG_SET_ALL | OS_OPT_PEND_FLAG_CONSUME | OS_OPT_PEND_BLOCKING,
+                      (CPU_TS*)      NULL,
+                      (OS_ERR*)      p_err);
+}
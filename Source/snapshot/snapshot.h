@@ -0,0 +1,28 @@
+/**
+ * @file   snapshot.h
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Latest Sensor Sample Snapshot.
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <os.h>
+#include <bsp.h>
+
+#include <stdint.h>
+
+/* One snapshot per Sensor_TypeDef */
+#define SNAPSHOT_NUM_SENSORS     (1U)
+
+/* Each subscriber owns one flag bit */
+#define SNAPSHOT_MAX_SUBSCRIBERS (sizeof(OS_FLAGS) * 8U)
+
+void     snapshot_init       (OS_ERR* p_err);
+void     snapshot_publish    (Sensor_TypeDef sensor, const Sensor_Data* p_data, OS_ERR* p_err);
+uint32_t snapshot_read       (Sensor_TypeDef sensor, Sensor_Data* p_data, OS_ERR* p_err);
+OS_FLAGS snapshot_subscribe  (Sensor_TypeDef sensor, OS_ERR* p_err);
+void     snapshot_unsubscribe(Sensor_TypeDef sensor, OS_FLAGS subscriber, OS_ERR* p_err);
+void     snapshot_wait       (Sensor_TypeDef sensor, OS_FLAGS subscriber, OS_TICK timeout, OS_ERR* p_err);
+
+#endif /* SNAPSHOT_H */
@@ -0,0 +1,252 @@
+/**
+ * @file   telemetry.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Binary Sensor Telemetry Frames.
+ *
+ *         Logging every reading as text costs ~40 bytes per value on the wire. A
+ *         sample frame carries all values of one reading in a fixed binary layout
+ *         (all fields little-endian):
+ *
+ *             Offset  Size  Field
+ *             0       1     Frame type (TELEMETRY_FRAME_SAMPLE)
+ *             1       2     Sequence number, wraps at 65536
+ *             3       8     Timestamp (ns, BSP_Timebase_GetNs)
+ *             11      1     Sensor (Sensor_TypeDef)
+ *             12      1     Validity mask (TELEMETRY_VALID_*)
+ *             13      2     Temperature (int16, 0.01 degC)
+ *             15      2     Humidity (uint16, 0.01 %RH)
+ *             17      4     Pressure (uint32, 0.01 mbar)
+ *             21      2     CRC-16/CCITT-FALSE of bytes 0-20 (bsp_crc.c)
+ *
+ *         The frame is then COBS encoded, which removes every zero byte, and wrapped
+ *         in zero delimiters. A receiver can resynchronize on any zero byte, and text
+ *         log lines (which never contain zeros) can share the same UART: anything
+ *         between two delimiters that fails to decode is text.
+ *
+ *         A summary frame (aggregate.c) replaces the sample frames of a whole window:
+ *
+ *             Offset  Size  Field
+ *             0       1     Frame type (TELEMETRY_FRAME_SUMMARY)
+ *             1       2     Sequence number, wraps at 65536
+ *             3       8     Timestamp of the first sample in the window (ns)
+ *             11      8     Timestamp of the last sample in the window (ns)
+ *             19      1     Sensor (Sensor_TypeDef)
+ *             20      2     Samples in the window, saturates at 65535
+ *             22      18    Temperature summary (degC)
+ *             40      18    Humidity summary (%RH)
+ *             58      18    Pressure summary (mbar)
+ *             76      2     CRC-16/CCITT-FALSE of bytes 0-75 (bsp_crc.c)
+ *
+ *         where each channel summary is the number of valid samples (uint16, saturating)
+ *         followed by the mean, sample variance, min, and max as IEEE-754 floats.
+ *
+ *         Tools/telemetry/telemetry.py is the matching host-side parser.
+ */
+
+#include "telemetry.h"
+
+#include <os.h>
+#include <bsp.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Consistent Overhead Byte Stuffing, p_dst must hold size + (size / 254) + 1 bytes */
+static size_t cobs_encode(const uint8_t* p_src, size_t size, uint8_t* p_dst)
+{
+    size_t i;
+    size_t out;
+    size_t code_idx;
+    uint8_t code;
+
+    out      = 1;
+    code_idx = 0;
+    code     = 1;
+
+    for (i = 0; i < size; i++)
+    {
+        if (p_src[i] == 0U)
+        {
+            p_dst[code_idx] = code;
+            code_idx        = out++;
+            code            = 1;
+        }
+        else
+        {
+            p_dst[out++] = p_src[i];
+            code++;
+
+            if (code == 0xFFU)
+            {
+                p_dst[code_idx] = code;
+                code_idx        = out++;
+                code            = 1;
+            }
+        }
+    }
+
+    p_dst[code_idx] = code;
+
+    return out;
+}
+
+static void put_le16(uint8_t* p_buf, uint16_t value)
+{
+    p_buf[0] = (uint8_t) (value);
+    p_buf[1] = (uint8_t) (value >> 8);
+}
+
+static void put_le32(uint8_t* p_buf, uint32_t value)
+{
+    put_le16(&p_buf[0], (uint16_t) (value));
+    put_le16(&p_buf[2], (uint16_t) (value >> 16));
+}
+
+static void put_le64(uint8_t* p_buf, uint64_t value)
+{
+    put_le32(&p_buf[0], (uint32_t) (value));
+    put_le32(&p_buf[4], (uint32_t) (value >> 32));
+}
+
+static void put_float(uint8_t* p_buf, float value)
+{
+    uint32_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    put_le32(p_buf, bits);
+}
+
+static uint16_t saturate_u16(uint32_t value)
+{
+    return (value > UINT16_MAX) ? (uint16_t) UINT16_MAX : (uint16_t) value;
+}
+
+/* Appends the CRC to `p_raw` (which must have room for it) and writes the framed result to `p_frame` */
+static size_t frame_raw(uint8_t* p_raw, size_t raw_size, uint8_t* p_frame, OS_ERR* p_err)
+{
+    size_t n_bytes;
+    uint32_t crc;
+
+    /* Frames are small, polled mode avoids the DMA setup cost */
+    if (BSP_CRC_Calculate(CRC_Algo_CRC16_CCITT, CRC_Mode_Polled, p_raw, raw_size - 2U, &crc) != BSP_SUCCESS)
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return 0;
+    }
+
+    put_le16(&p_raw[raw_size - 2U], (uint16_t) crc);
+
+    /* Leading delimiter terminates any partial text line or corrupted frame before this one */
+    p_frame[0] = 0x00U;
+    n_bytes    = 1U + cobs_encode(p_raw, raw_size, &p_frame[1]);
+    p_frame[n_bytes++] = 0x00U;
+
+    *p_err = OS_ERR_NONE;
+
+    return n_bytes;
+}
+
+static void put_channel_summary(uint8_t* p_buf, const Aggregate_Stats* p_stats)
+{
+    put_le16(&p_buf[0], saturate_u16(p_stats->count));
+    put_float(&p_buf[2], p_stats->mean);
+    put_float(&p_buf[6], aggregate_variance(p_stats));
+    put_float(&p_buf[10], p_stats->min);
+    put_float(&p_buf[14], p_stats->max);
+}
+
+/* Scale to fixed point and round to nearest, saturating at the limits of the field */
+static int32_t scale_round(float value, float scale, int32_t min, int32_t max)
+{
+    float scaled;
+
+    scaled = value * scale;
+
+    if (scaled <= (float) min)
+    {
+        return min;
+    }
+
+    if (scaled >= (float) max)
+    {
+        return max;
+    }
+
+    return (int32_t) ((scaled >= 0.0f) ? (scaled + 0.5f) : (scaled - 0.5f));
+}
+
+size_t telemetry_encode_sample(uint8_t* p_frame, size_t frame_size, uint16_t seq,
+                               Sensor_TypeDef sensor, const Sensor_Data* p_data, OS_ERR* p_err)
+{
+    uint8_t raw[TELEMETRY_SAMPLE_SIZE];
+    uint8_t mask;
+    int32_t temperature;
+    int32_t humidity;
+    int32_t pressure;
+
+    if ((p_frame == NULL) || (p_data == NULL) || (frame_size < TELEMETRY_FRAME_MAX_SIZE))
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return 0;
+    }
+
+    mask        = 0;
+    temperature = 0;
+    humidity    = 0;
+    pressure    = 0;
+
+    if (p_data->temperature_is_valid == true)
+    {
+        mask        |= TELEMETRY_VALID_TEMPERATURE;
+        temperature  = scale_round(p_data->temperature, 100.0f, INT16_MIN, INT16_MAX);
+    }
+
+    if (p_data->humidity_is_valid == true)
+    {
+        mask     |= TELEMETRY_VALID_HUMIDITY;
+        humidity  = scale_round(p_data->humidity, 100.0f, 0, UINT16_MAX);
+    }
+
+    if (p_data->pressure_is_valid == true)
+    {
+        mask     |= TELEMETRY_VALID_PRESSURE;
+        pressure  = scale_round(p_data->pressure, 100.0f, 0, INT32_MAX);
+    }
+
+    raw[0] = TELEMETRY_FRAME_SAMPLE;
+    put_le16(&raw[1], seq);
+    put_le64(&raw[3], p_data->timestamp_ns);
+    raw[11] = (uint8_t) sensor;
+    raw[12] = mask;
+    put_le16(&raw[13], (uint16_t) temperature);
+    put_le16(&raw[15], (uint16_t) humidity);
+    put_le32(&raw[17], (uint32_t) pressure);
+
+    return frame_raw(raw, TELEMETRY_SAMPLE_SIZE, p_frame, p_err);
+}
+
+size_t telemetry_encode_summary(uint8_t* p_frame, size_t frame_size, uint16_t seq,
+                                Sensor_TypeDef sensor, const Aggregate_Window* p_window, OS_ERR* p_err)
+{
+    uint8_t raw[TELEMETRY_SUMMARY_SIZE];
+
+    if ((p_frame == NULL) || (p_window == NULL) || (frame_size < TELEMETRY_FRAME_MAX_SIZE))
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return 0;
+    }
+
+    raw[0] = TELEMETRY_FRAME_SUMMARY;
+    put_le16(&raw[1], seq);
+    put_le64(&raw[3], p_window->start_ns);
+    put_le64(&raw[11], p_window->end_ns);
+    raw[19] = (uint8_t) sensor;
+    put_le16(&raw[20], saturate_u16(p_window->num_samples));
+    put_channel_summary(&raw[22], &p_window->temperature);
+    put_channel_summary(&raw[22 + TELEMETRY_CHANNEL_SUMMARY_SIZE], &p_window->humidity);
+    put_channel_summary(&raw[22 + (2U * TELEMETRY_CHANNEL_SUMMARY_SIZE)], &p_window->pressure);
+
+    return frame_raw(raw, TELEMETRY_SUMMARY_SIZE, p_frame, p_err);
+}
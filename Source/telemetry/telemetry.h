@@ -0,0 +1,45 @@
+/**
+ * @file   telemetry.h
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Binary Sensor Telemetry Frames.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <aggregate.h>
+
+#include <os.h>
+#include <bsp.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Frame types, first byte of every decoded frame */
+#define TELEMETRY_FRAME_SAMPLE         (0x01U)
+#define TELEMETRY_FRAME_SUMMARY        (0x02U)
+
+/* Bits of the validity mask */
+#define TELEMETRY_VALID_TEMPERATURE    (1U << 0)
+#define TELEMETRY_VALID_HUMIDITY       (1U << 1)
+#define TELEMETRY_VALID_PRESSURE       (1U << 2)
+
+/* Sample frame before framing: type, seq, timestamp, sensor, mask, values, CRC */
+#define TELEMETRY_SAMPLE_SIZE          (1U + 2U + 8U + 1U + 1U + 2U + 2U + 4U + 2U)
+
+/* Summary frame before framing: type, seq, start, end, sensor, samples, 3 x channel summary, CRC */
+#define TELEMETRY_CHANNEL_SUMMARY_SIZE (2U + 4U + 4U + 4U + 4U)
+#define TELEMETRY_SUMMARY_SIZE         (1U + 2U + 8U + 8U + 1U + 2U + (3U * TELEMETRY_CHANNEL_SUMMARY_SIZE) + 2U)
+
+/*
+ * Worst case COBS overhead for a frame this size is one byte, plus a delimiter on each side.
+ * Sized for the largest frame type, so one buffer fits any frame.
+ */
+#define TELEMETRY_FRAME_MAX_SIZE       (TELEMETRY_SUMMARY_SIZE + 1U + 2U)
+
+size_t telemetry_encode_sample (uint8_t* p_frame, size_t frame_size, uint16_t seq,
+                                Sensor_TypeDef sensor, const Sensor_Data* p_data, OS_ERR* p_err);
+size_t telemetry_encode_summary(uint8_t* p_frame, size_t frame_size, uint16_t seq,
+                                Sensor_TypeDef sensor, const Aggregate_Window* p_window, OS_ERR* p_err);
+
+#endif /* TELEMETRY_H */
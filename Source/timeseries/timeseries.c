@@ -0,0 +1,453 @@
+/**
+ * @file   timeseries.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  In-RAM Sensor Time-Series Store.
+ *
+ *         Keeps sensor history on the device in a fixed amount of memory, in three
+ *         rings ordered by timestamp:
+ *
+ *             - Raw: the most recent OS_CFG_TIMESERIES_RAW_SIZE samples as read.
+ *             - Minute: min/max/mean/count per channel for each minute of the
+ *               timebase, OS_CFG_TIMESERIES_MINUTE_SIZE minutes deep.
+ *             - Hour: the same per hour, OS_CFG_TIMESERIES_HOUR_SIZE hours deep.
+ *
+ *         The tiers are updated on every insert rather than computed from the raw ring,
+ *         so each insert is O(1) and the tiers cover far more time than the raw ring.
+ *         When a ring is full the oldest entry is overwritten.
+ *
+ *         Since every ring is sorted by timestamp, range queries binary search for the
+ *         first entry and then copy forward. Timestamps must therefore never decrease,
+ *         which `BSP_Timebase_GetNs` guarantees for a single sensor task.
+ *
+ *         `timeseries_export_raw` compresses a range of the raw ring into a sample block
+ *         (sample_block.c), several times smaller than the samples themselves, for
+ *         sending or saving a longer stretch of history.
+ *
+ *         The store is written by the sensor task and may be queried by any task, so it
+ *         is protected by a mutex.
+ */
+
+#include "timeseries.h"
+
+#include <sample_block.h>
+
+#include <os.h>
+#include <bsp.h>
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define NS_PER_MINUTE (60ULL * 1000000000ULL)
+#define NS_PER_HOUR   (60ULL * NS_PER_MINUTE)
+
+typedef struct
+{
+    Timeseries_Aggregate* p_buf;
+    uint32_t              size;
+    uint32_t              oldest;
+    uint32_t              count;
+    uint64_t              period_ns;
+} Timeseries_Ring;
+
+static OS_MUTEX             TimeseriesMutex;
+static Timeseries_Sample    RawBuf[OS_CFG_TIMESERIES_RAW_SIZE];
+static uint32_t             RawOldest;
+static uint32_t             RawCount;
+static Timeseries_Aggregate MinuteBuf[OS_CFG_TIMESERIES_MINUTE_SIZE];
+static Timeseries_Aggregate HourBuf[OS_CFG_TIMESERIES_HOUR_SIZE];
+static Timeseries_Ring      Tiers[2];
+static uint64_t             LastTimestamp;
+
+/* Raw range handed to the sample block encoder, indices are relative to the first sample of the range */
+typedef struct
+{
+    uint32_t first;
+} Timeseries_Export;
+
+static uint32_t ring_index(uint32_t oldest, uint32_t i, uint32_t size)
+{
+    return (oldest + i) % size;
+}
+
+static void timeseries_lock(OS_ERR* p_err)
+{
+    OSMutexPend((OS_MUTEX*) &TimeseriesMutex,
+                (OS_TICK)   0,
+                (OS_OPT)    OS_OPT_PEND_BLOCKING,
+                (CPU_TS*)   NULL,
+                (OS_ERR*)   p_err);
+}
+
+static void timeseries_unlock(OS_ERR* p_err)
+{
+    OSMutexPost((OS_MUTEX*) &TimeseriesMutex,
+                (OS_OPT)    OS_OPT_POST_NONE,
+                (OS_ERR*)   p_err);
+}
+
+/* Running mean avoids keeping a sum, which would lose precision in a float after many samples */
+static void summary_add(Timeseries_Summary* p_summary, float value)
+{
+    if (p_summary->count == 0U)
+    {
+        p_summary->min   = value;
+        p_summary->max   = value;
+        p_summary->mean  = value;
+        p_summary->count = 1;
+        return;
+    }
+
+    if (value < p_summary->min)
+    {
+        p_summary->min = value;
+    }
+
+    if (value > p_summary->max)
+    {
+        p_summary->max = value;
+    }
+
+    p_summary->count++;
+    p_summary->mean += (value - p_summary->mean) / (float) p_summary->count;
+}
+
+static void raw_push(const Timeseries_Sample* p_sample)
+{
+    uint32_t idx;
+
+    if (RawCount < OS_CFG_TIMESERIES_RAW_SIZE)
+    {
+        idx = ring_index(RawOldest, RawCount, OS_CFG_TIMESERIES_RAW_SIZE);
+        RawCount++;
+    }
+    else
+    {
+        idx       = RawOldest;
+        RawOldest = ring_index(RawOldest, 1U, OS_CFG_TIMESERIES_RAW_SIZE);
+    }
+
+    RawBuf[idx] = *p_sample;
+}
+
+static void tier_update(Timeseries_Ring* p_ring, const Timeseries_Sample* p_sample)
+{
+    uint32_t i;
+    uint64_t start_ns;
+    Timeseries_Aggregate* p_agg;
+
+    start_ns = p_sample->timestamp_ns - (p_sample->timestamp_ns % p_ring->period_ns);
+    p_agg    = NULL;
+
+    if (p_ring->count > 0U)
+    {
+        p_agg = &p_ring->p_buf[ring_index(p_ring->oldest, p_ring->count - 1U, p_ring->size)];
+    }
+
+    /* First sample of a new interval opens a new entry, overwriting the oldest if full */
+    if ((p_agg == NULL) || (p_agg->start_ns != start_ns))
+    {
+        if (p_ring->count < p_ring->size)
+        {
+            p_agg = &p_ring->p_buf[ring_index(p_ring->oldest, p_ring->count, p_ring->size)];
+            p_ring->count++;
+        }
+        else
+        {
+            p_agg          = &p_ring->p_buf[p_ring->oldest];
+            p_ring->oldest = ring_index(p_ring->oldest, 1U, p_ring->size);
+        }
+
+        p_agg->start_ns = start_ns;
+
+        for (i = 0; i < TIMESERIES_NUM_CHANNELS; i++)
+        {
+            p_agg->channel[i].count = 0;
+        }
+    }
+
+    for (i = 0; i < TIMESERIES_NUM_CHANNELS; i++)
+    {
+        if ((p_sample->valid_mask & (1U << i)) != 0U)
+        {
+            summary_add(&p_agg->channel[i], p_sample->value[i]);
+        }
+    }
+}
+
+/* Index (from the oldest entry) of the first raw sample at or after `timestamp_ns` */
+static uint32_t raw_lower_bound(uint64_t timestamp_ns)
+{
+    uint32_t lo;
+    uint32_t hi;
+    uint32_t mid;
+
+    lo = 0;
+    hi = RawCount;
+
+    while (lo < hi)
+    {
+        mid = lo + ((hi - lo) / 2U);
+
+        if (RawBuf[ring_index(RawOldest, mid, OS_CFG_TIMESERIES_RAW_SIZE)].timestamp_ns < timestamp_ns)
+        {
+            lo = mid + 1U;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/* Index (from the oldest entry) of the first interval starting at or after `timestamp_ns` */
+static uint32_t tier_lower_bound(const Timeseries_Ring* p_ring, uint64_t timestamp_ns)
+{
+    uint32_t lo;
+    uint32_t hi;
+    uint32_t mid;
+
+    lo = 0;
+    hi = p_ring->count;
+
+    while (lo < hi)
+    {
+        mid = lo + ((hi - lo) / 2U);
+
+        if (p_ring->p_buf[ring_index(p_ring->oldest, mid, p_ring->size)].start_ns < timestamp_ns)
+        {
+            lo = mid + 1U;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+static const Sample_Record* raw_get(void* p_ctx, uint32_t index)
+{
+    const Timeseries_Export* p_export;
+
+    p_export = (const Timeseries_Export*) p_ctx;
+
+    return &RawBuf[ring_index(RawOldest, p_export->first + index, OS_CFG_TIMESERIES_RAW_SIZE)];
+}
+
+void timeseries_init(OS_ERR* p_err)
+{
+    RawOldest     = 0;
+    RawCount      = 0;
+    LastTimestamp = 0;
+
+    Tiers[Timeseries_Minute].p_buf     = MinuteBuf;
+    Tiers[Timeseries_Minute].size      = OS_CFG_TIMESERIES_MINUTE_SIZE;
+    Tiers[Timeseries_Minute].oldest    = 0;
+    Tiers[Timeseries_Minute].count     = 0;
+    Tiers[Timeseries_Minute].period_ns = NS_PER_MINUTE;
+
+    Tiers[Timeseries_Hour].p_buf       = HourBuf;
+    Tiers[Timeseries_Hour].size        = OS_CFG_TIMESERIES_HOUR_SIZE;
+    Tiers[Timeseries_Hour].oldest      = 0;
+    Tiers[Timeseries_Hour].count       = 0;
+    Tiers[Timeseries_Hour].period_ns   = NS_PER_HOUR;
+
+    OSMutexCreate((OS_MUTEX*) &TimeseriesMutex,
+                  (CPU_CHAR*) "Timeseries Mutex",
+                  (OS_ERR*)   p_err);
+}
+
+void timeseries_insert(const Sensor_Data* p_data, OS_ERR* p_err)
+{
+    OS_ERR unlock_err;
+    Timeseries_Sample sample;
+
+    if (p_data == NULL)
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return;
+    }
+
+    sample.timestamp_ns                  = p_data->timestamp_ns;
+    sample.value[Timeseries_Temperature] = p_data->temperature;
+    sample.value[Timeseries_Humidity]    = p_data->humidity;
+    sample.value[Timeseries_Pressure]    = p_data->pressure;
+    sample.valid_mask                    = 0;
+
+    if (p_data->temperature_is_valid == true)
+    {
+        sample.valid_mask |= (uint8_t) (1U << Timeseries_Temperature);
+    }
+
+    if (p_data->humidity_is_valid == true)
+    {
+        sample.valid_mask |= (uint8_t) (1U << Timeseries_Humidity);
+    }
+
+    if (p_data->pressure_is_valid == true)
+    {
+        sample.valid_mask |= (uint8_t) (1U << Timeseries_Pressure);
+    }
+
+    timeseries_lock(p_err);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return;
+    }
+
+    /* Out of order samples would break the binary search */
+    if (sample.timestamp_ns < LastTimestamp)
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+    }
+    else
+    {
+        LastTimestamp = sample.timestamp_ns;
+
+        raw_push(&sample);
+        tier_update(&Tiers[Timeseries_Minute], &sample);
+        tier_update(&Tiers[Timeseries_Hour], &sample);
+    }
+
+    timeseries_unlock(&unlock_err);
+
+    if (*p_err == OS_ERR_NONE)
+    {
+        *p_err = unlock_err;
+    }
+}
+
+/* Copies samples with `start_ns` <= timestamp < `end_ns`, oldest first, returns the number copied */
+uint32_t timeseries_query_raw(uint64_t start_ns, uint64_t end_ns, Timeseries_Sample* p_out,
+                              uint32_t max_out, OS_ERR* p_err)
+{
+    uint32_t i;
+    uint32_t n;
+    const Timeseries_Sample* p_sample;
+
+    if (p_out == NULL)
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return 0;
+    }
+
+    timeseries_lock(p_err);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return 0;
+    }
+
+    n = 0;
+
+    for (i = raw_lower_bound(start_ns); (i < RawCount) && (n < max_out); i++)
+    {
+        p_sample = &RawBuf[ring_index(RawOldest, i, OS_CFG_TIMESERIES_RAW_SIZE)];
+
+        if (p_sample->timestamp_ns >= end_ns)
+        {
+            break;
+        }
+
+        p_out[n++] = *p_sample;
+    }
+
+    timeseries_unlock(p_err);
+
+    return n;
+}
+
+/* Copies intervals with `start_ns` <= interval start < `end_ns`, oldest first, returns the number copied */
+uint32_t timeseries_query_tier(Timeseries_TierTypeDef tier, uint64_t start_ns, uint64_t end_ns,
+                               Timeseries_Aggregate* p_out, uint32_t max_out, OS_ERR* p_err)
+{
+    uint32_t i;
+    uint32_t n;
+    const Timeseries_Ring* p_ring;
+    const Timeseries_Aggregate* p_agg;
+
+    if ((p_out == NULL) || ((tier != Timeseries_Minute) && (tier != Timeseries_Hour)))
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return 0;
+    }
+
+    p_ring = &Tiers[tier];
+
+    timeseries_lock(p_err);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return 0;
+    }
+
+    n = 0;
+
+    for (i = tier_lower_bound(p_ring, start_ns); (i < p_ring->count) && (n < max_out); i++)
+    {
+        p_agg = &p_ring->p_buf[ring_index(p_ring->oldest, i, p_ring->size)];
+
+        if (p_agg->start_ns >= end_ns)
+        {
+            break;
+        }
+
+        p_out[n++] = *p_agg;
+    }
+
+    timeseries_unlock(p_err);
+
+    return n;
+}
+
+/* Compresses samples with `start_ns` <= timestamp < `end_ns` into one sample block, returns its size */
+size_t timeseries_export_raw(uint64_t start_ns, uint64_t end_ns, uint8_t* p_block, size_t block_size,
+                             OS_ERR* p_err)
+{
+    uint32_t last;
+    size_t size;
+    OS_ERR unlock_err;
+    Timeseries_Export export;
+
+    if (p_block == NULL)
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+        return 0;
+    }
+
+    timeseries_lock(p_err);
+
+    if (*p_err != OS_ERR_NONE)
+    {
+        return 0;
+    }
+
+    export.first = raw_lower_bound(start_ns);
+    last         = raw_lower_bound(end_ns);
+    size         = 0;
+
+    if (last > export.first)
+    {
+        size = sample_block_encode(raw_get, &export, last - export.first, p_block, block_size);
+    }
+
+    /* An empty range or a block too small for the range */
+    if (size == 0U)
+    {
+        *p_err = OS_ERR_OPT_INVALID;
+    }
+
+    timeseries_unlock(&unlock_err);
+
+    if (*p_err == OS_ERR_NONE)
+    {
+        *p_err = unlock_err;
+    }
+
+    return (*p_err == OS_ERR_NONE) ? size : 0U;
+}
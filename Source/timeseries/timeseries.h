@@ -0,0 +1,59 @@
+/**
+ * @file   timeseries.h
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  In-RAM Sensor Time-Series Store.
+ */
+
+#ifndef TIMESERIES_H
+#define TIMESERIES_H
+
+#include <sample_block.h>
+
+#include <os.h>
+#include <bsp.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TIMESERIES_NUM_CHANNELS SAMPLE_BLOCK_NUM_CHANNELS
+
+typedef enum
+{
+    Timeseries_Temperature,
+    Timeseries_Humidity,
+    Timeseries_Pressure,
+} Timeseries_ChannelTypeDef;
+
+typedef enum
+{
+    Timeseries_Minute,
+    Timeseries_Hour,
+} Timeseries_TierTypeDef;
+
+/* Raw samples share the sample block record, value[] is indexed by Timeseries_ChannelTypeDef */
+typedef Sample_Record Timeseries_Sample;
+
+typedef struct
+{
+    float    min;
+    float    max;
+    float    mean;
+    uint32_t count;                            /* Valid samples, min/max/mean unset if 0 */
+} Timeseries_Summary;
+
+typedef struct
+{
+    uint64_t           start_ns;                         /* Start of the interval, aligned to its length */
+    Timeseries_Summary channel[TIMESERIES_NUM_CHANNELS]; /* Indexed by Timeseries_ChannelTypeDef         */
+} Timeseries_Aggregate;
+
+void     timeseries_init       (OS_ERR* p_err);
+void     timeseries_insert     (const Sensor_Data* p_data, OS_ERR* p_err);
+uint32_t timeseries_query_raw  (uint64_t start_ns, uint64_t end_ns, Timeseries_Sample* p_out,
+                                uint32_t max_out, OS_ERR* p_err);
+uint32_t timeseries_query_tier (Timeseries_TierTypeDef tier, uint64_t start_ns, uint64_t end_ns,
+                                Timeseries_Aggregate* p_out, uint32_t max_out, OS_ERR* p_err);
+size_t   timeseries_export_raw (uint64_t start_ns, uint64_t end_ns, uint8_t* p_block, size_t block_size,
+                                OS_ERR* p_err);
+
+#endif /* TIMESERIES_H */
@@ -0,0 +1,301 @@
+/**
+ * @file   ms8607_comp_tool.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Host tool for the MS8607 compensation paths (WeatherShield/ms8607_comp.c).
+ *
+ *         Built from the same ms8607_comp.c as the application (`make ms8607-comp-tool`).
+ *
+ *         `verify` checks the humidity CRC-8 against the datasheet examples and the
+ *         compensation against the datasheet example, then converts random readings within the
+ *         sensor's operating range with both paths. Temperature and pressure must match the
+ *         float path exactly at 0.01 resolution. The fixed point humidity must match
+ *         `exact_humidity`, a plain 64-bit rational evaluation of the datasheet formula with
+ *         round half up, exactly. Its difference from the rounded float result is only
+ *         reported, float rounding can land either side of a 0.005 boundary.
+ *
+ *         `bench` reports the host cost of each path in ns/conversion. The device figures
+ *         come from OS_CFG_APP_TASK_COMP_BENCH_EN.
+ *
+ *         Usage:
+ *             ms8607_comp_tool verify [num_readings]
+ *             ms8607_comp_tool bench
+ */
+
+#include <ms8607_comp.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_READINGS   (10000000UL)
+#define BENCH_READINGS     (1024U)
+#define BENCH_MIN_SECONDS  (1.0)
+
+/* Operating range, in 0.01 units */
+#define TEMPERATURE_MIN    (-4000)
+#define TEMPERATURE_MAX    (8500)
+#define PRESSURE_MIN       (1000)
+#define PRESSURE_MAX       (200000)
+
+/* Datasheet example */
+static const MS8607_Prom ExampleProm = {{0, 46372, 43981, 29059, 27842, 31553, 28165}};
+static const MS8607_Raw  ExampleRaw  = {6465444, 8077636, 0};
+
+#define EXAMPLE_TEMPERATURE (2000)
+#define EXAMPLE_PRESSURE    (110002)
+
+/* Datasheet "RH CRC" examples, a humidity answer and its CRC-8 */
+static const uint8_t CrcExamples[][3] = {{0x68, 0x3A, 0x7C}, {0x4E, 0x85, 0x6B}};
+
+static uint64_t RngState = 0x9E3779B97F4A7C15ULL;
+
+static volatile int32_t BenchSink;
+
+static uint32_t rng_next(void)
+{
+    RngState ^= RngState << 13;
+    RngState ^= RngState >> 7;
+    RngState ^= RngState << 17;
+
+    return (uint32_t) (RngState >> 32);
+}
+
+/* Uniform in [value - value / 4, value + value / 4] */
+static uint16_t rng_near(uint16_t value)
+{
+    return (uint16_t) (value - (value / 4U) + (rng_next() % ((value / 2U) + 1U)));
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double) ts.tv_sec + ((double) ts.tv_nsec * 1e-9);
+}
+
+/* Floor division, C rounds towards zero */
+static int64_t div_floor64(int64_t num, int64_t den)
+{
+    int64_t quot;
+
+    quot = num / den;
+
+    if (((num % den) != 0) && ((num < 0) != (den < 0)))
+    {
+        quot--;
+    }
+
+    return quot;
+}
+
+/*
+ * Reference humidity in 0.01 %RH, from the datasheet formulas with T in 0.01 degC:
+ *
+ *     RH  = -6 + 125 * D3 / 2^16
+ *     RHc = RH + (20 - T / 100) * -0.15
+ *
+ * Scaled by 100 and put over the common denominator 2^16 * 100:
+ *
+ *     100 * RHc = (12500 * 100 * D3 + 15 * 2^16 * (T - 2000)) / (2^16 * 100) - 600
+ *
+ * The division is done once, on the exact numerator, and rounded half up (towards +inf).
+ * `*p_is_tie` reports readings that land exactly on a 0.005 boundary.
+ */
+static int32_t exact_humidity(const MS8607_Raw* p_raw, int32_t temperature, bool* p_is_tie)
+{
+    int64_t num;
+    int64_t den;
+
+    num = (1250000LL * (int64_t) p_raw->d3) + (15LL * 65536LL * ((int64_t) temperature - 2000));
+    den = 65536LL * 100LL;
+
+    *p_is_tie = (((num % den) + den) % den) == (den / 2);
+
+    return (int32_t) (div_floor64((2 * num) + den, 2 * den) - 600);
+}
+
+static int32_t to_centi(float value)
+{
+    double scaled;
+
+    scaled = (double) value * 100.0;
+
+    return (int32_t) ((scaled >= 0.0) ? (scaled + 0.5) : (scaled - 0.5));
+}
+
+/* Random calibration and ADC words, redrawn until the result is within the operating range */
+static void random_reading(MS8607_Prom* p_prom, MS8607_Raw* p_raw, MS8607_Result* p_result)
+{
+    uint32_t i;
+
+    do
+    {
+        for (i = 1; i < MS8607_PROM_WORDS; i++)
+        {
+            p_prom->c[i] = rng_near(ExampleProm.c[i]);
+        }
+
+        p_raw->d1 = rng_next() & 0xFFFFFFU;
+        p_raw->d2 = ((uint32_t) p_prom->c[5] << 8) + (rng_next() % (1U << 23)) - (1U << 22);
+        p_raw->d3 = (uint16_t) (rng_next() & 0xFFFCU);
+
+        ms8607_comp_fixed(p_prom, p_raw, p_result);
+    }
+    while ((p_result->temperature < TEMPERATURE_MIN) || (p_result->temperature > TEMPERATURE_MAX) ||
+           (p_result->pressure < PRESSURE_MIN) || (p_result->pressure > PRESSURE_MAX));
+}
+
+static int cmd_verify(unsigned long num_readings)
+{
+    MS8607_Prom prom;
+    MS8607_Raw raw;
+    MS8607_Result fixed;
+    float temperature;
+    float pressure;
+    float humidity;
+    int32_t diff;
+    bool is_tie;
+    unsigned long i;
+    unsigned long temperature_errors;
+    unsigned long pressure_errors;
+    unsigned long humidity_errors;
+    unsigned long humidity_ties;
+    unsigned long humidity_float_off;
+
+    for (i = 0; i < (sizeof(CrcExamples) / sizeof(CrcExamples[0])); i++)
+    {
+        if (ms8607_rh_crc(CrcExamples[i], 2U) != CrcExamples[i][2])
+        {
+            fprintf(stderr, "datasheet CRC example: got 0x%02x for 0x%02x%02x, expected 0x%02x\n",
+                    ms8607_rh_crc(CrcExamples[i], 2U), CrcExamples[i][0], CrcExamples[i][1], CrcExamples[i][2]);
+            return 1;
+        }
+    }
+
+    ms8607_comp_fixed(&ExampleProm, &ExampleRaw, &fixed);
+
+    if ((fixed.temperature != EXAMPLE_TEMPERATURE) || (fixed.pressure != EXAMPLE_PRESSURE))
+    {
+        fprintf(stderr, "datasheet example: got T=%ld P=%ld, expected T=%d P=%d\n",
+                (long) fixed.temperature, (long) fixed.pressure, EXAMPLE_TEMPERATURE, EXAMPLE_PRESSURE);
+        return 1;
+    }
+
+    temperature_errors = 0;
+    pressure_errors    = 0;
+    humidity_errors    = 0;
+    humidity_ties      = 0;
+    humidity_float_off = 0;
+
+    for (i = 0; i < num_readings; i++)
+    {
+        random_reading(&prom, &raw, &fixed);
+        ms8607_comp_float(&prom, &raw, &temperature, &pressure, &humidity);
+
+        temperature_errors += (fixed.temperature != to_centi(temperature)) ? 1U : 0U;
+        pressure_errors    += (fixed.pressure != to_centi(pressure)) ? 1U : 0U;
+
+        humidity_errors += (fixed.humidity != exact_humidity(&raw, fixed.temperature, &is_tie)) ? 1U : 0U;
+        humidity_ties   += is_tie ? 1U : 0U;
+
+        /* Information only, see above */
+        diff                = fixed.humidity - to_centi(humidity);
+        humidity_float_off += (diff != 0) ? 1U : 0U;
+    }
+
+    printf("readings:            %lu\n", num_readings);
+    printf("temperature errors:  %lu\n", temperature_errors);
+    printf("pressure errors:     %lu\n", pressure_errors);
+    printf("humidity errors:     %lu\n", humidity_errors);
+    printf("humidity ties:       %lu\n", humidity_ties);
+    printf("humidity != float:   %lu (not an error)\n", humidity_float_off);
+
+    return ((temperature_errors == 0U) && (pressure_errors == 0U) && (humidity_errors == 0U)) ? 0 : 1;
+}
+
+static int cmd_bench(void)
+{
+    static MS8607_Prom proms[BENCH_READINGS];
+    static MS8607_Raw raws[BENCH_READINGS];
+
+    MS8607_Result fixed;
+    float temperature;
+    float pressure;
+    float humidity;
+    uint32_t i;
+    uint64_t runs;
+    double start;
+    double fixed_s;
+    double float_s;
+
+    for (i = 0; i < BENCH_READINGS; i++)
+    {
+        random_reading(&proms[i], &raws[i], &fixed);
+    }
+
+    runs  = 0;
+    start = now_seconds();
+
+    do
+    {
+        for (i = 0; i < BENCH_READINGS; i++)
+        {
+            ms8607_comp_fixed(&proms[i], &raws[i], &fixed);
+            BenchSink = fixed.temperature + fixed.pressure + fixed.humidity;
+        }
+
+        runs++;
+        fixed_s = now_seconds() - start;
+    }
+    while (fixed_s < BENCH_MIN_SECONDS);
+
+    printf("fixed: %.1f ns/conversion\n", (fixed_s * 1e9) / ((double) runs * BENCH_READINGS));
+
+    runs  = 0;
+    start = now_seconds();
+
+    do
+    {
+        for (i = 0; i < BENCH_READINGS; i++)
+        {
+            ms8607_comp_float(&proms[i], &raws[i], &temperature, &pressure, &humidity);
+            BenchSink = (int32_t) (temperature + pressure + humidity);
+        }
+
+        runs++;
+        float_s = now_seconds() - start;
+    }
+    while (float_s < BENCH_MIN_SECONDS);
+
+    printf("float: %.1f ns/conversion\n", (float_s * 1e9) / ((double) runs * BENCH_READINGS));
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long num_readings;
+
+    if ((argc >= 2) && (strcmp(argv[1], "verify") == 0))
+    {
+        num_readings = (argc >= 3) ? strtoul(argv[2], NULL, 0) : DEFAULT_READINGS;
+        return cmd_verify(num_readings);
+    }
+
+    if ((argc == 2) && (strcmp(argv[1], "bench") == 0))
+    {
+        return cmd_bench();
+    }
+
+    fprintf(stderr,
+            "usage: %s verify [num_readings]\n"
+            "       %s bench\n",
+            argv[0], argv[0]);
+
+    return 1;
+}
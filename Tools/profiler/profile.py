@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+"""
+Host-side symbolizer for the PC-sampling profiler dumps (Source/profiler).
+
+The firmware logs each profile as "PROF" lines between a header and a
+trailer (see profiler.c). Capture the serial console to a file, e.g.
+
+    python3 -m serial /dev/cu.usbmodem1103 115200 --raw | tee profile.log
+
+then resolve the sampled PCs to functions against the ELF that is running on
+the board and print a flat profile and one profile per task:
+
+    python3 Tools/profiler/profile.py profile.log --elf build/main.elf
+
+By default only the last complete dump in the log is used, `--all` adds up
+every complete dump instead. Symbols come from `arm-none-eabi-nm`, pick a
+different one with `--nm` (e.g. `nm` for a hosted build).
+"""
+
+import argparse
+import bisect
+import re
+import subprocess
+import sys
+from collections import defaultdict, namedtuple
+
+BEGIN_RE = re.compile(r"PROF begin rate=(\d+) samples=(\d+) dropped=(\d+) slots=(\d+)")
+SAMPLE_RE = re.compile(r"PROF 0x([0-9a-fA-F]+) (\d+) (.+)$")
+END_RE = re.compile(r"PROF end\b")
+
+TEXT_TYPES = "tT"
+# nm reports weak symbols the same way for code and data, only trust sized ones
+WEAK_TYPES = "wW"
+
+Profile = namedtuple("Profile", ["rate", "samples", "dropped", "counts"])
+
+
+def parse_dumps(lines):
+    """Returns the complete dumps found in the log, in order."""
+    dumps = []
+    current = None
+
+    for line in lines:
+        match = BEGIN_RE.search(line)
+        if match:
+            rate, samples, dropped, _ = (int(v) for v in match.groups())
+            current = Profile(rate, samples, dropped, defaultdict(int))
+            continue
+
+        if current is None:
+            continue
+
+        match = SAMPLE_RE.search(line)
+        if match:
+            current.counts[(int(match.group(1), 16), match.group(3).strip())] += int(match.group(2))
+            continue
+
+        if END_RE.search(line):
+            dumps.append(current)
+            current = None
+
+    return dumps
+
+
+def merge_dumps(dumps):
+    counts = defaultdict(int)
+    for dump in dumps:
+        for key, count in dump.counts.items():
+            counts[key] += count
+
+    return Profile(dumps[-1].rate, sum(d.samples for d in dumps),
+                   sum(d.dropped for d in dumps), counts)
+
+
+class Symbols:
+    """Address to function name lookup built from `nm -n -S` output."""
+
+    def __init__(self, nm, elf):
+        output = subprocess.run([nm, "--defined-only", "-n", "-S", elf],
+                                check=True, capture_output=True, text=True).stdout
+        self.starts = []
+        self.entries = []
+
+        for line in output.splitlines():
+            fields = line.split()
+            if len(fields) == 4:
+                address, size, kind, name = fields
+                size = int(size, 16)
+            elif len(fields) == 3:
+                address, kind, name = fields
+                size = None
+            else:
+                continue
+
+            if kind not in TEXT_TYPES and (kind not in WEAK_TYPES or size is None):
+                continue
+
+            # Thumb function symbols have the low bit set
+            self.starts.append(int(address, 16) & ~1)
+            self.entries.append((name, size))
+
+    def lookup(self, pc):
+        i = bisect.bisect_right(self.starts, pc) - 1
+        if i < 0:
+            return None
+
+        name, size = self.entries[i]
+        if size is not None and pc >= self.starts[i] + size:
+            return None
+
+        return name
+
+
+def print_table(title, counts, total, top):
+    print(title)
+    print("  %7s %6s  %s" % ("samples", "%", "function"))
+
+    for name, count in sorted(counts.items(), key=lambda item: -item[1])[:top]:
+        print("  %7d %5.1f%%  %s" % (count, 100.0 * count / total, name))
+
+    print()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("log", help="captured serial console output")
+    parser.add_argument("--elf", default="build/main.elf",
+                        help="firmware the log came from (default: %(default)s)")
+    parser.add_argument("--nm", default="arm-none-eabi-nm",
+                        help="nm to read the symbols with (default: %(default)s)")
+    parser.add_argument("--all", action="store_true",
+                        help="add up every complete dump instead of using the last one")
+    parser.add_argument("--top", type=int, default=20, metavar="N",
+                        help="functions to show per table (default: %(default)s)")
+    args = parser.parse_args()
+
+    with open(args.log, errors="replace") as log:
+        dumps = parse_dumps(log)
+
+    if not dumps:
+        sys.exit("%s: no complete profiler dump found" % args.log)
+
+    profile = merge_dumps(dumps) if args.all else dumps[-1]
+    symbols = Symbols(args.nm, args.elf)
+
+    flat = defaultdict(int)
+    tasks = defaultdict(lambda: defaultdict(int))
+    task_totals = defaultdict(int)
+    counted = 0
+
+    for (pc, task), count in profile.counts.items():
+        name = symbols.lookup(pc) or "0x%08x" % pc
+        flat[name] += count
+        tasks[task][name] += count
+        task_totals[task] += count
+        counted += count
+
+    if counted == 0:
+        sys.exit("%s: the profile has no samples" % args.log)
+
+    print("%d samples at %d Hz (%.1f s), %d dropped, %d dump(s)" % (
+        profile.samples, profile.rate, profile.samples / profile.rate,
+        profile.dropped, len(dumps) if args.all else 1))
+    print()
+
+    print_table("Flat profile", flat, counted, args.top)
+
+    for task, total in sorted(task_totals.items(), key=lambda item: -item[1]):
+        print_table("%s: %d samples (%.1f%%)" % (task, total, 100.0 * total / counted),
+                    tasks[task], total, args.top)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,482 @@
+/**
+ * @file   sample_block_tool.c
+ * @author Ben Brown <ben@beninter.net>
+ * @brief  Host tool for compressed sample blocks (Source/sample_block).
+ *
+ *         Built from the same sample_block.c as the application (`make sample-block-tool`).
+ *         Traces are CSV files with a header line and one sample per line:
+ *
+ *             timestamp_ns,temperature,humidity,pressure
+ *
+ *         where an empty field is an invalid value. `telemetry.py --csv` records them
+ *         from the device.
+ *
+ *         Usage:
+ *             sample_block_tool bench  <trace.csv> [samples_per_block]
+ *             sample_block_tool encode <trace.csv> <blocks.bin> [samples_per_block]
+ *             sample_block_tool decode <blocks.bin>
+ *             sample_block_tool synth  <num_samples>
+ */
+
+#include <sample_block.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_SAMPLES_PER_BLOCK (256U)
+#define BENCH_MIN_SECONDS         (1.0)
+
+/* Sensor_Data on the Cortex-M7, and the same fields without padding */
+#define SENSOR_DATA_SIZE          (32U)
+#define PACKED_SAMPLE_SIZE        (8U + (4U * SAMPLE_BLOCK_NUM_CHANNELS) + 1U)
+
+typedef struct
+{
+    Sample_Record* p_records;
+    uint32_t       count;
+} Trace;
+
+static const Sample_Record* trace_get(void* p_ctx, uint32_t index)
+{
+    return &((const Sample_Record*) p_ctx)[index];
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double) ts.tv_sec + ((double) ts.tv_nsec * 1e-9);
+}
+
+static bool parse_line(char* line, Sample_Record* p_rec)
+{
+    char* field;
+    char* end;
+    uint32_t channel;
+
+    memset(p_rec, 0, sizeof(*p_rec));
+
+    field = strsep(&line, ",");
+    p_rec->timestamp_ns = strtoull(field, &end, 10);
+
+    if ((end == field) || (line == NULL))
+    {
+        return false;
+    }
+
+    for (channel = 0; channel < SAMPLE_BLOCK_NUM_CHANNELS; channel++)
+    {
+        field = strsep(&line, ",\r\n");
+
+        if (field == NULL)
+        {
+            return false;
+        }
+
+        if (*field != '\0')
+        {
+            p_rec->value[channel]  = strtof(field, &end);
+            p_rec->valid_mask     |= (uint8_t) (1U << channel);
+        }
+    }
+
+    return true;
+}
+
+static bool trace_load(const char* path, Trace* p_trace)
+{
+    FILE* fp;
+    char line[256];
+    uint32_t capacity;
+    Sample_Record rec;
+
+    fp = fopen(path, "r");
+
+    if (fp == NULL)
+    {
+        perror(path);
+        return false;
+    }
+
+    capacity          = 1024;
+    p_trace->count    = 0;
+    p_trace->p_records = malloc(capacity * sizeof(Sample_Record));
+
+    while ((p_trace->p_records != NULL) && (fgets(line, sizeof(line), fp) != NULL))
+    {
+        /* Skips the header and anything else that is not a sample */
+        if (parse_line(line, &rec) == false)
+        {
+            continue;
+        }
+
+        if (p_trace->count == capacity)
+        {
+            capacity           *= 2U;
+            p_trace->p_records  = realloc(p_trace->p_records, capacity * sizeof(Sample_Record));
+
+            if (p_trace->p_records == NULL)
+            {
+                break;
+            }
+        }
+
+        p_trace->p_records[p_trace->count++] = rec;
+    }
+
+    fclose(fp);
+
+    if ((p_trace->p_records == NULL) || (p_trace->count == 0U))
+    {
+        fprintf(stderr, "%s: no samples\n", path);
+        return false;
+    }
+
+    return true;
+}
+
+static bool records_equal(const Sample_Record* p_a, const Sample_Record* p_b)
+{
+    uint32_t channel;
+
+    if ((p_a->timestamp_ns != p_b->timestamp_ns) || (p_a->valid_mask != p_b->valid_mask))
+    {
+        return false;
+    }
+
+    for (channel = 0; channel < SAMPLE_BLOCK_NUM_CHANNELS; channel++)
+    {
+        /* Bit exact, only valid values are stored */
+        if (((p_a->valid_mask & (1U << channel)) != 0U) &&
+            (memcmp(&p_a->value[channel], &p_b->value[channel], sizeof(float)) != 0))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Encodes the whole trace into `p_out` one block after another, returns the total size or 0 on error */
+static size_t encode_trace(const Trace* p_trace, uint32_t per_block, uint8_t* p_out, size_t out_size)
+{
+    uint32_t first;
+    uint32_t n;
+    size_t total;
+    size_t size;
+
+    total = 0;
+
+    for (first = 0; first < p_trace->count; first += n)
+    {
+        n    = ((p_trace->count - first) < per_block) ? (p_trace->count - first) : per_block;
+        size = sample_block_encode(trace_get, &p_trace->p_records[first], n, &p_out[total], out_size - total);
+
+        if (size == 0U)
+        {
+            return 0;
+        }
+
+        total += size;
+    }
+
+    return total;
+}
+
+/* Decodes every block in `p_in`, returns the number of samples or -1 on error */
+static long decode_blocks(const uint8_t* p_in, size_t in_size, Sample_Record* p_out, uint32_t max_out)
+{
+    size_t pos;
+    size_t size;
+    uint32_t n;
+    uint32_t count;
+
+    pos   = 0;
+    count = 0;
+
+    while (pos < in_size)
+    {
+        size = sample_block_size(&p_in[pos], in_size - pos);
+        n    = sample_block_decode(&p_in[pos], size, &p_out[count], max_out - count);
+
+        if ((size == 0U) || (n == 0U))
+        {
+            return -1;
+        }
+
+        pos   += size;
+        count += n;
+    }
+
+    return (long) count;
+}
+
+static int cmd_bench(const char* path, uint32_t per_block)
+{
+    Trace trace;
+    uint8_t* p_blocks;
+    Sample_Record* p_decoded;
+    size_t max_size;
+    size_t encoded;
+    uint32_t i;
+    uint32_t reps;
+    double start;
+    double encode_s;
+    double decode_s;
+
+    if (trace_load(path, &trace) == false)
+    {
+        return 1;
+    }
+
+    max_size  = ((trace.count / per_block) + 1U) * sample_block_max_size(per_block);
+    p_blocks  = malloc(max_size);
+    p_decoded = malloc(trace.count * sizeof(Sample_Record));
+
+    if ((p_blocks == NULL) || (p_decoded == NULL))
+    {
+        return 1;
+    }
+
+    encoded = encode_trace(&trace, per_block, p_blocks, max_size);
+
+    if ((encoded == 0U) || (decode_blocks(p_blocks, encoded, p_decoded, trace.count) != (long) trace.count))
+    {
+        fprintf(stderr, "round trip failed\n");
+        return 1;
+    }
+
+    for (i = 0; i < trace.count; i++)
+    {
+        if (records_equal(&trace.p_records[i], &p_decoded[i]) == false)
+        {
+            fprintf(stderr, "sample %u differs after round trip\n", i);
+            return 1;
+        }
+    }
+
+    /* Repeat until the timing is long enough to be meaningful */
+    reps  = 0;
+    start = now_seconds();
+
+    do
+    {
+        (void) encode_trace(&trace, per_block, p_blocks, max_size);
+        reps++;
+    }
+    while ((now_seconds() - start) < BENCH_MIN_SECONDS);
+
+    encode_s = (now_seconds() - start) / reps;
+    reps     = 0;
+    start    = now_seconds();
+
+    do
+    {
+        (void) decode_blocks(p_blocks, encoded, p_decoded, trace.count);
+        reps++;
+    }
+    while ((now_seconds() - start) < BENCH_MIN_SECONDS);
+
+    decode_s = (now_seconds() - start) / reps;
+
+    printf("samples:            %u (%u per block)\n", trace.count, per_block);
+    printf("encoded:            %zu bytes, %.2f bytes/sample\n", encoded, (double) encoded / trace.count);
+    printf("ratio vs struct:    %.2fx (%u bytes/sample)\n",
+           (double) trace.count * SENSOR_DATA_SIZE / encoded, SENSOR_DATA_SIZE);
+    printf("ratio vs packed:    %.2fx (%u bytes/sample)\n",
+           (double) trace.count * PACKED_SAMPLE_SIZE / encoded, PACKED_SAMPLE_SIZE);
+    printf("encode (host):      %.1f ns/sample, %.2f Msamples/s\n",
+           encode_s * 1e9 / trace.count, trace.count / encode_s / 1e6);
+    printf("decode (host):      %.1f ns/sample, %.2f Msamples/s\n",
+           decode_s * 1e9 / trace.count, trace.count / decode_s / 1e6);
+    printf("round trip:         bit exact\n");
+
+    free(p_decoded);
+    free(p_blocks);
+    free(trace.p_records);
+
+    return 0;
+}
+
+static int cmd_encode(const char* in_path, const char* out_path, uint32_t per_block)
+{
+    Trace trace;
+    FILE* fp;
+    uint8_t* p_blocks;
+    size_t max_size;
+    size_t encoded;
+
+    if (trace_load(in_path, &trace) == false)
+    {
+        return 1;
+    }
+
+    max_size = ((trace.count / per_block) + 1U) * sample_block_max_size(per_block);
+    p_blocks = malloc(max_size);
+    encoded  = (p_blocks != NULL) ? encode_trace(&trace, per_block, p_blocks, max_size) : 0U;
+
+    if (encoded == 0U)
+    {
+        fprintf(stderr, "encode failed\n");
+        return 1;
+    }
+
+    fp = fopen(out_path, "wb");
+
+    if ((fp == NULL) || (fwrite(p_blocks, 1, encoded, fp) != encoded))
+    {
+        perror(out_path);
+        return 1;
+    }
+
+    fclose(fp);
+    free(p_blocks);
+    free(trace.p_records);
+
+    return 0;
+}
+
+static int cmd_decode(const char* path)
+{
+    FILE* fp;
+    uint8_t* p_blocks;
+    Sample_Record* p_decoded;
+    long size;
+    long count;
+    long i;
+    uint32_t channel;
+
+    fp = fopen(path, "rb");
+
+    if (fp == NULL)
+    {
+        perror(path);
+        return 1;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    p_blocks = malloc((size_t) size);
+
+    if ((size <= 0) || (p_blocks == NULL) || (fread(p_blocks, 1, (size_t) size, fp) != (size_t) size))
+    {
+        fprintf(stderr, "%s: read failed\n", path);
+        return 1;
+    }
+
+    fclose(fp);
+
+    /* Each sample needs at least one bit per column, which bounds the sample count */
+    p_decoded = malloc((size_t) size * 8U * sizeof(Sample_Record));
+    count     = (p_decoded != NULL) ? decode_blocks(p_blocks, (size_t) size, p_decoded, (uint32_t) size * 8U) : -1;
+
+    if (count < 0)
+    {
+        fprintf(stderr, "%s: corrupt block\n", path);
+        return 1;
+    }
+
+    printf("timestamp_ns,temperature,humidity,pressure\n");
+
+    for (i = 0; i < count; i++)
+    {
+        printf("%llu", (unsigned long long) p_decoded[i].timestamp_ns);
+
+        for (channel = 0; channel < SAMPLE_BLOCK_NUM_CHANNELS; channel++)
+        {
+            if ((p_decoded[i].valid_mask & (1U << channel)) != 0U)
+            {
+                printf(",%.9g", p_decoded[i].value[channel]);
+            }
+            else
+            {
+                printf(",");
+            }
+        }
+
+        printf("\n");
+    }
+
+    free(p_decoded);
+    free(p_blocks);
+
+    return 0;
+}
+
+/* Synthetic 1 Hz trace with slow drift, sensor noise, and timing jitter, for trying the tool without a device */
+static int cmd_synth(uint32_t num_samples)
+{
+    uint32_t i;
+    uint64_t timestamp_ns;
+    float temperature;
+    float humidity;
+    float pressure;
+
+    srand(1);
+
+    temperature  = 27.04f;
+    humidity     = 36.2f;
+    pressure     = 997.74f;
+    timestamp_ns = 170000000ULL;
+
+    printf("timestamp_ns,temperature,humidity,pressure\n");
+
+    for (i = 0; i < num_samples; i++)
+    {
+        /* MS8607 resolution: 0.01 degC, ~0.04 %RH, 0.01-0.03 mbar depending on OSR */
+        temperature += 0.01f * (float) ((rand() % 3) - 1);
+        humidity    += 0.0076f * (float) ((rand() % 5) - 2);
+        pressure    += 0.01f * (float) ((rand() % 5) - 2);
+
+        printf("%llu,%.6f,%.6f,%.6f\n", (unsigned long long) timestamp_ns,
+               (double) temperature, (double) humidity, (double) pressure);
+
+        timestamp_ns += 1000000000ULL + (uint64_t) (rand() % 20000);
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t per_block;
+
+    if ((argc >= 3) && (strcmp(argv[1], "bench") == 0))
+    {
+        per_block = (argc >= 4) ? (uint32_t) strtoul(argv[3], NULL, 10) : DEFAULT_SAMPLES_PER_BLOCK;
+        return ((per_block > 0U) && (per_block <= 0xFFFFU)) ? cmd_bench(argv[2], per_block) : 1;
+    }
+
+    if ((argc >= 4) && (strcmp(argv[1], "encode") == 0))
+    {
+        per_block = (argc >= 5) ? (uint32_t) strtoul(argv[4], NULL, 10) : DEFAULT_SAMPLES_PER_BLOCK;
+        return ((per_block > 0U) && (per_block <= 0xFFFFU)) ? cmd_encode(argv[2], argv[3], per_block) : 1;
+    }
+
+    if ((argc >= 3) && (strcmp(argv[1], "decode") == 0))
+    {
+        return cmd_decode(argv[2]);
+    }
+
+    if ((argc >= 3) && (strcmp(argv[1], "synth") == 0))
+    {
+        return cmd_synth((uint32_t) strtoul(argv[2], NULL, 10));
+    }
+
+    fprintf(stderr,
+            "usage: %s bench  <trace.csv> [samples_per_block]\n"
+            "       %s encode <trace.csv> <blocks.bin> [samples_per_block]\n"
+            "       %s decode <blocks.bin>\n"
+            "       %s synth  <num_samples>\n",
+            argv[0], argv[0], argv[0], argv[0]);
+
+    return 1;
+}
@@ -0,0 +1,307 @@
+#!/usr/bin/env python3
+"""
+Host-side parser for the binary sensor telemetry frames (Source/telemetry).
+
+Frames are COBS encoded and wrapped in zero delimiters so they can share the
+UART with plain text log lines. `StreamParser` splits a raw byte stream into
+decoded frames and text lines, and can be used as a library:
+
+    parser = StreamParser()
+    for kind, item in parser.feed(data):
+        ...
+
+When the logger batch CRC is enabled (OS_CFG_LOGGER_TASK_CRC_BATCH_SIZE), the
+parser also checks every "CRC32: 0x... (N records)" checkpoint line against a
+CRC-32 of the bytes it received since the previous checkpoint.
+
+or run directly against the serial console:
+
+    python3 Tools/telemetry/telemetry.py /dev/cu.usbmodem1103 115200
+"""
+
+import argparse
+import re
+import struct
+import sys
+import zlib
+from collections import namedtuple
+
+FRAME_SAMPLE = 0x01
+FRAME_SUMMARY = 0x02
+
+VALID_TEMPERATURE = 1 << 0
+VALID_HUMIDITY = 1 << 1
+VALID_PRESSURE = 1 << 2
+
+SENSOR_NAMES = {0: "MS8607"}
+
+CHECKPOINT_RE = re.compile(r"CRC32: 0x([0-9a-fA-F]{8}) \((\d+) records\)")
+
+# type, seq, timestamp_ns, sensor, mask, temperature, humidity, pressure
+SAMPLE_FORMAT = struct.Struct("<BHQBBhHI")
+# type, seq, start_ns, end_ns, sensor, num_samples
+SUMMARY_FORMAT = struct.Struct("<BHQQBH")
+# count, mean, variance, min, max (per channel)
+CHANNEL_FORMAT = struct.Struct("<Hffff")
+CRC_FORMAT = struct.Struct("<H")
+
+Sample = namedtuple(
+    "Sample",
+    ["seq", "timestamp_ns", "sensor", "temperature", "humidity", "pressure"],
+)
+
+Summary = namedtuple(
+    "Summary",
+    ["seq", "start_ns", "end_ns", "sensor", "num_samples",
+     "temperature", "humidity", "pressure"],
+)
+
+Stats = namedtuple("Stats", ["count", "mean", "variance", "min", "max"])
+
+
+class FrameError(ValueError):
+    """Raised when a chunk between delimiters is not a valid frame."""
+
+
+def crc16_ccitt(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE, matches the device implementation."""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            if crc & 0x8000:
+                crc = ((crc << 1) ^ 0x1021) & 0xFFFF
+            else:
+                crc = (crc << 1) & 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    """Decode one COBS block (without delimiters)."""
+    out = bytearray()
+    idx = 0
+    while idx < len(data):
+        code = data[idx]
+        if code == 0:
+            raise FrameError("zero byte inside COBS block")
+        end = idx + code
+        if end > len(data):
+            raise FrameError("truncated COBS block")
+        out += data[idx + 1:end]
+        idx = end
+        if code != 0xFF and idx < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def decode_frame(chunk):
+    """Decode the bytes between two delimiters into a frame object."""
+    raw = cobs_decode(chunk)
+    if len(raw) < 1 + CRC_FORMAT.size:
+        raise FrameError("frame too short")
+
+    (crc,) = CRC_FORMAT.unpack_from(raw, len(raw) - CRC_FORMAT.size)
+    if crc != crc16_ccitt(raw[:-CRC_FORMAT.size]):
+        raise FrameError("CRC mismatch")
+
+    if raw[0] == FRAME_SAMPLE:
+        if len(raw) != SAMPLE_FORMAT.size + CRC_FORMAT.size:
+            raise FrameError("bad sample frame length")
+        _, seq, ts, sensor, mask, temp, humid, press = SAMPLE_FORMAT.unpack_from(raw)
+        return Sample(
+            seq=seq,
+            timestamp_ns=ts,
+            sensor=sensor,
+            temperature=temp / 100.0 if mask & VALID_TEMPERATURE else None,
+            humidity=humid / 100.0 if mask & VALID_HUMIDITY else None,
+            pressure=press / 100.0 if mask & VALID_PRESSURE else None,
+        )
+
+    if raw[0] == FRAME_SUMMARY:
+        if len(raw) != SUMMARY_FORMAT.size + 3 * CHANNEL_FORMAT.size + CRC_FORMAT.size:
+            raise FrameError("bad summary frame length")
+        _, seq, start, end, sensor, num = SUMMARY_FORMAT.unpack_from(raw)
+        channels = []
+        for idx in range(3):
+            stats = Stats(*CHANNEL_FORMAT.unpack_from(
+                raw, SUMMARY_FORMAT.size + idx * CHANNEL_FORMAT.size))
+            channels.append(stats if stats.count else None)
+        return Summary(seq, start, end, sensor, num, *channels)
+
+    raise FrameError("unknown frame type 0x%02x" % raw[0])
+
+
+class StreamParser:
+    """Incrementally split a serial byte stream into frames and text lines.
+
+    Every frame is sent as 0x00, COBS data, 0x00, so zero bytes alternate between
+    opening and closing a frame. Outside a frame the stream is text and complete
+    lines are emitted as soon as their newline arrives. A chunk that fails to
+    decode is counted as an error and treated as text, and the zero that ended
+    it is taken as the start of the next frame to resynchronize.
+
+    Bytes are kept from one CRC checkpoint line to the next. The first checkpoint
+    only synchronizes, since the parser may have started mid-batch.
+    """
+
+    def __init__(self):
+        self._buf = bytearray()
+        self._in_frame = False
+        self.frames = 0
+        self.errors = 0
+        self.dropped = 0
+        self._last_seq = None
+        self._batch = bytearray()
+        self._line_start = 0
+        self._crc_synced = False
+        self.crc_ok = 0
+        self.crc_fail = 0
+
+    def _track_seq(self, seq):
+        if self._last_seq is not None:
+            self.dropped += (seq - self._last_seq - 1) & 0xFFFF
+        self._last_seq = seq
+
+    def feed(self, data):
+        """Yield ("frame", frame) and ("text", line) tuples for complete input."""
+        for byte in data:
+            if not self._buf and not self._in_frame:
+                self._line_start = len(self._batch)
+            self._batch.append(byte)
+
+            if byte != 0:
+                self._buf.append(byte)
+                if not self._in_frame and byte == 0x0A:
+                    yield from self._text(self._buf)
+                    self._checkpoint(self._buf)
+                    self._buf.clear()
+                continue
+
+            chunk = bytes(self._buf)
+            self._buf.clear()
+
+            if not self._in_frame:
+                yield from self._text(chunk)
+                self._in_frame = True
+                continue
+
+            if not chunk:
+                continue
+
+            try:
+                frame = decode_frame(chunk)
+            except FrameError:
+                self.errors += 1
+                yield from self._text(chunk)
+                continue
+
+            self.frames += 1
+            self._in_frame = False
+            if hasattr(frame, "seq"):
+                self._track_seq(frame.seq)
+            yield ("frame", frame)
+
+    def _checkpoint(self, line):
+        match = CHECKPOINT_RE.search(bytes(line).decode("utf-8", errors="replace"))
+        if match is None:
+            return
+
+        if self._crc_synced:
+            if int(match.group(1), 16) == zlib.crc32(self._batch[:self._line_start]):
+                self.crc_ok += 1
+            else:
+                self.crc_fail += 1
+
+        self._crc_synced = True
+        self._batch.clear()
+
+    @staticmethod
+    def _text(chunk):
+        for line in bytes(chunk).decode("utf-8", errors="replace").splitlines():
+            if line:
+                yield ("text", line)
+
+
+def format_header(timestamp_ns, sensor, seq):
+    return "[%d.%06d][%s #%d]" % (
+        timestamp_ns // 1000000000,
+        (timestamp_ns % 1000000000) // 1000,
+        SENSOR_NAMES.get(sensor, str(sensor)),
+        seq,
+    )
+
+
+def format_summary(summary):
+    fields = [format_header(summary.end_ns, summary.sensor, summary.seq),
+              "n=%d over %.3f s" % (summary.num_samples,
+                                    (summary.end_ns - summary.start_ns) / 1e9)]
+    for name, unit, stats in (("T", "degC", summary.temperature),
+                              ("RH", "%", summary.humidity),
+                              ("P", "mbar", summary.pressure)):
+        if stats is not None:
+            fields.append("%s=%.3f (sd %.3f, %.2f..%.2f) %s" % (
+                name, stats.mean, stats.variance ** 0.5, stats.min, stats.max, unit))
+    return " ".join(fields)
+
+
+def format_sample(sample):
+    fields = [format_header(sample.timestamp_ns, sample.sensor, sample.seq)]
+    if sample.temperature is not None:
+        fields.append("T=%.2f degC" % sample.temperature)
+    if sample.humidity is not None:
+        fields.append("RH=%.2f %%" % sample.humidity)
+    if sample.pressure is not None:
+        fields.append("P=%.2f mbar" % sample.pressure)
+    return " ".join(fields)
+
+
+def format_frame(frame):
+    if isinstance(frame, Summary):
+        return format_summary(frame)
+    return format_sample(frame)
+
+
+CSV_HEADER = "timestamp_ns,temperature,humidity,pressure\n"
+
+
+def format_csv(sample):
+    """One trace line, invalid values are left empty."""
+    values = [sample.temperature, sample.humidity, sample.pressure]
+    return "%d,%s\n" % (sample.timestamp_ns,
+                        ",".join("" if v is None else "%.2f" % v for v in values))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("port", help="serial port, e.g. /dev/cu.usbmodem1103")
+    parser.add_argument("baudrate", type=int, nargs="?", default=115200)
+    parser.add_argument("--csv", metavar="FILE",
+                        help="also record samples as a trace for Tools/sample_block")
+    args = parser.parse_args()
+
+    import serial
+
+    stream = StreamParser()
+    trace = open(args.csv, "w") if args.csv else None
+    if trace:
+        trace.write(CSV_HEADER)
+
+    with serial.Serial(args.port, args.baudrate, timeout=0.1) as port:
+        try:
+            while True:
+                for kind, item in stream.feed(port.read(256)):
+                    print(format_frame(item) if kind == "frame" else item)
+                    if trace and isinstance(item, Sample):
+                        trace.write(format_csv(item))
+        except KeyboardInterrupt:
+            pass
+
+    if trace:
+        trace.close()
+
+    print("frames=%d dropped=%d errors=%d crc_ok=%d crc_fail=%d" % (
+        stream.frames, stream.dropped, stream.errors, stream.crc_ok, stream.crc_fail),
+        file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()